@@ -11,19 +11,38 @@
 #include <ctime>
 #include <chrono>
 #include <thread>
+#include <sstream>
+#include <algorithm>
+#include <cstring>
 
 #ifdef __linux__
     #include <termios.h>
     #include <unistd.h>
     #include <sys/ioctl.h>
     #include <fcntl.h>
-    void moveCursor()
+    #include <poll.h>
+    #include <cerrno>
 #endif
 
-Emu::Apple1::Apple1()
+namespace
+{
+    // F3 steps through the speeds, 0 is unlimited
+    unsigned nextSpeed(unsigned speed)
+    {
+        switch (speed)
+        {
+        case 1:  return 2;
+        case 2:  return 10;
+        case 10: return 0;
+        default: return 1;
+        }
+    }
+}
+
+Emu::Apple1::Apple1(bool romsFromDisk)
     : m_cpu(new Emu::emu6502()), 
-      m_cursorPos{ 0, 0 },
-      m_running(true), m_onStartup(true), m_throttled(true)
+      m_onStartup(true), m_assembler(false), m_cycles(0), m_nextCheckpoint(0), m_trace(new Trace()), m_running(true),
+      m_speed(m_pacer.getSpeed()), m_hz(0.0), m_cursor(0), m_rewindSeconds(0.0), m_rewindBytes(0), m_rewindCost(0.0), m_traceRecords(0)
 {
     #ifdef _WIN32
         setUpWindows();
@@ -32,17 +51,28 @@ Emu::Apple1::Apple1()
     #endif
 
 
+    defineRomSets(m_roms, romsFromDisk);
+    m_cpu->map(WOZACI_ENTRY, WOZACI_ENTRY + 0xFF, Memory::Page::ROM);                                                 // the monitor and the cassette interface are roms on the real board, the loaders
+    m_cpu->map(WOZMON_ENTRY, 0xFFFF, Memory::Page::ROM);                                                              // still put them there but a program can't write over them
+    m_cpu->map(KEYBOARD_INPUT_REGISTER & 0xFF00, KEYBOARD_INPUT_REGISTER | 0xFF, Memory::Page::DEVICE, &m_pia);       // the keyboard and display, the pia is called as the registers are read and written
+    m_pia.onDisplay([this](Byte val) { display(val); });
+    m_pia.onKeyboardPoll([this]
+    {
+        Byte key;
+        if (m_keys.pop(key)) m_pia.pressKey(key);                                                                   // the next key typed ahead goes in once the last one has been read
+    });
+
     std::srand(static_cast<unsigned int>(std::time(nullptr)));
 
     // The apple 1 starts with random values of the display buffer, I'm just going to simulate this because there's nothing
-    // added by emulating this buffer. It's essentially the buffer of the console.
-    for (size_t y = 0; y <= SCREEN_CHAR_HEIGHT; ++y)
+    // added by emulating this buffer. It goes in the screen and shows up with the first frame.
+    for (Byte y = 0; y < SCREEN_CHAR_HEIGHT; ++y)
     {
-        for (size_t x = 0; x < SCREEN_CHAR_WIDTH; ++x)
+        for (Byte x = 0; x < SCREEN_CHAR_WIDTH; ++x)
         {
             // Generate a random printable ASCII character (uppercase letters, numbers, and some symbols)
             char randomChar = std::toupper((std::rand() % (126 - 32) + 32)); // Roughly simulates Apple 1 video memory noise
-            std::cout << randomChar;
+            m_screen.fill(randomChar, x, y);
         }
     }
     //std::cout << Apple1_Title::A1_LINE1 << Apple1_Title::A1_LINE2 << Apple1_Title::A1_LINE3 << Apple1_Title::A1_LINE4 << Apple1_Title::A1_LINE5 << Apple1_Title::A1_LINE6 << Apple1_Title::A1_LINE7 << Apple1_Title::A1_LINE8 << Apple1_Title::A1_LINE9;
@@ -50,6 +80,8 @@ Emu::Apple1::Apple1()
 
 Emu::Apple1::~Apple1()
 {
+    m_cpu->setTrace(nullptr);                                                                                       // whatever's still in the ring goes into the file
+    m_trace->stop();
     delete m_cpu;
 }
 
@@ -97,71 +129,31 @@ void Emu::Apple1::setUpWindows()
 
     // Set text color to green (Apple 1 used monochrome green monitors)
     SetConsoleTextAttribute(m_stdOutHandle, FOREGROUND_GREEN);
+
+    // The screen's frames position the cursor with escape sequences
+    GetConsoleMode(m_stdOutHandle, &mode);
+    SetConsoleMode(m_stdOutHandle, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
 }
 
-char Emu::Apple1::readKeyboardWindows()
+void Emu::Apple1::readKeyboardWindows(DWORD timeout)
 {
+    if (WaitForSingleObject(m_stdInHandle, timeout) != WAIT_OBJECT_0) return;                                     // the console handle is signalled while there's input waiting
+
     INPUT_RECORD ir;
     DWORD readCount;
-    static bool eProgram = false;
-
-    if (PeekConsoleInput(m_stdInHandle, &ir, 1, &readCount) && readCount > 0)
+    while (PeekConsoleInput(m_stdInHandle, &ir, 1, &readCount) && readCount > 0)
     {
         ReadConsoleInput(m_stdInHandle, &ir, 1, &readCount);
         CHAR key = ir.Event.KeyEvent.uChar.AsciiChar & 0x7F;
         WORD vKey = ir.Event.KeyEvent.wVirtualKeyCode;
         if (ir.EventType == KEY_EVENT and ir.Event.KeyEvent.bKeyDown)
         {                                                                                   // First check if it was an F key, because those are special. Otherwise we write the key to a register
-            switch (vKey)                                                                   // Clear screen button
-            {
-            case VK_F1:
-                clearScreen();                                                             
-                return VK_F1;
-            case VK_F2:                                                                     // Reset button                                                            // The reset button on the Apple 1 does not clear the ram.
-                std::cout << ' ';                                                           // clear the cursor if it's there or it will be left on the screen
-                m_onStartup = false;                                                        // if this is the first time starting, this will stop the program blocking
-                m_cpu->reset();                                                             // reset the cpu
-                m_cpu->loadProgramHex(BASIC_ROM, BASIC_ENTRY);
-                m_cpu->loadProgram2(WOZACI_ROM,  WOZACI_ENTRY);
-                m_cpu->loadProgram2(WOZMON_ROM,  WOZMON_ENTRY);                             // program counter is successfully reset from the reset vector set by the wozmon, 
-                m_cpu->loadProgram2(PUZZ15_ROM,  GAME_ENTRY);                               // so calling m_cpu.reset() properly sets the program counter. Now just reset the cursor
-                m_cursorPos.X = 0;
-                m_cursorPos.Y = 0;
-                SetConsoleCursorPosition(m_stdOutHandle, m_cursorPos);
-                return VK_F2;
-            case VK_F3:                                                                     // throttling
-                m_throttled = !m_throttled;
-                return VK_F3;
-            case VK_F4:                                                                     // swap basic and assembler
-                if (eProgram)
-                    m_cpu->loadProgramHex(BASIC_ROM, BASIC_ENTRY);
-                else
-                    m_cpu->loadProgram2(A1ASM_ROM, BASIC_ENTRY);
-                eProgram = !eProgram;
-                return VK_F4;
-            case VK_F5:
-                saveState();
-                return VK_F5;
-            case VK_F6:
-                loadState();
-                return VK_F6;
-            case VK_F7:
-                m_cpu->loadProgram2("roms/chcckers_4A_FF.txt", 0x004A);
-                m_cpu->loadProgram2("roms/checkers_0300_0FFF.txt", 0x0300);
-                return VK_F7;
-            case VK_F8:
-                m_cpu->loadProgram2(FORTH_ROM, FORTH_ENTRY);
-                return VK_F8;
-            case VK_F12:                                                                    // Quit button
-                m_running = false;
-                return VK_F12;
-            }
-            m_cpu->busWrite(KEYBOARD_INPUT_REGISTER, static_cast<Byte>(std::toupper(key)) | 0x80);                   // We have to write the key to the keyboard input register with the last bit set.
-
-            Bits<Byte>::SetBit(m_cpu->getBus()[KEYBOARD_CNTRL_REGISTER], LastBit<Byte>);                             // Set the keyboard control register so the wozmon knows there's a key ready to be read
+            if (vKey >= VK_F1 and vKey <= VK_F12)
+                functionKey(static_cast<Byte>(vKey - VK_F1 + 1));
+            else if (key != 0)
+                typeKey(key);
         }
-}
-    return 0x00;
+    }
 }
 #endif
 
@@ -172,11 +164,11 @@ char Emu::Apple1::readKeyboardWindows()
 #ifdef __linux__
 void Emu::Apple1::setUpLinux()
 {
-    static bool eProgram = false;
     struct termios newt;                                                                                            // set up non blocking input
     char ch;
     tcgetattr(STDIN_FILENO, &newt);
     newt.c_lflag &= ~(ICANON | ECHO);
+    newt.c_iflag &= ~ICRNL;                                                                                         // return comes through as \r like the apple 1 wants
     tcsetattr(STDIN_FILENO, TCSANOW, &newt);
     int flags = fcntl(STDIN_FILENO, F_GETFL, 0);
     fcntl(STDIN_FILENO, F_SETFL, flags | O_NONBLOCK);
@@ -186,242 +178,468 @@ void Emu::Apple1::setUpLinux()
     w.ws_col = SCREEN_CHAR_HEIGHT;
     ioctl(STDOUT_FILENO, TIOCSWINSZ, &w);
 
-    std::cout << "\033[32mGreen Text\033[0m" << std::endl;                                                          // set text color green
+    std::cout << "\033[32m\033[2J" << std::flush;                                                                   // set text color green and start from a blank console, the frames draw the rest
 }
 
-char Emu::Apple1::readKeyboardLinux()
+// Only wakes for a keystroke or the timeout, and then reads everything that's waiting at once. The decoder keeps its place in a function
+// key's escape sequence between reads, and once nothing more has come for ESCAPE_WAIT_MS a lone ESC is the ESC key
+void Emu::Apple1::readKeyboardLinux(int timeout)
 {
-    char key;
-    if (read(STDIN_FILNEO, &key, 1) < 1)
-        return (char)0x00;
-    if (key == 27)                                                                                                  // Escape key detected
-    { 
-        char seq[10] = { 0 };
-        if (read(STDIN_FILENO, &seq[0], 1) < 1) return 27;                                                          // Just ESC key pressed
-        if (read(STDIN_FILENO, &seq[1], 1) < 1) return 27;                                                          // Partial sequence
-
-        // Check if it's an F key
-        if (seq[0] == '[') 
-        {
-            switch (seq[1]) 
-            {
-            case 'O': // VT100-style F1-F4
-                read(STDIN_FILENO, &seq[2], 1);
-                switch (seq[2]) 
-                {
-                case 'P': 
-                    clearScreen();
-                    return '1';
-                case 'Q': 
-                    std::cout << ' ';                                                           // clear the cursor if it's there or it will be left on the screen
-                    m_onStartup = false;                                                        // if this is the first time starting, this will stop the program blocking
-                    m_cpu->reset();                                                              // reset the cpu
-                    m_cpu->loadProgramHex(BASIC_ROM, BASIC_ENTRY);
-                    m_cpu->loadProgram2(A1ASM_ROM, ASM_ENTRY);                            // restore the programs incase they were over written
-                    m_cpu->loadProgram2(WOZACI_ROM, WOZACI_ENTRY);
-                    m_cpu->loadProgram2(WOZMON_ROM, WOZMON_ENTRY);                       // program counter is successfully reset from the reset vector set by the wozmon, 
-                    m_cpu->loadProgram2(PUZZ15_ROM, GAME_ENTRY);                          // so calling m_cpu.reset() properly sets the program counter. Now just reset the cursor
-                    m_cursorPos.X = 0;
-                    m_cursorPos.Y = 0;
-                    return '2';
-                case 'R': 
-                    m_throttled = !m_throttled;
-                    return '3';
-                case 'S': 
-                    if (eProgram)
-                        m_cpu->loadProgramHex(BASIC_ROM, BASIC_ENTRY);
-                    else
-                        m_cpu->loadProgram2(A1ASM_ROM, BASIC_ENTRY);
-                    eProgram = !eProgram;
-                    return '4';
-                }
+    if (m_keyDecoder.pending())
+    {
+        int waited = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_lastInput).count());
+        timeout = std::max(0, std::min(timeout, ESCAPE_WAIT_MS - waited));
+    }
 
-                break;
-            case '1': // Linux console / xterm F5-F12
-                read(STDIN_FILENO, &seq[2], 1);
-                if (seq[2] == '~') 
-                {
-                    switch (seq[1]) 
-                    {
-                    case '5':
-                        saveState();
-                        return '5';
-                    case '7': 
-                        loadState();
-                        return '6';
-                    case '8': 
-                        return '7';
-                    case '9': 
-                        m_cpu->loadProgram2(FORTH_ROM, FORTH_ENTRY);
-                        return '8';
-                    }
-                }
-                else 
-                if (seq[2] == '0' && read(STDIN_FILENO, &seq[3], 1) > 0 && seq[3] == '~') 
-                {
-                    switch (seq[1]) 
-                    {
-                    case '1': 
-                        return '9';
-                    case '2': 
-                        return 'A';
-                    case '3': 
-                        return 'B';
-                    case '4': 
-                        m_running = false;
-                        return 'C';
-                    }
-                }
-                break;
-            }
+    struct pollfd input = { STDIN_FILENO, POLLIN, 0 };
+    if (poll(&input, 1, timeout) < 1 or !(input.revents & POLLIN))
+    {
+        if (m_keyDecoder.pending() and std::chrono::steady_clock::now() - m_lastInput >= std::chrono::milliseconds(ESCAPE_WAIT_MS))
+        {
+            KeyDecoder::Event event = m_keyDecoder.flush();
+            if (event.key != 0) typeKey(static_cast<char>(event.key));
         }
-        return 0; // Unknown escape sequence
+        return;
     }
 
-    m_cpu->busWrite(KEYBOARD_INPUT_REGISTER, static_cast<Byte>(std::toupper(key)) | 0x80);                   // We have to write the key to the keyboard input register with the last bit set.
-
-    Bits<Byte>::SetBit(m_cpu->getBus()[KEYBOARD_CNTRL_REGISTER], LastBit<Byte>);                             // Set the keyboard control register so the wozmon knows there's a key ready to be read
-    return key;
-}
+    char buffer[64];
+    ssize_t count = read(STDIN_FILENO, buffer, sizeof(buffer));
+    if (count < 1) return;
+    m_lastInput = std::chrono::steady_clock::now();
 
-void Emu::Apple1::moveCursor(const unsigned short& x, const unsigned short& y)
-{
-    std::cout << "\033[" << (int)y << ";" << (int)x << "H" << std::flush;
+    for (ssize_t i = 0; i < count; ++i)
+    {
+        KeyDecoder::Event event = m_keyDecoder.feed(static_cast<Byte>(buffer[i]));
+        if (event.function != 0) functionKey(event.function);
+        else if (event.key != 0) typeKey(static_cast<char>(event.key));
+    }
 }
 #endif
 
 int Emu::Apple1::run()
 {
-    std::chrono::steady_clock::time_point start, displayFlagStart, cpuStart;
-    Byte clockCount = 0;
-    bool cursorFlag = false;
+    std::chrono::steady_clock::time_point start, frameStart, speedStart;
+    const auto frameInterval = std::chrono::microseconds(1000000 / SCREEN_REFRESH_HZ);
 
     start = std::chrono::steady_clock::now();
-    start = std::chrono::high_resolution_clock::now();
-    cpuStart = displayFlagStart = start;
+    frameStart = speedStart = start;
+    present();                                                                                                      // the noise the apple 1 powers up with
+
+    std::thread cpuThread([this] { emulate(); });
 
     while (m_running)
     {
-
-        // Need to check for input first so we can reset after start up
+        // Sleep in the keyboard read until a key comes or it's time for the next frame. The keys and commands go off to the cpu thread,
+        // F1 and F12 are handled here
+        auto untilFrame = std::chrono::ceil<std::chrono::milliseconds>(frameStart + frameInterval - std::chrono::steady_clock::now());
+        int timeout = static_cast<int>(std::max<long long>(0, untilFrame.count()));
         #ifdef _WIN32
-            this->readKeyboardWindows();
-        #elif defiend(__linux__)
-            this->readKeyboardLinux();
+            this->readKeyboardWindows(static_cast<DWORD>(timeout));
+        #elif defined(__linux__)
+            this->readKeyboardLinux(timeout);
         #endif
+
+        // Whatever the cpu has displayed since the last look goes into the screen
+        Byte val;
+        while (m_display.pop(val))
+        {
+            if (val == SCREEN_HOME)        m_screen.home();
+            else if (val >= SCREEN_ROW)    m_screen.setCursor(m_screen.getCursorX(), val - SCREEN_ROW);
+            else if (val >= SCREEN_COLUMN) m_screen.setCursor(val - SCREEN_COLUMN, m_screen.getCursorY());
+            else                           m_screen.put(val);
+        }
+        m_cursor = static_cast<Word>((m_screen.getCursorY() << 8) | m_screen.getCursorX());
+
+        auto now = std::chrono::steady_clock::now();
+
+        // Do timer stuff for Flashing the cursor
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - start);
+
+        if (elapsed.count() >= 500) // half a second has passed
+        {
+            m_screen.setCursorVisible(!m_screen.getCursorVisible());                                                // the @ is drawn over the cursor cell by the next frame
+
+            // Reset the start time.
+            start = now;
+        }
+
+        // Everything the display did since the last frame goes out together
+        if (now - frameStart >= frameInterval)
+        {
+            present();
+            frameStart = now;
+        }
+
+        if (now - speedStart >= std::chrono::seconds(1))
+        {
+            showSpeed();
+            speedStart = now;
+        }
+    }
+
+    cpuThread.join();
+    return 0;
+}
+
+void Emu::Apple1::emulate()
+{
+    std::chrono::steady_clock::time_point displayFlagStart, speedStart;
+    displayFlagStart = speedStart = std::chrono::steady_clock::now();
+
+    while (m_running)
+    {
+        Command command;
+        while (m_commands.pop(command)) execute(command);
+
         // if the apple1 has been started but not reset yet it can't do anything
         if (m_onStartup)
         {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
             continue;
         }
 
-        // clock the cpu and process mmio registers
-        m_cpu->fetch_and_execute();
-        this->mmioRegisterMonitor();
-        clockCount += m_cpu->getCycles();
+        // clock the cpu, the pia queues the display characters as they're written. The pacer hands out the cycles for the next slice of host
+        // time and the cpu runs them, stopping straight after a write to the display so its busy flag is looked at here. Unlimited the slice is RUN_SLICE_CYCLES
+        QWord cycles = m_cpu->run_cycles(m_pacer.budget()).cycles;
+        m_pacer.ran(cycles);
+        m_cycles += cycles;
+        checkpoint();
 
         auto now = std::chrono::steady_clock::now();
-        clockCount += m_cpu->getCycles();
-
-        // Do timer stuff for Flashing the cursor and throttling the display rate
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - start);
-        auto displayFlagElapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - displayFlagStart);
-        auto cpuElapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - cpuStart);
+        auto displayFlagElapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - displayFlagStart);
 
         // The bottlneck of the Apple 1 was the monitor, so we can emulate the speed of monitor by constantly flipping the last bit in the display output register
-        // This is how the Apple 1 monitor actually worked too so this is good emulation. F4 toggles this on and off. If off, we need to keep that bit cleared
-        if (m_throttled)
-        {   // the display ready flag bit should be ready about 10x a minute, so flip it every 5 hundreths of a second
-            if (displayFlagElapsed.count() > 50)
+        // This is how the Apple 1 monitor actually worked too so this is good emulation. Faster speeds flip it faster, unlimited keeps that bit cleared
+        if (m_pacer.getSpeed() != 0)
+        {   // the display ready flag bit should be ready about 10x a minute, so at 1x flip it every 5 hundreths of a second
+            if (displayFlagElapsed.count() > 50000 / m_pacer.getSpeed())
             {
-                Bits<Byte>::ToggleBit(m_cpu->getBus()[DISPLAY_OUTPUT_REGISTER], LastBit<Byte>);  // Toggle the last bit of the display output register. This controls whether the monitor is available or not
+                m_pia.setDisplayBusy(!m_pia.getDisplayBusy());                                  // Toggle the last bit of the display output register. This controls whether the monitor is available or not
                 displayFlagStart = now;
             }
-            // throttle the cpu to approximately 1000 clock cycles per second, or 100 cycles per .1 seconds
-            if (cpuElapsed.count() > 200)
-            {
-                if (clockCount >= 200)
-                    std::this_thread::sleep_for(std::chrono::milliseconds((clockCount - 200)));
-                clockCount = 0;
-                cpuStart = now;
-            }
         }
         else
-            Bits<Byte>::ClearBit(m_cpu->getBus()[DISPLAY_OUTPUT_REGISTER], LastBit<Byte>);
-
+            m_pia.setDisplayBusy(false);
+        if (m_display.full()) m_pia.setDisplayBusy(true);                                                          // the console is behind, a program that waits on the display waits for it
 
-        if (elapsed.count() >= 500) // half a second has passed
+        if (now - speedStart >= std::chrono::seconds(1))
         {
-            if (cursorFlag) std::cout << ' ';
-            else            std::cout << "@";
-            cursorFlag = !cursorFlag;
-            #ifdef _WIN32
-                SetConsoleCursorPosition(m_stdOutHandle, m_cursorPos);
-            #elif defined(__linux__)
-                moveCursor(m_cursorPos.X, m_cursorPos.Y);
-            #endif
+            m_hz = m_pacer.measure();
+            const Rewind::Stats& stats = m_rewind.getStats();
+            m_rewindSeconds = static_cast<double>(stats.span) / APPLE1_CLOCK_HZ;
+            m_rewindBytes = stats.bytes;
+            m_rewindCost = stats.cycles == 0 ? 0.0 : stats.seconds * 1e6 / (static_cast<double>(stats.cycles) / APPLE1_CLOCK_HZ);
+            m_traceRecords = m_trace->active() ? m_trace->getStats().records : 0;
+            speedStart = now;
+        }
 
-            // Reset the start time.
-            start = now;
-            start = std::chrono::steady_clock::now();
+        // Waiting on the keyboard with nothing typed, no point spinning until something comes in or the speed's due to be measured
+        if (!m_pia.getKeyReady() and m_keys.getDepth() == 0 and m_commands.getDepth() == 0 and m_cpu->isPolling(KEYBOARD_CNTRL_REGISTER))
+        {
+            idle(speedStart + std::chrono::seconds(1));
+            continue;
         }
-    }
 
-    return 0;
+        m_pacer.wait();                                                                                             // sleep until the slice's cycles are due
+    }
 }
 
+// The loop only reads the keyboard, so skipping it changes nothing but the time. That time is counted as the cycles the loop would have
+// used so the pacing and the speed carry on as if it had run
+void Emu::Apple1::idle(std::chrono::steady_clock::time_point until)
+{
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_wake.wait_until(lock, until, [this] { return !m_running or m_keys.getDepth() != 0 or m_commands.getDepth() != 0; });
+    }
+    m_cycles += m_pacer.skip(std::chrono::steady_clock::now() - start);
+    checkpoint();
+}
 
-void Emu::Apple1::mmioRegisterMonitor()
+void Emu::Apple1::wake()
 {
-    if (m_cpu->getInstructionName() == "STA" and m_cpu->getAddressValue() == DISPLAY_OUTPUT_REGISTER)                 // the wozmon echo routine at FFEF stores the character at the display output register from the accumulator using STA
     {
-        char outputChar = std::toupper(static_cast<char>(m_cpu->busRead(DISPLAY_OUTPUT_REGISTER) & 0x7F));           // read the key from the display output register, but we don't want the last bit
+        std::lock_guard<std::mutex> lock(m_wakeMutex);                                                              // so the cpu thread can't miss it between checking and sleeping
+    }
+    m_wake.notify_one();
+}
 
-        if (outputChar == CR)                                                                                       // if it's carriage return 0x8D
+void Emu::Apple1::execute(Command command)
+{
+    switch (command)
+    {
+    case Command::RESET:                                                                                            // The reset button on the Apple 1 does not clear the ram.
+        m_onStartup = false;                                                                                        // if this is the first time starting, this will stop the program blocking
+        m_roms.apply(ROM_SET_RESET, *m_cpu);                                                                        // restore the programs incase they were over written, the wozmon goes in first so
+        m_assembler = false;                                                                                        // m_cpu.reset() gets the program counter from its reset vector even on the first press
+        m_cpu->reset();
+        m_pia.reset();
+        m_display.push(SCREEN_HOME);                                                                                // Now just reset the cursor, after anything that was displayed before the reset
+        break;
+    case Command::SPEED:
+        m_pacer.setSpeed(nextSpeed(m_pacer.getSpeed()));
+        m_speed = m_pacer.getSpeed();
+        break;
+    case Command::SWAP_ASSEMBLER:
+        m_roms.apply(m_assembler ? ROM_SET_BASIC : ROM_SET_ASSEMBLER, *m_cpu);
+        m_assembler = !m_assembler;
+        break;
+    case Command::SAVE_STATE:
+        saveState();
+        break;
+    case Command::LOAD_STATE:
+        loadState();
+        break;
+    case Command::LOAD_CHECKERS:
+        m_roms.apply(ROM_SET_CHECKERS, *m_cpu);
+        break;
+    case Command::LOAD_FORTH:
+        m_roms.apply(ROM_SET_FORTH, *m_cpu);
+        break;
+    case Command::JIT:
+        m_cpu->setJit(!m_cpu->getJit());
+        break;
+    case Command::REWIND:
+        rewind();
+        break;
+    case Command::TRACE:                                                                                            // starting again writes over the last trace
+        if (m_trace->active())
         {
-            std::cout << ' ';                                                                                       // erase a possible ghost @ cursor
-            if (++m_cursorPos.Y >= SCREEN_CHAR_HEIGHT) m_cursorPos.Y = 0;                                           // make sure we're within height of the screen
-            m_cursorPos.X = 0;                                                                                      // reset x coord
+            m_cpu->setTrace(nullptr);
+            m_trace->stop();
         }
-        else
-            if (outputChar >= 32 and outputChar <= 126)                                                             // else it's a printable character so print it
-            {                                                                                                       // no need to erase the cursor because our character will
-                std::cout << outputChar;
-                if (++m_cursorPos.X > SCREEN_CHAR_WIDTH - 1) m_cursorPos.X = 0;                                     // make sure we're within the width of the screen
-            }
-        #ifdef _WIN32
-            SetConsoleCursorPosition(m_stdOutHandle, m_cursorPos);                                                  // set the cursor the cursor pos
-        #elif defined(__linux__)
-            moveCursor(m_cursorPos.X, m_cursorPos.Y);
-        #endif
+        else if (m_trace->start(TRACE_FILE))
+            m_cpu->setTrace(m_trace.get());
+        break;
+    }
+}
+
+// The only time the roms are parsed, or read at all when they're built in. Off the disk the binary basic and the hex text of the rest are
+// given their formats rather than sniffed. A rom that's missing leaves its set without it, like the loaders did when they failed
+bool Emu::Apple1::defineRomSets(RomSets& sets, bool fromDisk)
+{
+    auto add = [fromDisk](RomSet& set, const char* fname, Word addr, RomLoader::Format format)
+    {
+        return (!fromDisk and set.addEmbedded(fname, addr)) or set.add(fname, addr, format);
+    };
+
+    bool ok = true;
+    RomSet& reset = sets.define(ROM_SET_RESET);
+    ok = add(reset, BASIC_ROM,  BASIC_ENTRY,  RomLoader::Format::BINARY) and ok;
+    ok = add(reset, A1ASM_ROM,  ASM_ENTRY,    RomLoader::Format::TEXT) and ok;
+    ok = add(reset, WOZACI_ROM, WOZACI_ENTRY, RomLoader::Format::TEXT) and ok;
+    ok = add(reset, WOZMON_ROM, WOZMON_ENTRY, RomLoader::Format::TEXT) and ok;
+    ok = add(reset, PUZZ15_ROM, GAME_ENTRY,   RomLoader::Format::TEXT) and ok;
+
+    ok = add(sets.define(ROM_SET_BASIC),     BASIC_ROM, BASIC_ENTRY, RomLoader::Format::BINARY) and ok;
+    ok = add(sets.define(ROM_SET_ASSEMBLER), A1ASM_ROM, BASIC_ENTRY, RomLoader::Format::TEXT) and ok;
+
+    RomSet& checkers = sets.define(ROM_SET_CHECKERS);
+    ok = add(checkers, CHECKERS_ZERO_PAGE_ROM, 0x004A, RomLoader::Format::TEXT) and ok;
+    ok = add(checkers, CHECKERS_ROM,           0x0300, RomLoader::Format::TEXT) and ok;
+
+    ok = add(sets.define(ROM_SET_FORTH), FORTH_ROM, FORTH_ENTRY, RomLoader::Format::TEXT) and ok;
+    return ok;
+}
 
-        Bits<Byte>::ClearBit(m_cpu->getBus()[KEYBOARD_CNTRL_REGISTER], LastBit<Byte>);                               // clear the key board control register so the wozmon knows the character has been processed
+// For a cpu with no Apple1 around it, the headless runner's and the benchmarks'. The rom sets are built the first time and every machine
+// after that gets a copy of the reset set
+bool Emu::Apple1::setUpMachine(emu6502& cpu)
+{
+    static RomSets sets;
+    static const bool loaded = defineRomSets(sets);
+
+    std::memset(cpu.getBus(), 0x00, 0x10000);
+    cpu.invalidateBlocks();
+    cpu.map(WOZACI_ENTRY, WOZACI_ENTRY + 0xFF, Memory::Page::ROM);
+    cpu.map(WOZMON_ENTRY, 0xFFFF, Memory::Page::ROM);
+    if (!loaded)
+    {
+        std::cerr << "Couldn't load the roms, run from the directory containing roms/ or build them in\n";
+        return false;
+    }
+    sets.apply(ROM_SET_RESET, cpu);
+    cpu.reset();
+    return true;
+}
 
-        m_cpu->busWrite(KEYBOARD_INPUT_REGISTER, 0x00);
+// F1 and F12 are the console's, the rest go to the cpu thread
+void Emu::Apple1::functionKey(Byte number)
+{
+    switch (number)
+    {
+    case 1:                                                                                                         // Clear screen button
+        m_screen.clear();
+        break;
+    case 2:                                                                                                         // Reset button
+        m_commands.push(Command::RESET);
+        break;
+    case 3:                                                                                                         // speed, 1x 2x 10x and unlimited
+        m_commands.push(Command::SPEED);
+        break;
+    case 4:                                                                                                         // swap basic and assembler
+        m_commands.push(Command::SWAP_ASSEMBLER);
+        break;
+    case 5:
+        m_commands.push(Command::SAVE_STATE);
+        break;
+    case 6:
+        m_commands.push(Command::LOAD_STATE);
+        break;
+    case 7:
+        m_commands.push(Command::LOAD_CHECKERS);
+        break;
+    case 8:
+        m_commands.push(Command::LOAD_FORTH);
+        break;
+    case 9:                                                                                                         // toggle the recompiler
+        m_commands.push(Command::JIT);
+        break;
+    case 10:
+        m_commands.push(Command::REWIND);
+        break;
+    case 11:                                                                                                        // trace every instruction to trace.a1t until it's pressed again
+        m_commands.push(Command::TRACE);
+        break;
+    case 12:                                                                                                        // Quit button
+        m_running = false;
+        break;
     }
+    wake();
 }
 
+void Emu::Apple1::typeKey(char key)
+{
+    m_keys.push(static_cast<Byte>(std::toupper(key)));                                                              // The pia gets it and sets the strobe when the program is ready for it
+    wake();
+}
+
+// The pia calls this for every store to the display output register, the wozmon echo routine at FFEF uses STA. It's on the cpu thread
+// so the character only goes in the queue, the console thread puts it in the screen
+void Emu::Apple1::display(const Byte& val)
+{
+    m_display.push(static_cast<Byte>(std::toupper(val)));                                                           // the pia has already taken off the last bit, the screen handles return and skips what it can't show
+}
+
+// On the cpu thread between slices, so the cpu and the pia are where the last instruction left them. The cursor is where the console
+// had got to, a character still on its way through the display queue isn't counted
 bool Emu::Apple1::saveState()
 {
-    std::ofstream saveFile(SAVE_FILE, std::ios::binary);
-    if (saveFile.fail()) return false;
-    saveFile.write((const char*)m_cpu->getBus(), 0xFFFF);
-    return true;
+    return Snapshot::save(SAVE_FILE, getMachine(), m_cpu->getBus()) == Snapshot::Result::OK;
 }
 
+// Carries on from the instruction the snapshot was saved at, even straight after starting up. An old save.dat is only memory, that goes in
+// under whatever is running
 bool Emu::Apple1::loadState()
 {
-    std::ifstream loadFile(SAVE_FILE, std::ios::binary);
-    if (loadFile.fail()) return false;
-    loadFile.read((char*)m_cpu->getBus(), 0xFFFF);
+    Snapshot::Machine machine;
+    Snapshot::Result result = Snapshot::load(SAVE_FILE, machine, m_cpu->getBus());
+    if (result != Snapshot::Result::OK and result != Snapshot::Result::MEMORY_ONLY) return false;
+    m_cpu->invalidateBlocks();                                                                                       // the whole bus was written behind the cpu's back so drop any cached code
+    if (result == Snapshot::Result::MEMORY_ONLY) return true;
+
+    m_cpu->setCPU(machine.cpu);
+    setMachine(machine);
+    m_pacer.setSpeed(machine.speed);
+    m_speed = m_pacer.getSpeed();
+    m_cpu->setJit(machine.jit);
+    m_onStartup = false;
     return true;
 }
 
-void Emu::Apple1::clearScreen()
+Emu::Snapshot::Machine Emu::Apple1::getMachine()
 {
-    for (Byte y = 0; y < SCREEN_CHAR_HEIGHT; ++y)
-        for (Byte x = 0; x < SCREEN_CHAR_WIDTH; ++x)
-            std::cout << ' ';
+    Snapshot::Machine machine;
+    machine.cpu = m_cpu->getCPU();
+    machine.pia = m_pia.getState();
+    Word cursor = m_cursor;
+    machine.cursorX = cursor & 0xFF;
+    machine.cursorY = cursor >> 8;
+    machine.speed = static_cast<Word>(m_pacer.getSpeed());
+    machine.assembler = m_assembler;
+    machine.jit = m_cpu->getJit();
+    return machine;
+}
+
+void Emu::Apple1::setMachine(const Snapshot::Machine& machine)
+{
+    m_pia.setState(machine.pia);
+    m_assembler = machine.assembler;
+    m_display.push(static_cast<Byte>(SCREEN_ROW + std::min<Byte>(machine.cursorY, SCREEN_CHAR_HEIGHT - 1)));       // after anything displayed before it
+    m_display.push(static_cast<Byte>(SCREEN_COLUMN + std::min<Byte>(machine.cursorX, SCREEN_CHAR_WIDTH - 1)));
+}
+
+// Between slices, so a checkpoint is never in the middle of an instruction. A slice or a long idle that runs past the interval only
+// makes the one checkpoint at its end
+void Emu::Apple1::checkpoint()
+{
+    if (m_cycles < m_nextCheckpoint) return;
+    m_rewind.capture(*m_cpu, getMachine(), m_cycles);
+    m_nextCheckpoint = m_cycles + static_cast<QWord>(REWIND_INTERVAL_MS) * APPLE1_CLOCK_HZ / 1000;
+}
+
+// Back to the newest checkpoint at least a second of cycles ago, or the oldest there is. The text already on the screen stays, the cursor
+// goes back to where it was. Pressed again it goes back another second
+void Emu::Apple1::rewind()
+{
+    size_t back = 0;
+    while (back + 1 < m_rewind.size() and m_rewind.getCycle(back) + APPLE1_CLOCK_HZ > m_cycles) ++back;
+
+    Snapshot::Machine machine;
+    if (!m_rewind.restore(*m_cpu, back, machine)) return;
+    setMachine(machine);
+    m_cycles = m_rewind.getCycle(0);
+    m_nextCheckpoint = m_cycles + static_cast<QWord>(REWIND_INTERVAL_MS) * APPLE1_CLOCK_HZ / 1000;
+}
 
+void Emu::Apple1::present()
+{
+    m_frame.clear();
+    if (m_screen.render(m_frame)) writeConsole(m_frame);
+}
+
+void Emu::Apple1::showSpeed()
+{
+    unsigned speed = m_speed;
+    double hz = m_hz;
+
+    std::ostringstream title;
+    title << "Apple 1 - ";
+    if (speed == 0) title << "unlimited";
+    else            title << speed << 'x';
+    title.setf(std::ios::fixed);
+    title.precision(3);
+    title << ", " << hz / 1e6 << " MHz";
+    title.precision(1);
+    title << " (" << hz / APPLE1_CLOCK_HZ << "x an Apple 1)";
+    title << " - keys " << m_keys.getDepth() << '/' << m_keys.capacity() << ", " << m_keys.getDropped() << " dropped"           // how far behind the program and the console are
+          << " - display " << m_display.getDepth() << '/' << m_display.capacity() << " (most " << m_display.getMaxDepth() << "), "
+          << m_display.getDropped() << " dropped";
+    title << " - rewind " << m_rewindSeconds << "s in " << m_rewindBytes / 1024 << " KiB, " << m_rewindCost << " us a second";
+    if (QWord records = m_traceRecords) title << " - tracing, " << records << " instructions";
+
+    #ifdef _WIN32
+        SetConsoleTitleA(title.str().c_str());
+    #elif defined(__linux__)
+        writeConsole("\033]0;" + title.str() + "\007");
+    #endif
+}
+
+void Emu::Apple1::writeConsole(const std::string& text)
+{
+    #ifdef _WIN32
+        DWORD written;
+        WriteConsoleA(m_stdOutHandle, text.data(), static_cast<DWORD>(text.size()), &written, nullptr);
+    #elif defined(__linux__)
+        size_t done = 0;                                                                                            // stdout can share the non blocking flag set on stdin, so
+        while (done < text.size())                                                                                  // a full terminal comes back as EAGAIN and gets tried again
+        {
+            ssize_t count = write(STDOUT_FILENO, text.data() + done, text.size() - done);
+            if (count > 0)
+                done += count;
+            else if (count == 0 or (errno != EAGAIN and errno != EINTR))
+                break;
+        }
+    #endif
 }
@@ -1,4 +1,19 @@
 #pragma once
+#include "Bit.h"
+#include "Pia.h"
+#include "Screen.h"
+#include "Pacer.h"
+#include "SpscQueue.h"
+#include "KeyDecoder.h"
+#include "Snapshot.h"
+#include "Rewind.h"
+#include "RomSet.h"
+#include "Trace.h"
+#include <string>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 
 #ifdef _WIN32
 	#include <Windows.h>
@@ -15,8 +30,15 @@
 #define GAME_ENTRY				0x0300
 #define FORTH_ENTRY				0x1000
 
-#define SCREEN_CHAR_WIDTH  40
-#define SCREEN_CHAR_HEIGHT 24
+#define KEY_QUEUE_SIZE		256				// keys typed ahead of the program reading them
+#define DISPLAY_QUEUE_SIZE	4096				// characters on their way from the cpu thread to the screen
+#define SCREEN_HOME			0x80				// goes through the display queue on a reset, the pia never passes on bit 7
+#define SCREEN_COLUMN		0x90				// plus the column, and SCREEN_ROW plus the row, move the cursor when a snapshot is loaded
+#define SCREEN_ROW			0xC0
+
+#define ESCAPE_WAIT_MS		50					// how long a lone ESC waits for the rest of a function key's sequence
+
+#define SCREEN_REFRESH_HZ 60					// frames a second the screen is redrawn at, each frame is one write of what changed
 
 #define ESC 0x1B
 #define CR  0x0D
@@ -32,6 +54,14 @@
 #define A1ASM_ROM  "roms/a1asm.txt"
 #define PUZZ15_ROM "roms/puzz15.txt"
 #define FORTH_ROM  "roms/volks_forth.txt"
+#define CHECKERS_ZERO_PAGE_ROM "roms/checkers_4A_FF.txt"
+#define CHECKERS_ROM		   "roms/checkers_0300_0FFF.txt"
+
+#define ROM_SET_RESET		"reset"				// F2, everything the board comes up with
+#define ROM_SET_BASIC		"basic"				// F4 swaps these two at E000
+#define ROM_SET_ASSEMBLER	"assembler"
+#define ROM_SET_CHECKERS	"checkers"			// F7
+#define ROM_SET_FORTH		"forth"				// F8
 
 
 // Forward declare the processor class
@@ -45,55 +75,122 @@ namespace Emu
 namespace Emu
 {
 
+/*
+	The cpu runs on its own thread (emulate) and the console on the one that calls run. They only talk through the queues: keys and the
+	function key commands go to the cpu thread, display characters come back. Neither side waits on the other, a full display queue makes
+	the display look busy to the program and anything that still doesn't fit is dropped and counted in the console's title.
+	While the program sits in a keyboard poll loop the cpu thread sleeps until there's a key, see idle.
+*/
 class Apple1
 {
 public:
-									Apple1								();
+	// The function keys that act on the machine rather than the screen
+	enum class Command : Byte
+	{
+		RESET,									// F2, reloads the roms
+		SPEED,									// F3, the next speed
+		SWAP_ASSEMBLER,							// F4, basic and the assembler trade places at E000
+		SAVE_STATE,								// F5
+		LOAD_STATE,								// F6
+		LOAD_CHECKERS,							// F7
+		LOAD_FORTH,								// F8
+		JIT,									// F9, the recompiler on or off
+		REWIND,									// F10, back about a second
+		TRACE									// F11, starts or stops tracing to TRACE_FILE
+	};
+
+									Apple1								(bool romsFromDisk = false);				// The built in roms are used unless told otherwise
 
 									~Apple1								();
 
-			int						run									();
+			int						run									();											// The console side, returns once F12 is pressed and the cpu thread has stopped
+
+	static	bool					defineRomSets						(RomSets& sets,								// Puts the roms into the sets the function keys use, false if any
+																		 bool fromDisk = false);					// are missing. A rom that isn't built in is read from roms/ anyway
+
+	static	bool					setUpMachine						(emu6502& cpu);								// A cpu off the board the way the F2 reset leaves it: the reset set in a
+																													// cleared bus with the wozmon and the wozaci as rom. False without the roms
 
 protected:
-			void					mmioRegisterMonitor					();
+			void					emulate								();											// The cpu thread
+
+			void					execute								(Command command);							// On the cpu thread between slices
+
+			void					idle								(std::chrono::steady_clock::time_point until);	// Parks the cpu thread while the program waits on the keyboard
+
+			void					wake								();											// The console side queued a key or a command, or is quitting
+
+			void					display								(const Byte& val);							// The pia hands over each character written to the display
 
 			bool					saveState							();
 
 			bool					loadState							();
 
-			void					clearScreen							();
+			Snapshot::Machine		getMachine							();											// The cpu and everything around it, for a snapshot or a checkpoint
+
+			void					setMachine							(const Snapshot::Machine& machine);			// The pia, the rom at E000 and the cursor. Not the speed or the JIT, those are the loader's
+
+			void					checkpoint							();											// A rewind checkpoint if REWIND_INTERVAL_MS of cycles have gone by
+
+			void					rewind								();
+
+			void					present								();											// Renders the screen and writes the frame to the console in one go
+
+			void					showSpeed							();											// The target and achieved speed and the queues go in the console's title
+
+			void					writeConsole						(const std::string& text);
+
+			void					functionKey							(Byte number);								// F1 to F12 from either platform
+
+			void					typeKey								(char key);
 
 		#ifdef _WIN32
 
 			void					setUpWindows						();
 
-			char					readKeyboardWindows					();
+			void					readKeyboardWindows					(DWORD timeout);							// Waits up to timeout ms for input, then takes all of it
 
 		#elif defined(__linux__)
 
 			void					setUpLinux							();
 
-			char					readKeyboardLinux					();
-
-			void					moveCursor							(const unsigned short& x, 
-																		 const unsigned short& y);
-
-			typedef struct
-			{
-				Byte X, Y;
-			}COORD;
+			void					readKeyboardLinux					(int timeout);								// Waits up to timeout ms for stdin to be readable, then reads what's there
 
 		#endif
 private:
 	Emu::emu6502* m_cpu;
-	COORD		  m_cursorPos;
-	bool		  m_running,
-				  m_onStartup,
-				  m_throttled;
+	Pia			  m_pia;
+	Screen		  m_screen;
+	std::string	  m_frame;						// reused for every frame so it doesn't allocate
+	Pacer		  m_pacer;
+	RomSets		  m_roms;							// parsed once when it starts, the function keys only copy them in
+	bool		  m_onStartup;						// the cpu thread's, no reset yet
+	bool		  m_assembler;						// the cpu thread's, the assembler is at E000 instead of basic
+	Rewind		  m_rewind;							// the cpu thread's
+	QWord		  m_cycles;							// the cpu thread's, every cycle run or slept through since starting. A rewind takes it back too
+	QWord		  m_nextCheckpoint;
+	std::unique_ptr<Trace> m_trace;				// the cpu thread's, only ever tracing between two F11s
+
+	SpscQueue<Byte, KEY_QUEUE_SIZE>		m_keys;
+	SpscQueue<Command, 64>				m_commands;
+	SpscQueue<Byte, DISPLAY_QUEUE_SIZE>	m_display;
+	std::atomic<bool>					m_running;
+	std::atomic<unsigned>				m_speed;		// what the cpu thread is pacing to and getting, for the title
+	std::atomic<double>					m_hz;
+	std::atomic<Word>					m_cursor;		// the screen's cursor, row in the high byte, for the cpu thread to save
+	std::atomic<double>					m_rewindSeconds;	// how far back F10 can go, what the checkpoints take and what they cost, for the title
+	std::atomic<size_t>					m_rewindBytes;
+	std::atomic<double>					m_rewindCost;		// microseconds capturing for every emulated second
+	std::atomic<QWord>					m_traceRecords;		// written so far, 0 when it isn't tracing
+	std::mutex							m_wakeMutex;	// only for parking the cpu thread, the queues don't need it
+	std::condition_variable				m_wake;
 
 #ifdef _WIN32
 	HANDLE		 m_stdOutHandle, 
 				 m_stdInHandle;
+#elif defined(__linux__)
+	KeyDecoder	 m_keyDecoder;
+	std::chrono::steady_clock::time_point m_lastInput;		// when the decoder last got a byte, for giving up on an escape sequence
 #endif
 };
 
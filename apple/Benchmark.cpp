@@ -0,0 +1,1562 @@
+#include "Benchmark.h"
+#include "Apple1.h"
+#include "emu6502.h"
+#include "Pia.h"
+#include "Snapshot.h"
+#include "Rewind.h"
+#include "RomLoader.h"
+#include "EmbeddedRoms.h"
+#include "Disassembler.h"
+#include "Trace.h"
+#include "Profiler.h"
+#include "CallGraph.h"
+#include "Symbols.h"
+#include "MappedFile.h"
+#include <memory>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace Emu;
+
+namespace
+{
+	const QWord DEFAULT_INSTRUCTIONS = 20000000;
+	const Word	ALU_KERNEL_ENTRY	 = 0x0300;
+	const Word	DELAY_KERNEL_ENTRY	 = 0x0300;
+	const Word	CALL_KERNEL_ENTRY	 = 0x0300;
+	const QWord CALL_KERNEL_CYCLES	 = 85;
+	const char* SNAPSHOT_FILE		 = "bench.snapshot";
+	const int	SNAPSHOT_ROUNDS		 = 200;
+	const int	REWIND_ROUNDS		 = 50;
+	const QWord ROM_ROUNDS			 = 1000;
+	const QWord DISASM_ROUNDS		 = 1000;
+	const QWord TRACE_INSTRUCTIONS	 = 2000000;
+	const char* TRACE_FILES[]		 = { "bench.a1t", "bench.drained.a1t" };
+	const QWord PROFILE_INSTRUCTIONS = 5000000;
+	const char* PROFILE_SYMBOLS		 = "bench.sym";
+	const QWord CALL_INSTRUCTIONS	 = 5000000;
+	const QWord CALL_ROUNDS			 = 10000;
+
+#ifdef EMU_EAGER_FLAGS
+	const char* FLAGS_MODE = "eager";
+#else
+	const char* FLAGS_MODE = "lazy";
+#endif
+
+	// Shift and add multiply of $12 by its complement into $10/$11 followed by a subtract, compare and bit test, repeated with $12
+	// counting up. Nearly every instruction sets flags and almost none of them are read, which is what lazy flags are meant for
+	const Byte ALU_KERNEL[] =
+	{
+		0xA9, 0x00,			// 0300	LDA #$00
+		0x85, 0x10,			// 0302	STA $10
+		0x85, 0x11,			// 0304	STA $11
+		0xA5, 0x12,			// 0306	LDA $12
+		0x85, 0x13,			// 0308	STA $13
+		0x49, 0xFF,			// 030A	EOR #$FF
+		0x85, 0x14,			// 030C	STA $14
+		0xA9, 0x00,			// 030E	LDA #$00
+		0x85, 0x15,			// 0310	STA $15
+		0xA2, 0x08,			// 0312	LDX #$08
+		0x46, 0x13,			// 0314	LSR $13
+		0x90, 0x0D,			// 0316	BCC $0325
+		0x18,				// 0318	CLC
+		0xA5, 0x10,			// 0319	LDA $10
+		0x65, 0x14,			// 031B	ADC $14
+		0x85, 0x10,			// 031D	STA $10
+		0xA5, 0x11,			// 031F	LDA $11
+		0x65, 0x15,			// 0321	ADC $15
+		0x85, 0x11,			// 0323	STA $11
+		0x06, 0x14,			// 0325	ASL $14
+		0x26, 0x15,			// 0327	ROL $15
+		0xCA,				// 0329	DEX
+		0xD0, 0xE8,			// 032A	BNE $0314
+		0x38,				// 032C	SEC
+		0xA5, 0x10,			// 032D	LDA $10
+		0xE5, 0x11,			// 032F	SBC $11
+		0xC9, 0x80,			// 0331	CMP #$80
+		0x24, 0x11,			// 0333	BIT $11
+		0xE6, 0x12,			// 0335	INC $12
+		0x4C, 0x00, 0x03	// 0337	JMP $0300
+	};
+
+	// Busy waits the way programs time things, two loops nested 256 deep each way round and then a count up and a count down on their
+	// own. What's left of each is the final iteration that falls through
+	const Byte DELAY_KERNEL[] =
+	{
+		0xA0, 0x00,			// 0300	LDY #$00
+		0xA2, 0x00,			// 0302	LDX #$00
+		0xCA,				// 0304	DEX
+		0xD0, 0xFD,			// 0305	BNE $0304
+		0x88,				// 0307	DEY
+		0xD0, 0xF8,			// 0308	BNE $0302
+		0xA2, 0x10,			// 030A	LDX #$10
+		0xA0, 0x00,			// 030C	LDY #$00
+		0x88,				// 030E	DEY
+		0xD0, 0xFD,			// 030F	BNE $030E
+		0xCA,				// 0311	DEX
+		0xD0, 0xF8,			// 0312	BNE $030C
+		0xE8,				// 0314	INX
+		0xD0, 0xFD,			// 0315	BNE $0314
+		0x88,				// 0317	DEY
+		0xD0, 0xFD,			// 0318	BNE $0317
+		0xE6, 0x10,			// 031A	INC $10
+		0x4C, 0x00, 0x03	// 031C	JMP $0300
+	};
+
+	// Three calls in a row, each leaving by a different way: a nested JSR and RTS, an RTS to an address pushed by hand that carries on in
+	// the same routine, and a nested call whose return address is pulled off with PLA PLA so the outer RTS goes straight back to the loop.
+	// An iteration is 85 cycles, 21 of them outside any call
+	const Byte CALL_KERNEL[] =
+	{
+		0x20, 0x0C, 0x03,	// 0300	JSR $030C
+		0x20, 0x12, 0x03,	// 0303	JSR $0312
+		0x20, 0x1B, 0x03,	// 0306	JSR $031B
+		0x4C, 0x00, 0x03,	// 0309	JMP $0300
+		0x20, 0x10, 0x03,	// 030C	JSR $0310		12 cycles itself, 20 with $0310
+		0x60,				// 030F	RTS
+		0xEA,				// 0310	NOP				8
+		0x60,				// 0311	RTS
+		0xA9, 0x03,			// 0312	LDA #$03		24, the first RTS is a jump to $0319
+		0x48,				// 0314	PHA
+		0xA9, 0x19,			// 0315	LDA #$19		this cpu's JSR pushes the address after it and RTS goes to it as is
+		0x48,				// 0317	PHA
+		0x60,				// 0318	RTS
+		0xEA,				// 0319	NOP
+		0x60,				// 031A	RTS
+		0x20, 0x1F, 0x03,	// 031B	JSR $031F		12, 20 with $031F
+		0x60,				// 031E	RTS				never reached
+		0x68,				// 031F	PLA				8, drops its own return address
+		0x68,				// 0320	PLA
+		0x60				// 0321	RTS				returns from $031B to $0309
+	};
+
+	// The roms F2, F4, F7 and F8 load, and whether they're binary
+	const struct { const char* fname; Word addr; bool binary; } ROMS[] =
+	{
+		{ BASIC_ROM,						BASIC_ENTRY,	true  },
+		{ WOZMON_ROM,						WOZMON_ENTRY,	false },
+		{ WOZACI_ROM,						WOZACI_ENTRY,	false },
+		{ A1ASM_ROM,						ASM_ENTRY,		false },
+		{ PUZZ15_ROM,						GAME_ENTRY,		false },
+		{ FORTH_ROM,						FORTH_ENTRY,	false },
+		{ CHECKERS_ZERO_PAGE_ROM,			0x004A,			false },
+		{ CHECKERS_ROM,						0x0300,			false }
+	};
+
+	// How the roms were loaded before RomLoader, a token at a time out of a stream. Kept to check the new loader against and time it by
+	bool streamLoad(const char* fname, Word addr, bool binary, Byte* bus)
+	{
+		if (binary)
+		{
+			std::ifstream ifs(fname, std::ios::binary | std::ios::ate);
+			if (!ifs) return false;
+			std::streamsize size = ifs.tellg();
+			ifs.seekg(0, std::ios::beg);
+			return static_cast<bool>(ifs.read(reinterpret_cast<char*>(bus + addr), size));
+		}
+
+		std::ifstream ifs(fname, std::ios::in);
+		if (ifs.fail()) return false;
+		size_t counter = addr;
+		std::string value;
+		while (ifs >> value)
+			if (value.size() == 2) bus[counter++] = static_cast<Byte>(std::stoi(value, nullptr, 16));
+		return true;
+	}
+
+	// An Intel HEX record with its checksum worked out
+	std::string intelRecord(Word addr, Byte type, const std::vector<Byte>& data)
+	{
+		std::vector<Byte> record = { static_cast<Byte>(data.size()), static_cast<Byte>(addr >> 8), static_cast<Byte>(addr & 0xFF), type };
+		record.insert(record.end(), data.begin(), data.end());
+		Byte sum = 0;
+		for (Byte val : record) sum += val;
+		record.push_back(static_cast<Byte>(-sum));
+
+		std::ostringstream text;
+		text << ':' << std::hex << std::uppercase << std::setfill('0');
+		for (Byte val : record) text << std::setw(2) << static_cast<int>(val);
+		text << "\r\n";
+		return text.str();
+	}
+
+	// Every read and write changes what the next read gets, so two machines only end up with the same state if they made the same
+	// accesses to it in the same order
+	class TestDevice : public Device
+	{
+	public:
+		Byte read(const Word& addr) override					{ ++reads; state = state * 31 + addr; return static_cast<Byte>(state >> 8); }
+		void write(const Word& addr, const Byte& val) override	{ ++writes; state = state * 31 + (addr ^ (val << 16)); }
+
+		bool operator==(const TestDevice& rhs) const { return reads == rhs.reads and writes == rhs.writes and state == rhs.state; }
+
+		QWord reads = 0, writes = 0, state = 0;
+	};
+
+	// The random rounds run with the top of memory as rom and a device on $C000-$C0FF
+	void mapTestPages(emu6502& cpu, TestDevice& device)
+	{
+		cpu.map(0xC000, 0xC0FF, Memory::Page::DEVICE, &device);
+		cpu.map(0xF000, 0xFFFF, Memory::Page::ROM);
+	}
+
+	// The keyboard and display for one machine, without a console. The pia asks for the next key whenever the program polls for one with
+	// none waiting, and a display write is captured with the display ready again straight away
+	class Terminal
+	{
+	public:
+		Terminal(const std::string& keys, bool repeat)
+			: m_keys(keys), m_next(0), m_repeat(repeat)
+		{
+			m_pia.onKeyboardPoll([this] { nextKey(); });
+			m_pia.onDisplay([this](Byte val) { m_output += static_cast<char>(val); m_pia.setDisplayBusy(false); });
+		}
+
+		Terminal(const Terminal&) = delete;				// the pia's callbacks point back at this one
+
+		void attach(emu6502& cpu)
+		{
+			cpu.map(KEYBOARD_INPUT_REGISTER & 0xFF00, KEYBOARD_INPUT_REGISTER | 0xFF, Memory::Page::DEVICE, &m_pia);
+		}
+
+		const std::string& output() const { return m_output; }
+		std::string pending() const { return m_keys.substr(m_next); }		// keys not typed yet
+		Pia& pia() { return m_pia; }
+
+	private:
+		void nextKey()
+		{
+			if (m_next == m_keys.size()) return;
+			m_pia.pressKey(static_cast<Byte>(std::toupper(m_keys[m_next++])));
+			if (m_repeat and m_next == m_keys.size()) m_next = 0;
+		}
+
+		Pia			m_pia;
+		std::string m_keys;
+		size_t		m_next;
+		bool		m_repeat;
+		std::string m_output;
+	};
+
+	// The core is a template argument so the benchmark loop calls it directly instead of through another member function pointer
+	template<size_t (emu6502::*Step)()>
+	Benchmark::Result runCore(const std::string& workload, const QWord& instructions)
+	{
+		Benchmark::Result result;
+		std::unique_ptr<emu6502> cpu(new emu6502());
+		if (!Benchmark::setUpWorkload(*cpu, workload)) return result;
+
+		Terminal terminal(Benchmark::workloadKeys(workload), workload == "wozmon");
+		terminal.attach(*cpu);
+		emu6502& core = *cpu;
+
+		auto start = std::chrono::steady_clock::now();
+		for (QWord i = 0; i < instructions; ++i)
+			result.cycles += (core.*Step)();
+		auto end = std::chrono::steady_clock::now();
+
+		result.instructions = instructions;
+		result.seconds = std::chrono::duration<double>(end - start).count();
+		result.output = terminal.output();
+		result.blocks = core.getBlockCacheStats();
+		return result;
+	}
+
+	// Whole runs of blocks are cut short so they leave the last few instructions to be stepped one at a time, every instruction costs at
+	// least 2 cycles so a run given twice the instructions left over a block's worth can't go past them
+	Benchmark::Result runCachedBlocks(const std::string& workload, const QWord& instructions)
+	{
+		Benchmark::Result result;
+		std::unique_ptr<emu6502> cpu(new emu6502());
+		if (!Benchmark::setUpWorkload(*cpu, workload)) return result;
+		cpu->setLoopSkipping(false);
+
+		Terminal terminal(Benchmark::workloadKeys(workload), workload == "wozmon");
+		terminal.attach(*cpu);
+		emu6502& core = *cpu;
+
+		auto start = std::chrono::steady_clock::now();
+		while (result.instructions < instructions)
+		{
+			if (instructions - result.instructions > BLOCK_MAX_INSTRUCTIONS)
+			{
+				RunResult run = core.executeCachedBlocks(2 * (instructions - result.instructions - BLOCK_MAX_INSTRUCTIONS));
+				result.cycles += run.cycles;
+				result.instructions += run.instructions;
+			}
+			else
+			{
+				result.cycles += core.executeCached();
+				++result.instructions;
+			}
+		}
+		auto end = std::chrono::steady_clock::now();
+
+		result.seconds = std::chrono::duration<double>(end - start).count();
+		result.output = terminal.output();
+		result.blocks = core.getBlockCacheStats();
+		return result;
+	}
+
+	// The JIT runs whole blocks and chains through them like the cached core, so it's given the same budget and the last few instructions
+	// are stepped one at a time from the block cache to finish on the same instruction as the other cores. Returns a Result with no time
+	// in it if there is no JIT in this build
+	Benchmark::Result runJit(const std::string& workload, const QWord& instructions)
+	{
+		Benchmark::Result result;
+		std::unique_ptr<emu6502> cpu(new emu6502());
+		if (!Benchmark::setUpWorkload(*cpu, workload) or !cpu->setJit(true)) return result;
+		cpu->setLoopSkipping(false);
+
+		Terminal terminal(Benchmark::workloadKeys(workload), workload == "wozmon");
+		terminal.attach(*cpu);
+		emu6502& core = *cpu;
+
+		auto start = std::chrono::steady_clock::now();
+		while (result.instructions < instructions)
+		{
+			if (instructions - result.instructions > BLOCK_MAX_INSTRUCTIONS)
+			{
+				RunResult run = core.executeBlock(2 * (instructions - result.instructions - BLOCK_MAX_INSTRUCTIONS));
+				result.cycles += run.cycles;
+				result.instructions += run.instructions;
+			}
+			else
+			{
+				result.cycles += core.executeCached();
+				++result.instructions;
+			}
+		}
+		auto end = std::chrono::steady_clock::now();
+
+		result.seconds = std::chrono::duration<double>(end - start).count();
+		result.output = terminal.output();
+		result.blocks = core.getBlockCacheStats();
+		return result;
+	}
+
+	// run_cycles in slices the size the frontend runs them until cycles have gone by, each slice cut short at the end so the two runs
+	// finish on the same cycle. The cpu is left for the caller to compare. Given dirtyPages the dirty pages are added up and cleared after
+	// every slice, the way a snapshot taker would, and slices counts the slices
+	Benchmark::Result runSlices(emu6502& cpu, const std::string& workload, QWord cycles, bool skip, QWord* dirtyPages = nullptr,
+								QWord* slices = nullptr)
+	{
+		Benchmark::Result result;
+		if (!Benchmark::setUpWorkload(cpu, workload)) return result;
+		cpu.setLoopSkipping(skip);
+		if (dirtyPages != nullptr) cpu.clearDirtyPages();
+
+		Terminal terminal(Benchmark::workloadKeys(workload), workload == "wozmon");
+		terminal.attach(cpu);
+
+		auto start = std::chrono::steady_clock::now();
+		while (result.cycles < cycles)
+		{
+			RunResult run = cpu.run_cycles(std::min<QWord>(RUN_SLICE_CYCLES, cycles - result.cycles));
+			result.cycles += run.cycles;
+			result.instructions += run.instructions;
+			if (slices != nullptr) ++*slices;
+			if (dirtyPages != nullptr)
+			{
+				*dirtyPages += cpu.getDirtyPages().count();
+				cpu.clearDirtyPages();
+			}
+		}
+		auto end = std::chrono::steady_clock::now();
+
+		result.seconds = std::chrono::duration<double>(end - start).count();
+		result.output = terminal.output();
+		return result;
+	}
+
+	void printResult(const std::string& workload, const char* core, const Benchmark::Result& result)
+	{
+		std::cout << std::left << std::setw(10) << workload << std::setw(8) << core << std::right
+				  << std::setw(14) << result.instructions << std::setw(14) << result.cycles
+				  << std::setw(10) << std::fixed << std::setprecision(3) << result.seconds
+				  << std::setw(10) << std::setprecision(2) << (result.instructions / result.seconds / 1e6)
+				  << std::setw(10) << (result.seconds * 1e9 / result.instructions) << '\n';
+	}
+
+	void printState(const char* name, emu6502& cpu)
+	{
+		const CPU& c = cpu.getCPU();
+		std::cout << std::hex << std::setfill('0') << '\t' << name
+				  << " PC:" << std::setw(4) << c.p.getCopy() << " A:" << std::setw(2) << (int)c.a.getCopy()
+				  << " X:" << std::setw(2) << (int)c.x.getCopy() << " Y:" << std::setw(2) << (int)c.y.getCopy()
+				  << " P:" << std::setw(2) << (int)c.flags.getCopy() << " S:" << std::setw(4) << c.s.getCopy()
+				  << " cycles:" << std::dec << (int)cpu.getCycles() << " addr:" << cpu.getAddressValue() << std::setfill(' ') << '\n';
+	}
+
+	void printDisagreement(emu6502& lookup, const char* name, emu6502& other)
+	{
+		printState("lookup", lookup);
+		printState(name, other);
+	}
+
+	// Times run_cycles with and without the delay loops fast forwarded over as many cycles as the cores just took, and lists the loops
+	bool compareLoopSkipping(const std::string& workload, QWord cycles)
+	{
+		std::unique_ptr<emu6502> stepped(new emu6502());
+		std::unique_ptr<emu6502> skipped(new emu6502());
+		Benchmark::Result off = runSlices(*stepped, workload, cycles, false);
+		Benchmark::Result on  = runSlices(*skipped, workload, cycles, true);
+
+		QWord saved = 0;
+		for (const auto& loop : skipped->getLoopSkipStats()) saved += loop.second.instructions;
+		std::cout << "\tloop skipping: " << std::setprecision(2) << (off.seconds / on.seconds) << "x over " << cycles << " cycles, "
+				  << saved << " of " << on.instructions << " instructions skipped at " << skipped->getLoopSkipStats().size() << " loops\n";
+		for (const auto& loop : skipped->getLoopSkipStats())
+			std::cout << "\t  $" << std::hex << std::setw(4) << std::setfill('0') << loop.first << std::dec << std::setfill(' ') << ": "
+					  << loop.second.hits << " hits, " << loop.second.iterations << " iterations, " << loop.second.cycles << " cycles\n";
+
+		if (off.cycles != on.cycles or off.instructions != on.instructions or off.output != on.output
+			or !Benchmark::sameState(*stepped, *skipped))
+		{
+			std::cout << "\tloop skipping changed the outcome\n";
+			printDisagreement(*stepped, "skipped", *skipped);
+			return false;
+		}
+		return true;
+	}
+
+	// Once a page is dirty its stores are plain stores again, so clearing the pages after every slice is the most the tracking can cost
+	bool compareDirtyTracking(const std::string& workload, QWord cycles)
+	{
+		std::unique_ptr<emu6502> untracked(new emu6502());
+		std::unique_ptr<emu6502> tracked(new emu6502());
+		QWord dirtyPages = 0, slices = 0;
+		Benchmark::Result off = runSlices(*untracked, workload, cycles, true);
+		Benchmark::Result on  = runSlices(*tracked, workload, cycles, true, &dirtyPages, &slices);
+
+		std::cout << "\tdirty pages: " << std::setprecision(2) << (static_cast<double>(dirtyPages) / slices) << " a slice, run_cycles "
+				  << (off.seconds / on.seconds) << "x with them cleared after every slice\n";
+
+		if (off.cycles != on.cycles or off.output != on.output or !Benchmark::sameState(*untracked, *tracked))
+		{
+			std::cout << "\ttracking dirty pages changed the outcome\n";
+			printDisagreement(*untracked, "tracked", *tracked);
+			return false;
+		}
+		return true;
+	}
+}
+
+int Benchmark::run(int argc, char* argv[])
+{
+	std::string workload = (argc > 0) ? argv[0] : "all";
+	QWord instructions = (argc > 1) ? std::stoull(argv[1]) : DEFAULT_INSTRUCTIONS;
+
+	if (workload == "verify")
+		return verifyRandom(instructions) and verifySlices(instructions) ? 0 : 1;
+	if (workload == "snapshot")
+		return verifySnapshot(instructions) ? 0 : 1;
+	if (workload == "rewind")
+		return verifyRewind(instructions) ? 0 : 1;
+	if (workload == "roms")
+		return verifyRoms(argc > 1 ? instructions : ROM_ROUNDS) ? 0 : 1;
+	if (workload == "disasm")
+		return verifyDisassembler(argc > 1 ? instructions : DISASM_ROUNDS) ? 0 : 1;
+	if (workload == "trace")
+		return verifyTrace(argc > 1 ? instructions : TRACE_INSTRUCTIONS) ? 0 : 1;
+	if (workload == "profile")
+		return verifyProfiler(argc > 1 ? instructions : PROFILE_INSTRUCTIONS) ? 0 : 1;
+	if (workload == "calls")
+		return verifyCallGraph(argc > 1 ? instructions : CALL_INSTRUCTIONS) ? 0 : 1;
+
+	std::cout << "switch core flags: " << FLAGS_MODE << '\n';
+	std::cout << std::left << std::setw(10) << "workload" << std::setw(8) << "core" << std::right
+			  << std::setw(14) << "instructions" << std::setw(14) << "cycles" << std::setw(10) << "seconds" << std::setw(10) << "MIPS"
+			  << std::setw(10) << "ns/instr" << '\n';
+
+	bool ok = true;
+	for (const std::string name : { "wozmon", "basic", "alu", "delay" })
+	{
+		if (workload != "all" and workload != name) continue;
+
+		Result lookup = runCore<&emu6502::executeLookup>(name, instructions);
+		Result fast   = runCore<&emu6502::executeSwitch>(name, instructions);
+		Result cached = runCachedBlocks(name, instructions);
+		Result jit	  = runJit(name, instructions);
+		printResult(name, "lookup", lookup);
+		printResult(name, "switch", fast);
+		printResult(name, "cached", cached);
+		if (jit.instructions != 0) printResult(name, "jit", jit);
+		std::cout << "\tspeedup: switch " << std::setprecision(2) << (lookup.seconds / fast.seconds) << "x, cached "
+				  << (lookup.seconds / cached.seconds) << "x";
+		if (jit.instructions != 0) std::cout << ", jit " << (lookup.seconds / jit.seconds) << "x";
+		std::cout << "\n\tblock cache: " << cached.blocks.hits << " hits, " << cached.blocks.misses << " misses, "
+				  << cached.blocks.invalidations << " invalidations\n";
+		if (jit.instructions != 0)
+			std::cout << "\tjit: " << jit.blocks.compiled << " blocks translated\n";
+		else
+			std::cout << "\tjit: not available in this build\n";
+
+		if (lookup.cycles != fast.cycles or lookup.output != fast.output or lookup.cycles != cached.cycles or lookup.output != cached.output
+			or (jit.instructions != 0 and (lookup.cycles != jit.cycles or lookup.output != jit.output)))
+		{
+			std::cout << "\tcores disagree on cycles or display output\n";
+			ok = false;
+		}
+		ok = compareLoopSkipping(name, lookup.cycles) and ok;
+		ok = compareDirtyTracking(name, lookup.cycles) and ok;
+		ok = verifyWorkload(name, instructions) and ok;
+	}
+	return ok ? 0 : 1;
+}
+
+// The alu, delay and call kernels go in RAM on top of the usual roms and runs instead of the monitor
+bool Benchmark::setUpWorkload(emu6502& cpu, const std::string& workload)
+{
+	if (!Apple1::setUpMachine(cpu)) return false;
+
+	const Byte* kernel = nullptr;
+	size_t size = 0;
+	Word entry = 0;
+	if (workload == "alu")
+	{
+		kernel = ALU_KERNEL;
+		size = sizeof(ALU_KERNEL);
+		entry = ALU_KERNEL_ENTRY;
+	}
+	else if (workload == "delay")
+	{
+		kernel = DELAY_KERNEL;
+		size = sizeof(DELAY_KERNEL);
+		entry = DELAY_KERNEL_ENTRY;
+	}
+	else if (workload == "calls")
+	{
+		kernel = CALL_KERNEL;
+		size = sizeof(CALL_KERNEL);
+		entry = CALL_KERNEL_ENTRY;
+	}
+
+	if (kernel != nullptr)
+	{
+		std::memcpy(cpu.getBus() + entry, kernel, size);
+		cpu.invalidateBlocks(entry, static_cast<Word>(entry + size - 1));
+		cpu.setProgramCounter(entry);
+	}
+	return true;
+}
+
+// wozmon keeps dumping its own rom, basic is started from the monitor and runs a program that never ends
+std::string Benchmark::workloadKeys(const std::string& workload)
+{
+	if (workload == "wozmon")
+		return "FF00.FFFF\r";
+	if (workload == "alu" or workload == "delay" or workload == "calls")
+		return "";
+
+	return	"E000R\r"
+			"10 S=0\r"
+			"20 FOR I=1 TO 30000\r"
+			"30 S=(S+I*7) MOD 1000\r"
+			"40 NEXT I\r"
+			"50 PRINT S\r"
+			"60 GOTO 10\r"
+			"RUN\r";
+}
+
+bool Benchmark::sameRegisters(emu6502& lhs, emu6502& rhs)
+{
+	const CPU& l = lhs.getCPU();
+	const CPU& r = rhs.getCPU();
+	return l.a.getCopy() == r.a.getCopy() and l.x.getCopy() == r.x.getCopy() and l.y.getCopy() == r.y.getCopy()
+		and l.flags.getCopy() == r.flags.getCopy() and l.p.getCopy() == r.p.getCopy() and l.s.getCopy() == r.s.getCopy()
+		and lhs.getCycles() == rhs.getCycles() and lhs.getAddressValue() == rhs.getAddressValue();
+}
+
+bool Benchmark::sameState(emu6502& lhs, emu6502& rhs)
+{
+	return sameRegisters(lhs, rhs) and std::memcmp(lhs.getBus(), rhs.getBus(), 0x10000) == 0;
+}
+
+// Registers are compared after every instruction, the bus at the end of every round of fresh random memory. Random memory is full of
+// stores over the code being run, so it's a good workout for the block cache's invalidation too. The JIT translates every block the first
+// time it's entered and is compared each time it comes back, after the few blocks it can chain through in CHAIN_BUDGET cycles
+bool Benchmark::verifyRandom(QWord instructions)
+{
+	const QWord ROUND = 1000;
+	const QWord CHAIN_BUDGET = 64;
+	std::mt19937 rng(6502);
+	std::unique_ptr<emu6502> lookup(new emu6502());
+	std::unique_ptr<emu6502> fast(new emu6502());
+	std::unique_ptr<emu6502> cached(new emu6502());
+	std::unique_ptr<emu6502> jit(new emu6502());
+	jit->setJit(true, 1);
+	TestDevice devices[4];
+	mapTestPages(*lookup, devices[0]);
+	mapTestPages(*fast, devices[1]);
+	mapTestPages(*cached, devices[2]);
+	mapTestPages(*jit, devices[3]);
+
+	for (QWord done = 0; done < instructions; )
+	{
+		for (size_t i = 0; i < 0x10000; ++i)
+			lookup->getBus()[i] = fast->getBus()[i] = cached->getBus()[i] = jit->getBus()[i] = static_cast<Byte>(rng());
+		cached->invalidateBlocks();
+		jit->invalidateBlocks();
+		Word pc = static_cast<Word>(rng());
+		for (emu6502* cpu : { lookup.get(), fast.get(), cached.get(), jit.get() })
+			cpu->setProgramCounter(pc);
+
+		QWord round = 0;
+		while (round < ROUND)
+		{
+			Word entry = jit->getProgramCounter();
+			RunResult run = jit->executeBlock(CHAIN_BUDGET);
+
+			for (QWord i = 0; i < run.instructions; ++i, ++round)
+			{
+				Word at = lookup->getProgramCounter();
+				Byte opcode = lookup->getBus()[at];
+				lookup->executeLookup();
+				fast->executeSwitch();
+				cached->executeCached();
+
+				for (emu6502* other : { fast.get(), cached.get() })
+					if (!sameRegisters(*lookup, *other))
+					{
+						std::cout << "Cores disagree after opcode " << std::hex << (int)opcode << " at " << at << std::dec << '\n';
+						printDisagreement(*lookup, other == fast.get() ? "switch" : "cached", *other);
+						return false;
+					}
+			}
+
+			if (!sameRegisters(*lookup, *jit))
+			{
+				std::cout << "JIT disagrees after " << run.instructions << " instructions from " << std::hex << entry << std::dec << '\n';
+				printDisagreement(*lookup, "jit", *jit);
+				return false;
+			}
+		}
+		done += round;
+
+		for (emu6502* other : { fast.get(), cached.get(), jit.get() })
+			if (!sameState(*lookup, *other))
+			{
+				std::cout << "Cores disagree on memory after a round of random instructions\n";
+				printDisagreement(*lookup, other == fast.get() ? "switch" : other == cached.get() ? "cached" : "jit", *other);
+				return false;
+			}
+		for (int i = 1; i < 4; ++i)
+			if (!(devices[0] == devices[i]))
+			{
+				std::cout << "Cores disagree on the device after a round of random instructions (" << devices[0].reads << " reads and "
+						  << devices[0].writes << " writes, the " << (i == 1 ? "switch" : i == 2 ? "cached" : "jit") << " core made "
+						  << devices[i].reads << " and " << devices[i].writes << ")\n";
+				return false;
+			}
+	}
+	const BlockCacheStats& blocks = cached->getBlockCacheStats();
+	std::cout << "verify: " << instructions << " random instructions, cores agree (block cache: " << blocks.hits << " hits, "
+			  << blocks.misses << " misses, " << blocks.invalidations << " invalidations, jit: "
+			  << jit->getBlockCacheStats().compiled << " blocks translated, device: " << devices[0].reads << " reads, " << devices[0].writes << " writes)\n";
+	return true;
+}
+
+// The lookup core is stepped through as many instructions as each slice says it ran, which have to add up to the cycles it says they took.
+// A slice must not run past a BRK or a breakpoint and has to have stopped for the reason it gives
+bool Benchmark::verifySlices(QWord instructions)
+{
+	const int SLICES = 20;
+	std::mt19937 rng(1976);
+	std::unique_ptr<emu6502> lookup(new emu6502());
+	std::unique_ptr<emu6502> sliced(new emu6502());
+	sliced->setJit(true, 1);
+	TestDevice devices[2];
+	mapTestPages(*lookup, devices[0]);
+	mapTestPages(*sliced, devices[1]);
+	QWord stops[5] = {};
+	QWord slices = 0;
+	QWord dirtyPages = 0, changedPages = 0;
+
+	for (QWord done = 0; done < instructions; )
+	{
+		for (size_t i = 0; i < 0x10000; ++i)
+			lookup->getBus()[i] = sliced->getBus()[i] = static_cast<Byte>(rng());
+		sliced->invalidateBlocks();
+		Word pc = static_cast<Word>(rng());
+		lookup->setProgramCounter(pc);
+		sliced->setProgramCounter(pc);
+
+		// A quarter of the rounds start on the delay loops with random counts, for run_cycles to fast forward through
+		if (rng() % 4 == 0)
+			for (Word i = 0; i < sizeof(DELAY_KERNEL); ++i)
+			{
+				Byte val = (i == 1 or i == 3 or i == 11 or i == 13) ? static_cast<Byte>(rng()) : DELAY_KERNEL[i];
+				lookup->getBus()[static_cast<Word>(pc + i)] = sliced->getBus()[static_cast<Word>(pc + i)] = val;
+			}
+		std::vector<Byte> before(sliced->getBus(), sliced->getBus() + 0x10000);
+		sliced->clearDirtyPages();
+
+		// Breakpoints make the slice go an instruction at a time, so half the rounds leave them out to give the JIT a go
+		std::vector<Word> breakpoints;
+		sliced->clearBreakpoints();
+		if (rng() & 1)
+			for (int i = 0; i < 4; ++i)
+			{
+				breakpoints.push_back(static_cast<Word>(pc + rng() % 64));
+				sliced->setBreakpoint(breakpoints.back());
+			}
+		auto isBreakpoint = [&](Word addr) { return std::find(breakpoints.begin(), breakpoints.end(), addr) != breakpoints.end(); };
+
+		for (int slice = 0; slice < SLICES; ++slice, ++slices)
+		{
+			QWord budget = 1 + rng() % 400;
+			bool until = slice % 4 == 3;
+			RunResult result = until ? sliced->run_until([](const emu6502& cpu) { return cpu.getCPU().a.getCopy() == 0; }, budget)
+									 : sliced->run_cycles(budget);
+			++stops[static_cast<int>(result.stop)];
+
+			QWord cycles = 0;
+			Byte opcode = 0;
+			for (QWord i = 0; i < result.instructions; ++i)
+			{
+				Word at = lookup->getProgramCounter();
+				if (i != 0 and (opcode == 0x00 or isBreakpoint(at)))
+				{
+					std::cout << "Slice ran past a " << (opcode == 0x00 ? "BRK" : "breakpoint") << " at " << std::hex << at << std::dec << '\n';
+					return false;
+				}
+				opcode = lookup->getBus()[at];
+				cycles += lookup->executeLookup();
+			}
+			done += result.instructions;
+
+			bool reason = true;
+			switch (result.stop)
+			{
+			case Stop::BUDGET:		reason = result.cycles >= budget;								break;
+			case Stop::BREAKPOINT:	reason = isBreakpoint(lookup->getProgramCounter());				break;
+			case Stop::INTERRUPT:	reason = opcode == 0x00;										break;
+			case Stop::CONDITION:	reason = until and lookup->getCPU().a.getCopy() == 0;			break;
+			case Stop::MMIO:		break;
+			}
+
+			if (cycles != result.cycles or !reason or !sameRegisters(*lookup, *sliced))
+			{
+				std::cout << "Slice of " << budget << " cycles came back with " << result.instructions << " instructions, " << result.cycles
+						  << " cycles, stop " << static_cast<int>(result.stop) << ", the lookup core took " << cycles << " cycles\n";
+				printDisagreement(*lookup, "sliced", *sliced);
+				return false;
+			}
+		}
+
+		if (!sameState(*lookup, *sliced) or !(devices[0] == devices[1]))
+		{
+			std::cout << "Slices disagree on memory after a round of random instructions\n";
+			printDisagreement(*lookup, "sliced", *sliced);
+			return false;
+		}
+
+		// Every page that changed has to be dirty, one that was written with what it already held can be too
+		for (size_t page = 0; page < 256; ++page)
+		{
+			bool changed = std::memcmp(before.data() + page * 0x100, sliced->getBus() + page * 0x100, 0x100) != 0;
+			if (changed and !sliced->isPageDirty(static_cast<Byte>(page)))
+			{
+				std::cout << "Page " << std::hex << page << std::dec << " changed without being marked dirty\n";
+				return false;
+			}
+			dirtyPages += sliced->isPageDirty(static_cast<Byte>(page)) ? 1 : 0;
+			changedPages += changed ? 1 : 0;
+		}
+	}
+	QWord skips = 0;
+	for (const auto& loop : sliced->getLoopSkipStats()) skips += loop.second.hits;
+	std::cout << "verify: " << slices << " slices agree (stopped for budget " << stops[0] << ", mmio " << stops[1] << ", breakpoint "
+			  << stops[2] << ", interrupt " << stops[3] << ", condition " << stops[4] << ", delay loops fast forwarded " << skips << ")\n";
+	std::cout << "verify: every changed page was dirty (" << changedPages << " changed, " << dirtyPages << " dirty)\n";
+	return true;
+}
+
+// The interpreters are stepped through whatever the JIT just ran and compared with it every time it comes back, which is after at least
+// CHAIN_BUDGET cycles if it stays in translated code
+bool Benchmark::verifyWorkload(const std::string& workload, QWord instructions)
+{
+	const QWord CHAIN_BUDGET = 1000;
+	std::unique_ptr<emu6502> lookup(new emu6502());
+	std::unique_ptr<emu6502> fast(new emu6502());
+	std::unique_ptr<emu6502> cached(new emu6502());
+	std::unique_ptr<emu6502> jit(new emu6502());
+	if (!setUpWorkload(*lookup, workload) or !setUpWorkload(*fast, workload) or !setUpWorkload(*cached, workload)
+		or !setUpWorkload(*jit, workload)) return false;
+	jit->setJit(true, 1);
+
+	Terminal lookupTerminal(workloadKeys(workload), workload == "wozmon");
+	Terminal fastTerminal(workloadKeys(workload), workload == "wozmon");
+	Terminal cachedTerminal(workloadKeys(workload), workload == "wozmon");
+	Terminal jitTerminal(workloadKeys(workload), workload == "wozmon");
+	lookupTerminal.attach(*lookup);
+	fastTerminal.attach(*fast);
+	cachedTerminal.attach(*cached);
+	jitTerminal.attach(*jit);
+
+	for (QWord i = 0; i < instructions; )
+	{
+		RunResult run = jit->executeBlock(CHAIN_BUDGET);
+
+		for (QWord n = 0; n < run.instructions; ++n, ++i)
+		{
+			lookup->executeLookup();
+			fast->executeSwitch();
+			cached->executeCached();
+
+			for (emu6502* other : { fast.get(), cached.get() })
+				if (lookup->getProgramCounter() != other->getProgramCounter() or ((i & 0xFFFF) == 0 and !sameState(*lookup, *other)))
+				{
+					std::cout << "\tcores disagree after " << i << " instructions\n";
+					printDisagreement(*lookup, other == fast.get() ? "switch" : "cached", *other);
+					return false;
+				}
+		}
+
+		if (!sameRegisters(*lookup, *jit))
+		{
+			std::cout << "\tjit disagrees after " << i << " instructions\n";
+			printDisagreement(*lookup, "jit", *jit);
+			return false;
+		}
+	}
+
+	bool same = sameState(*lookup, *fast) and sameState(*lookup, *cached) and sameState(*lookup, *jit)
+			and lookupTerminal.output() == fastTerminal.output() and lookupTerminal.output() == cachedTerminal.output()
+			and lookupTerminal.output() == jitTerminal.output();
+	std::cout << '\t' << (same ? "lockstep: cores agree" : "lockstep: final state differs") << '\n';
+	return same;
+}
+
+// Basic is run for half the instructions and saved, then the snapshot is loaded into a new machine and both run the other half. They have
+// to finish in the same state having displayed the same thing since. The save and load are timed over a few hundred goes
+bool Benchmark::verifySnapshot(QWord instructions)
+{
+	std::unique_ptr<emu6502> original(new emu6502());
+	std::unique_ptr<emu6502> restored(new emu6502());
+	if (!setUpWorkload(*original, "basic") or !setUpWorkload(*restored, "basic")) return false;
+	Terminal originalTerminal(workloadKeys("basic"), false);
+	originalTerminal.attach(*original);
+
+	QWord ran = 0;
+	while (ran < instructions / 2) ran += original->run_cycles(RUN_SLICE_CYCLES).instructions;
+
+	Snapshot::Machine machine;
+	machine.cpu = original->getCPU();
+	machine.pia = originalTerminal.pia().getState();
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < SNAPSHOT_ROUNDS; ++i)
+		if (Snapshot::save(SNAPSHOT_FILE, machine, original->getBus()) != Snapshot::Result::OK)
+		{
+			std::cout << "snapshot: couldn't write " << SNAPSHOT_FILE << '\n';
+			return false;
+		}
+	double saveSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / SNAPSHOT_ROUNDS;
+
+	Terminal restoredTerminal(originalTerminal.pending(), false);
+	restoredTerminal.attach(*restored);
+	Snapshot::Machine loaded;
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < SNAPSHOT_ROUNDS; ++i)
+		if (Snapshot::load(SNAPSHOT_FILE, loaded, restored->getBus()) != Snapshot::Result::OK)
+		{
+			std::cout << "snapshot: couldn't read back " << SNAPSHOT_FILE << '\n';
+			return false;
+		}
+	double loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / SNAPSHOT_ROUNDS;
+	std::remove(SNAPSHOT_FILE);
+
+	restored->setCPU(loaded.cpu);
+	restored->invalidateBlocks();
+	restoredTerminal.pia().setState(loaded.pia);
+	const size_t shown = originalTerminal.output().size();
+
+	QWord originalCycles = 0, restoredCycles = 0;
+	for (QWord done = 0; done < instructions - instructions / 2; )
+	{
+		RunResult slice = original->run_cycles(RUN_SLICE_CYCLES);
+		done += slice.instructions;
+		originalCycles += slice.cycles;
+		restoredCycles += restored->run_cycles(RUN_SLICE_CYCLES).cycles;
+	}
+
+	bool same = originalCycles == restoredCycles and sameState(*original, *restored)
+			and originalTerminal.output().substr(shown) == restoredTerminal.output();
+	std::cout << "snapshot: save " << std::fixed << std::setprecision(1) << saveSeconds * 1e6 << " us, load " << loadSeconds * 1e6
+			  << " us, " << (same ? "the restored machine carried on the same" : "the restored machine went its own way") << '\n';
+	if (!same) printDisagreement(*original, "restored", *restored);
+	return same;
+}
+
+// Basic runs with a checkpoint every REWIND_INTERVAL_MS of cycles and a full copy of the registers and the bus kept alongside each one.
+// Then it's rewound to random checkpoints, checked against the copy, and run on to make new ones over the checkpoints that were dropped
+bool Benchmark::verifyRewind(QWord instructions)
+{
+	struct Copy
+	{
+		CPU				  cpu;
+		std::vector<Byte> bus;
+	};
+
+	const QWord interval = static_cast<QWord>(REWIND_INTERVAL_MS) * APPLE1_CLOCK_HZ / 1000;
+	std::mt19937 rng(6502);
+	std::unique_ptr<emu6502> cpu(new emu6502());
+	if (!setUpWorkload(*cpu, "basic")) return false;
+	Terminal terminal(workloadKeys("basic"), true);
+	terminal.attach(*cpu);
+
+	Rewind rewind;
+	std::deque<Copy> copies;										// the oldest first, the same checkpoints as the ring
+	QWord cycles = 0, next = 0;
+	auto runFor = [&](QWord count)
+	{
+		for (QWord done = 0; done < count; )
+		{
+			RunResult slice = cpu->run_cycles(RUN_SLICE_CYCLES);
+			done += slice.instructions;
+			cycles += slice.cycles;
+			if (cycles < next) continue;
+
+			Snapshot::Machine machine;
+			machine.cpu = cpu->getCPU();
+			rewind.capture(*cpu, machine, cycles);
+			copies.push_back({ machine.cpu, std::vector<Byte>(cpu->getBus(), cpu->getBus() + 0x10000) });
+			while (copies.size() > rewind.size()) copies.pop_front();
+			next = cycles + interval;
+		}
+	};
+	auto sameCPU = [](const CPU& lhs, const CPU& rhs)
+	{
+		return lhs.a.getCopy() == rhs.a.getCopy() and lhs.x.getCopy() == rhs.x.getCopy() and lhs.y.getCopy() == rhs.y.getCopy()
+			and lhs.flags.getCopy() == rhs.flags.getCopy() and lhs.p.getCopy() == rhs.p.getCopy() and lhs.s.getCopy() == rhs.s.getCopy();
+	};
+
+	// A ring of three wrapped twice over with a page written before each capture. Going back to the oldest has to undo the two writes
+	// since, and only the oldest two checkpoints' pages are still kept
+	{
+		std::unique_ptr<emu6502> small(new emu6502());
+		if (!setUpWorkload(*small, "basic")) return false;
+		Rewind ring(3);
+		std::vector<Byte> oldest;
+		for (Byte i = 0; i < 6; ++i)
+		{
+			const Word page = static_cast<Word>((0x10 + i) << 8);
+			small->getBus()[page] = static_cast<Byte>(i + 1);
+			small->invalidateBlocks(page, static_cast<Word>(page + 0xFF));
+			Snapshot::Machine machine;
+			machine.cpu = small->getCPU();
+			ring.capture(*small, machine, i);
+			if (i == 3) oldest.assign(small->getBus(), small->getBus() + 0x10000);
+		}
+		const size_t kept = ring.getStats().bytes;
+		Snapshot::Machine machine;
+		if (ring.size() != 3 or kept != 0x10000 + 2 * 0x100 or !ring.restore(*small, ring.size() - 1, machine)
+			or std::memcmp(small->getBus(), oldest.data(), 0x10000) != 0)
+		{
+			std::cout << "rewind: a ring that wrapped didn't go back to its oldest checkpoint (" << ring.size() << " kept in " << kept
+					  << " bytes)\n";
+			return false;
+		}
+	}
+
+	runFor(instructions);
+	const Rewind::Stats stats = rewind.getStats();
+
+	double restoreSeconds = 0.0;
+	QWord restored = 0;
+	for (int round = 0; round < REWIND_ROUNDS; ++round)
+	{
+		size_t back = std::uniform_int_distribution<size_t>(0, rewind.size() - 1)(rng);
+		Snapshot::Machine machine;
+		auto start = std::chrono::steady_clock::now();
+		if (!rewind.restore(*cpu, back, machine))
+		{
+			std::cout << "rewind: couldn't go back " << back << " of " << rewind.size() << '\n';
+			return false;
+		}
+		restoreSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		restored += back;
+
+		copies.resize(copies.size() - back);
+		const Copy& copy = copies.back();
+		if (!sameCPU(cpu->getCPU(), copy.cpu) or !sameCPU(machine.cpu, copy.cpu) or std::memcmp(cpu->getBus(), copy.bus.data(), 0x10000) != 0)
+		{
+			std::cout << "rewind: going back " << back << " checkpoints didn't give the machine that was there, round " << round << '\n';
+			return false;
+		}
+		cycles = rewind.getCycle(0);
+		next = cycles + interval;
+		runFor(instructions / REWIND_ROUNDS);
+	}
+
+	const double emulated = static_cast<double>(stats.cycles) / APPLE1_CLOCK_HZ;
+	std::cout << std::fixed << std::setprecision(1) << "rewind: " << stats.checkpoints << " checkpoints over "
+			  << static_cast<double>(stats.span) / APPLE1_CLOCK_HZ << "s in " << stats.bytes / 1024 << " KiB, "
+			  << std::setprecision(2) << static_cast<double>(stats.pages) / stats.captures << " pages and "
+			  << stats.seconds * 1e6 / stats.captures << " us a capture, " << stats.seconds * 1e6 / emulated << " us an emulated second\n"
+			  << "rewind: " << REWIND_ROUNDS << " restores back " << static_cast<double>(restored) / REWIND_ROUNDS << " checkpoints on average, "
+			  << restoreSeconds * 1e6 / REWIND_ROUNDS << " us each, every one matched the machine at its checkpoint\n";
+	return true;
+}
+
+// Each rom is loaded by RomLoader and the old stream loader into two images of the bus, which have to match, and both are timed. Then
+// the cases the roms don't have: addresses, Intel HEX, a bad checksum and runs off the end of the bus
+bool Benchmark::verifyRoms(QWord rounds)
+{
+	std::vector<Byte> loaded(0x10000), streamed(0x10000);
+	std::vector<RomLoader::Span> spans;
+	bool ok = true;
+
+	std::cout << std::left << std::setw(32) << "rom" << std::right << std::setw(8) << "bytes" << std::setw(14) << "us loaded"
+			  << std::setw(14) << "us streamed" << '\n' << std::fixed;
+	for (const auto& rom : ROMS)
+	{
+		const RomLoader::Format format = rom.binary ? RomLoader::Format::BINARY : RomLoader::Format::TEXT;
+		auto start = std::chrono::steady_clock::now();
+		for (QWord i = 0; i < rounds; ++i)
+			if (RomLoader::load(rom.fname, rom.addr, loaded.data(), spans, format) != RomLoader::Result::OK)
+			{
+				std::cout << rom.fname << ": " << RomLoader::describe(RomLoader::load(rom.fname, rom.addr, loaded.data(), spans, format))
+						  << ", run from the directory containing roms/\n";
+				return false;
+			}
+		double loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+		start = std::chrono::steady_clock::now();
+		for (QWord i = 0; i < rounds; ++i) streamLoad(rom.fname, rom.addr, rom.binary, streamed.data());
+		double streamSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+		const size_t bytes = spans.empty() ? 0 : spans[0].length;
+		const bool same = spans.size() == 1 and spans[0].start == rom.addr and loaded == streamed;
+		std::cout << std::left << std::setw(32) << rom.fname << std::right << std::setw(8) << bytes << std::setprecision(1)
+				  << std::setw(14) << loadSeconds * 1e6 << std::setw(14) << streamSeconds * 1e6 << (same ? "" : "  differs") << '\n';
+		ok = same and ok;
+	}
+
+	auto check = [&](const char* name, const std::string& text, Word addr, RomLoader::Result expected, std::vector<std::pair<Word, Byte>> bytes)
+	{
+		std::fill(loaded.begin(), loaded.end(), 0);
+		RomLoader::Result result = RomLoader::parse(reinterpret_cast<const Byte*>(text.data()), text.size(), addr, loaded.data(), spans);
+		bool same = result == expected;
+		for (const auto& byte : bytes) same = same and loaded[byte.first] == byte.second;
+		if (!same) std::cout << "roms: " << name << " came back " << RomLoader::describe(result) << " or put the wrong bytes in\n";
+		ok = same and ok;
+	};
+	check("wozmon addresses", "0300: A9 00\r\n0310: 0xEA,0xEA\n12", 0x1000, RomLoader::Result::OK,
+		  { { 0x0300, 0xA9 }, { 0x0301, 0x00 }, { 0x0310, 0xEA }, { 0x0311, 0xEA }, { 0x0312, 0x12 }, { 0x1000, 0x00 } });
+	check("leading bytes", "11 22\nFFFE: 33", 0x2000, RomLoader::Result::OK, { { 0x2000, 0x11 }, { 0x2001, 0x22 }, { 0xFFFE, 0x33 } });
+	check("three digit byte", "E000: 123", 0, RomLoader::Result::BAD_TEXT, {});
+	check("text past $FFFF", "FFFE: 01 02 03", 0, RomLoader::Result::PAST_END_OF_BUS, { { 0xFFFE, 0x01 }, { 0xFFFF, 0x02 }, { 0x0000, 0x00 } });
+	check("binary past $FFFF", std::string(4, '\xA5'), 0xFFFE, RomLoader::Result::PAST_END_OF_BUS, { { 0xFFFF, 0xA5 }, { 0x0000, 0x00 } });
+	check("intel hex", intelRecord(0x0030, 0, { 0x02, 0x33, 0x7A }) + intelRecord(0xFFFF, 0, { 0x44 }) + intelRecord(0, 1, {}), 0,
+		  RomLoader::Result::OK, { { 0x0030, 0x02 }, { 0x0031, 0x33 }, { 0x0032, 0x7A }, { 0xFFFF, 0x44 } });
+	std::string corrupt = intelRecord(0x0030, 0, { 0x02, 0x33, 0x7A });
+	corrupt[10] = corrupt[10] == '0' ? '1' : '0';
+	check("intel hex checksum", corrupt, 0, RomLoader::Result::BAD_RECORD, { { 0x0030, 0x00 } });
+	check("intel hex past $FFFF", intelRecord(0xFFFE, 0, { 0x01, 0x02, 0x03 }), 0, RomLoader::Result::PAST_END_OF_BUS, { { 0xFFFF, 0x02 } });
+	check("intel hex above 64K", intelRecord(0, 4, { 0x00, 0x01 }) + intelRecord(0, 0, { 0x01 }), 0, RomLoader::Result::PAST_END_OF_BUS,
+		  { { 0x0000, 0x00 } });
+
+	// The sets the function keys use, built once and then copied in. The reset set has to leave memory like loading its files in turn did,
+	// and the built in roms have to be the same as the ones on disk
+	RomSets sets, diskSets;
+	auto start = std::chrono::steady_clock::now();
+	const bool embedded = Apple1::defineRomSets(sets);
+	double defineSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	start = std::chrono::steady_clock::now();
+	const bool disk = Apple1::defineRomSets(diskSets, true);
+	double diskSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (!embedded or !disk)
+	{
+		std::cout << "roms: couldn't build the rom sets, run from the directory containing roms/\n";
+		return false;
+	}
+	std::cout << std::setprecision(1) << "rom sets: built in " << defineSeconds * 1e6 << " us, " << diskSeconds * 1e6
+			  << " us from roms/\n";
+
+	std::unique_ptr<emu6502> applied(new emu6502());
+	std::unique_ptr<emu6502> reloaded(new emu6502());
+	for (const char* name : { ROM_SET_RESET, ROM_SET_BASIC, ROM_SET_ASSEMBLER, ROM_SET_CHECKERS, ROM_SET_FORTH })
+	{
+		start = std::chrono::steady_clock::now();
+		for (QWord i = 0; i < rounds; ++i) sets.apply(name, *applied);
+		double applySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / rounds;
+		std::cout << "\t" << std::left << std::setw(12) << name << std::right << std::setw(8) << sets.find(name)->bytes() << " bytes in "
+				  << sets.find(name)->getSpans().size() << " runs, " << std::setprecision(2) << applySeconds * 1e6 << " us to apply\n";
+	}
+
+	for (const char* name : { ROM_SET_RESET, ROM_SET_BASIC, ROM_SET_ASSEMBLER, ROM_SET_CHECKERS, ROM_SET_FORTH })
+	{
+		std::memset(applied->getBus(), 0, 0x10000);
+		std::memset(reloaded->getBus(), 0, 0x10000);
+		sets.apply(name, *applied);
+		diskSets.apply(name, *reloaded);
+		if (std::memcmp(applied->getBus(), reloaded->getBus(), 0x10000) != 0)
+		{
+			std::cout << "roms: the built in " << name << " set isn't the same as the one from roms/\n";
+			ok = false;
+		}
+	}
+
+	// Cold start is everything from nothing to the wozmon's backslash on the display
+	for (bool fromDisk : { false, true })
+	{
+		start = std::chrono::steady_clock::now();
+		RomSets coldSets;
+		std::unique_ptr<emu6502> cpu(new emu6502());
+		Terminal terminal("", false);
+		terminal.attach(*cpu);
+		Apple1::defineRomSets(coldSets, fromDisk);
+		coldSets.apply(ROM_SET_RESET, *cpu);
+		cpu->reset();
+		QWord cycles = 0;
+		while (terminal.output().find('\\') == std::string::npos and cycles < APPLE1_CLOCK_HZ) cycles += cpu->run_cycles(RUN_SLICE_CYCLES).cycles;
+		double coldSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::cout << "cold start " << (fromDisk ? "from roms/" : findEmbeddedRom(WOZMON_ROM) ? "built in" : "without built in roms") << ": " << std::setprecision(1) << coldSeconds * 1e6
+				  << " us to the wozmon prompt after " << cycles << " cycles\n";
+	}
+
+	std::memset(applied->getBus(), 0, 0x10000);
+	std::memset(reloaded->getBus(), 0, 0x10000);
+	sets.apply(ROM_SET_RESET, *applied);
+	for (const auto& rom : ROMS)
+		if (rom.addr != FORTH_ENTRY and rom.addr != 0x004A and std::string(rom.fname) != CHECKERS_ROM)
+			reloaded->loadRom(rom.fname, rom.addr, rom.binary ? RomLoader::Format::BINARY : RomLoader::Format::TEXT);
+	if (std::memcmp(applied->getBus(), reloaded->getBus(), 0x10000) != 0)
+	{
+		std::cout << "roms: the reset set doesn't match loading its roms one after another\n";
+		ok = false;
+	}
+
+	std::cout << "roms: " << (ok ? "the loader matches the stream loader and handled every case" : "the loader got something wrong") << '\n';
+	return ok;
+}
+
+// Reads the listing back, every line has to start where the one before left off and hold the bytes that are there
+namespace
+{
+	bool listingMatches(const std::string& text, const Byte* memory, Word first, Word last)
+	{
+		DWord expected = first;
+		size_t pos = 0;
+		while (pos < text.size())
+		{
+			size_t end = text.find('\n', pos);
+			if (end == std::string::npos) return false;
+			const std::string line = text.substr(pos, end - pos);
+			pos = end + 1;
+
+			if (line.size() < 6 or std::stoul(line.substr(0, 4), nullptr, 16) != expected) return false;
+			std::vector<Byte> bytes;
+			size_t data = line.find(".BYTE ");
+			if (data != std::string::npos)
+				for (size_t at = line.find('$', data); at != std::string::npos; at = line.find('$', at + 1))
+					bytes.push_back(static_cast<Byte>(std::stoul(line.substr(at + 1, 2), nullptr, 16)));
+			else
+				for (size_t at = 6; at + 1 < line.size() and at < 15 and line[at] != ' '; at += 3)
+					bytes.push_back(static_cast<Byte>(std::stoul(line.substr(at, 2), nullptr, 16)));
+
+			for (Byte byte : bytes)
+				if (expected > last or memory[expected++] != byte) return false;
+			if (bytes.empty()) return false;
+		}
+		return expected == static_cast<DWord>(last) + 1;
+	}
+}
+
+bool Benchmark::verifyDisassembler(QWord rounds)
+{
+	RomSets sets;
+	if (!Apple1::defineRomSets(sets))
+	{
+		std::cout << "disasm: couldn't build the rom sets, run from the directory containing roms/\n";
+		return false;
+	}
+	bool ok = true;
+	Disassembler dis;
+
+	std::cout << std::left << std::setw(12) << "set" << std::right << std::setw(8) << "bytes" << std::setw(8) << "code" << std::setw(8)
+			  << "lines" << std::setw(12) << "us traced" << std::setw(12) << "us listed" << '\n' << std::fixed;
+	const struct { const char* set; Word entry; } SETS[] =
+	{
+		{ ROM_SET_RESET,	WOZMON_ENTRY },
+		{ ROM_SET_BASIC,	BASIC_ENTRY },
+		{ ROM_SET_FORTH,	FORTH_ENTRY }
+	};
+	for (const auto& set : SETS)
+	{
+		const RomSet* roms = sets.find(set.set);
+		for (const RomLoader::Span& span : roms->getSpans())
+		{
+			if (set.entry < span.start or set.entry >= span.start + span.length) continue;
+			const Word last = static_cast<Word>(span.start + span.length - 1);
+
+			size_t code = 0;
+			double traceSeconds = 0.0, listSeconds = 0.0;
+			for (QWord i = 0; i < rounds; ++i)
+			{
+				auto start = std::chrono::steady_clock::now();
+				dis.reset(roms->getImage(), span.start, last);
+				dis.addEntry(set.entry);
+				dis.addVectors();
+				code = dis.trace();
+				auto traced = std::chrono::steady_clock::now();
+				dis.listing();
+				traceSeconds += std::chrono::duration<double>(traced - start).count();
+				listSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - traced).count();
+			}
+			const std::string& text = dis.listing();
+			const bool same = listingMatches(text, roms->getImage(), span.start, last);
+			std::cout << std::left << std::setw(12) << set.set << std::right << std::setw(8) << span.length << std::setw(8) << code
+					  << std::setw(8) << std::count(text.begin(), text.end(), '\n') << std::setprecision(1) << std::setw(12)
+					  << traceSeconds / rounds * 1e6 << std::setw(12) << listSeconds / rounds * 1e6 << (same ? "" : "  listing differs") << '\n';
+			ok = same and ok;
+		}
+	}
+
+	// A few instructions in each addressing mode
+	const struct { Byte bytes[3]; Word addr; const char* text; } INSTRUCTIONS[] =
+	{
+		{ { 0xA9, 0x8D }, 0x0300, "LDA #$8D" },				{ { 0x8D, 0x12, 0xD0 }, 0x0300, "STA $D012" },
+		{ { 0x10, 0xFB }, 0xFF2B, "BPL $FF28" },			{ { 0xB1, 0x24 }, 0x0300, "LDA ($24),Y" },
+		{ { 0xA1, 0x24 }, 0x0300, "LDA ($24,X)" },			{ { 0x6C, 0xFC, 0xFF }, 0x0300, "JMP ($FFFC)" },
+		{ { 0x0A }, 0x0300, "ASL A" },						{ { 0xB6, 0x10 }, 0x0300, "LDX $10,Y" },
+		{ { 0xDD, 0x00, 0x02 }, 0x0300, "CMP $0200,X" },	{ { 0xE8 }, 0x0300, "INX" }
+	};
+	for (const auto& instruction : INSTRUCTIONS)
+	{
+		char text[16];
+		const std::string formatted(text, Disassembler::format(text, instruction.addr, instruction.bytes));
+		if (formatted != instruction.text)
+		{
+			std::cout << "disasm: " << instruction.text << " came out as " << formatted << '\n';
+			ok = false;
+		}
+	}
+
+	// Straight off a machine's bus, which has to be left exactly like its twin's
+	std::unique_ptr<emu6502> cpu(new emu6502()), twin(new emu6502());
+	Apple1::setUpMachine(*cpu);
+	Apple1::setUpMachine(*twin);
+	dis.reset(cpu->getBus(), 0x0000, 0xFFFF);
+	dis.addVectors();
+	dis.trace();
+	dis.listing();
+	if (!sameState(*cpu, *twin))
+	{
+		std::cout << "disasm: disassembling the bus changed the machine\n";
+		ok = false;
+	}
+	if ((dis.getFlags(WOZMON_ENTRY) & Disassembler::ENTRY) == 0 or (dis.getFlags(0xFFEF) & Disassembler::SUBROUTINE) == 0)
+	{
+		std::cout << "disasm: the wozmon's reset and ECHO weren't found from the vectors\n";
+		ok = false;
+	}
+
+	std::cout << "disasm: " << (ok ? "every listing reads back as the rom and the machine was left alone" : "something came out wrong") << '\n';
+	return ok;
+}
+
+// Basic runs in slices untraced, traced with the drain thread and traced with the cpu draining the ring itself. Then the first trace is
+// read back and checked instruction by instruction against another machine stepping through the same run
+bool Benchmark::verifyTrace(QWord instructions)
+{
+	struct Run
+	{
+		double	seconds = 0.0;
+		QWord	instructions = 0;
+		Trace::Stats stats;
+	};
+	auto runBasic = [&](Trace* trace, bool background, const char* fname)
+	{
+		Run run;
+		std::unique_ptr<emu6502> cpu(new emu6502());
+		if (!setUpWorkload(*cpu, "basic")) return run;
+		Terminal terminal(workloadKeys("basic"), true);
+		terminal.attach(*cpu);
+		if (trace != nullptr and !trace->start(fname, background)) return run;
+		cpu->setTrace(trace);
+
+		auto start = std::chrono::steady_clock::now();
+		while (run.instructions < instructions) run.instructions += cpu->run_cycles(RUN_SLICE_CYCLES).instructions;
+		cpu->setTrace(nullptr);
+		if (trace != nullptr) trace->stop();
+		run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (trace != nullptr) run.stats = trace->getStats();
+		return run;
+	};
+
+	std::unique_ptr<Trace> trace(new Trace());
+	const Run off = runBasic(nullptr, false, nullptr);
+	const Run threaded = runBasic(trace.get(), true, TRACE_FILES[0]);
+	const Run drained = runBasic(trace.get(), false, TRACE_FILES[1]);
+	std::remove(TRACE_FILES[1]);
+	if (off.instructions == 0 or threaded.instructions == 0 or drained.instructions == 0)
+	{
+		std::cout << "trace: couldn't set up basic or write " << TRACE_FILES[0] << '\n';
+		return false;
+	}
+
+	std::cout << std::fixed << std::setprecision(2);
+	for (const auto& row : { std::make_pair("off", &off), std::make_pair("thread", &threaded), std::make_pair("drained", &drained) })
+	{
+		const Run& run = *row.second;
+		std::cout << "trace " << std::left << std::setw(8) << row.first << std::right << std::setw(12) << run.instructions << " instructions "
+				  << std::setw(8) << run.seconds * 1e9 / run.instructions << " ns/instr";
+		if (run.stats.records != 0)
+			std::cout << ", " << run.stats.bytes / 1024 << " KiB, " << static_cast<double>(run.stats.bytes) / run.stats.records
+					  << " bytes a record, " << run.stats.stalls << " stalls";
+		std::cout << '\n';
+	}
+
+	bool ok = threaded.stats.records == threaded.instructions and drained.stats.records == drained.instructions;
+	if (!ok) std::cout << "trace: records went missing\n";
+
+	// Every record has to be the machine just before the instruction it's for
+	MappedFile file(TRACE_FILES[0]);
+	std::unique_ptr<emu6502> twin(new emu6502());
+	setUpWorkload(*twin, "basic");
+	Terminal terminal(workloadKeys("basic"), true);
+	terminal.attach(*twin);
+
+	TraceRecord previous, record;
+	QWord checked = 0, cycle = 0;
+	for (size_t pos = 12; ok and pos < file.size(); ++checked)
+	{
+		const size_t used = Trace::decode(file.data() + pos, file.size() - pos, previous, record);
+		const CPU& cpu = twin->getCPU();
+		if (used == 0 or record.pc != cpu.p.getCopy() or record.a != cpu.a.getCopy() or record.x != cpu.x.getCopy()
+			or record.y != cpu.y.getCopy() or record.p != cpu.flags.getCopy() or record.s != static_cast<Byte>(cpu.s.getCopy())
+			or record.cycle != cycle or record.opcode != twin->getBus()[record.pc])
+		{
+			std::cout << "trace: record " << checked << " isn't the machine it was taken from\n";
+			ok = false;
+			break;
+		}
+		cycle += twin->fetch_and_execute();
+		if (record.cycles != cycle - record.cycle or record.address != static_cast<Word>(twin->getAddressValue()))
+		{
+			std::cout << "trace: record " << checked << " has the wrong cycles or effective address\n";
+			ok = false;
+		}
+		previous = record;
+		pos += used;
+	}
+	std::remove(TRACE_FILES[0]);
+
+	// Coding has to give back exactly what went in, whatever changed between records
+	std::mt19937 rng(6502);
+	Byte coded[32];
+	previous = TraceRecord();
+	for (int i = 0; ok and i < 100000; ++i)
+	{
+		TraceRecord random;
+		random.cycle = (i & 7) == 0 ? rng() * static_cast<QWord>(rng()) : previous.cycle + previous.cycles;
+		random.pc = (i & 3) == 0 ? static_cast<Word>(rng()) : static_cast<Word>(previous.pc + 1 + operandBytes(OPCODES[previous.opcode].mode));
+		random.opcode = static_cast<Byte>(rng());
+		const Byte operands = operandBytes(OPCODES[random.opcode].mode);
+		if (operands > 0) random.operand[0] = static_cast<Byte>(rng());
+		if (operands > 1) random.operand[1] = static_cast<Byte>(rng());
+		random.address = static_cast<Word>(rng());
+		random.a = (i & 1) ? previous.a : static_cast<Byte>(rng());
+		random.x = static_cast<Byte>(rng());
+		random.y = previous.y;
+		random.p = static_cast<Byte>(rng());
+		random.s = static_cast<Byte>(rng());
+		random.cycles = static_cast<Byte>(rng());
+
+		const size_t size = Trace::encode(random, previous, coded);
+		if (size > sizeof(coded) or Trace::decode(coded, size, previous, record) != size or std::memcmp(&record, &random, sizeof(record)) != 0
+			or Trace::decode(coded, size - 1, previous, record) != 0)
+		{
+			std::cout << "trace: record " << i << " didn't come back the same after coding\n";
+			ok = false;
+		}
+		previous = random;
+	}
+
+	std::cout << "trace: " << (ok ? "checked " + std::to_string(checked) + " records against the machine and the coding round trips" : "something came out wrong") << '\n';
+	return ok;
+}
+
+// Basic runs in slices without the profiler and with it, then another machine steps through the same run counting every instruction itself
+// and every address has to have the same counts. The symbol files are read back and a broken one has to be turned down
+bool Benchmark::verifyProfiler(QWord instructions)
+{
+	std::unique_ptr<Profiler> profiler(new Profiler());
+	QWord profiledCycles = 0;
+	auto runBasic = [&](Profiler* counting)
+	{
+		std::unique_ptr<emu6502> cpu(new emu6502());
+		if (!setUpWorkload(*cpu, "basic")) return 0.0;
+		Terminal terminal(workloadKeys("basic"), true);
+		terminal.attach(*cpu);
+		cpu->setProfiler(counting);
+
+		QWord ran = 0, cycles = 0;
+		auto start = std::chrono::steady_clock::now();
+		while (ran < instructions)
+		{
+			RunResult slice = cpu->run_cycles(RUN_SLICE_CYCLES);
+			ran += slice.instructions;
+			cycles += slice.cycles;
+		}
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (counting != nullptr) profiledCycles = cycles;
+		return seconds * 1e9 / ran;
+	};
+
+	const double off = runBasic(nullptr);
+	const double on = runBasic(profiler.get());
+	if (off == 0.0 or on == 0.0)
+	{
+		std::cout << "profile: couldn't set up basic\n";
+		return false;
+	}
+	std::cout << std::fixed << std::setprecision(2) << "profile off " << std::setw(8) << off << " ns/instr\nprofile on  " << std::setw(8) << on
+			  << " ns/instr\n";
+
+	// The same run stepped through, so it's the same instructions whatever the slices stopped for
+	std::unique_ptr<emu6502> twin(new emu6502());
+	setUpWorkload(*twin, "basic");
+	Terminal terminal(workloadKeys("basic"), true);
+	terminal.attach(*twin);
+	std::vector<QWord> executions(0x10000), cycles(0x10000);
+	QWord stepped = 0;
+	while (stepped < profiledCycles)
+	{
+		const Word pc = twin->getProgramCounter();
+		twin->fetch_and_execute();
+		++executions[pc];
+		cycles[pc] += twin->getCycles();
+		stepped += twin->getCycles();
+	}
+
+	bool ok = stepped == profiledCycles;
+	for (DWord addr = 0; ok and addr < 0x10000; ++addr)
+		if (profiler->getExecutions(static_cast<Word>(addr)) != executions[addr] or profiler->getCycles(static_cast<Word>(addr)) != cycles[addr])
+		{
+			std::cout << "profile: $" << std::hex << std::uppercase << addr << std::dec << " has the wrong counts\n";
+			ok = false;
+		}
+
+	// Names are exact or the one before plus an offset, and a file with a line that isn't an address and a name is refused
+	Symbols names;
+	const bool symbols = names.load("roms/wozmon1.sym") and names.load("roms/basic.sym") and names.load("roms/a1asm.sym");
+	if (!symbols or names.describe(0xFFEF) != "ECHO" or names.describe(0xFFF4) != "ECHO+5" or names.describe(0x0300) != "$0300")
+	{
+		std::cout << "profile: the symbols in roms/ didn't load or don't name the wozmon\n";
+		ok = false;
+	}
+	std::ofstream(PROFILE_SYMBOLS) << "FFEF ECHO ; fine\nFFDC PRBYTE PRHEX\n";
+	if (names.load(PROFILE_SYMBOLS))
+	{
+		std::cout << "profile: took a symbol file with two names on a line\n";
+		ok = false;
+	}
+	std::remove(PROFILE_SYMBOLS);
+
+	const std::string& report = profiler->report(twin->getBus());
+	std::cout << report.substr(0, report.find('\n') + 1);
+	std::cout << "profile: " << (ok ? "every address counted the same as stepping through" : "something came out wrong") << '\n';
+	return ok;
+}
+
+// Basic runs in slices without the call graph and with it, and every cycle has to end up in some frame. Then the call kernel runs an
+// iteration a slice and each routine has to have exactly the calls and cycles it was written to take, whichever way it returned
+bool Benchmark::verifyCallGraph(QWord instructions)
+{
+	std::unique_ptr<CallGraph> calls(new CallGraph());
+	QWord followedCycles = 0;
+	auto runBasic = [&](CallGraph* following)
+	{
+		std::unique_ptr<emu6502> cpu(new emu6502());
+		if (!setUpWorkload(*cpu, "basic")) return 0.0;
+		Terminal terminal(workloadKeys("basic"), true);
+		terminal.attach(*cpu);
+		cpu->setCallGraph(following);
+
+		QWord ran = 0, cycles = 0;
+		auto start = std::chrono::steady_clock::now();
+		while (ran < instructions)
+		{
+			RunResult slice = cpu->run_cycles(RUN_SLICE_CYCLES);
+			ran += slice.instructions;
+			cycles += slice.cycles;
+		}
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (following != nullptr) followedCycles = cycles;
+		return seconds * 1e9 / ran;
+	};
+
+	const double off = runBasic(nullptr);
+	const double on = runBasic(calls.get());
+	if (off == 0.0 or on == 0.0)
+	{
+		std::cout << "calls: couldn't set up basic\n";
+		return false;
+	}
+	std::cout << std::fixed << std::setprecision(2) << "calls off " << std::setw(8) << off << " ns/instr\ncalls on  " << std::setw(8) << on
+			  << " ns/instr\n";
+
+	bool ok = true;
+	if (calls->getCycles() != followedCycles)
+	{
+		std::cout << "calls: basic ran " << followedCycles << " cycles but the frames have " << calls->getCycles() << '\n';
+		ok = false;
+	}
+	const std::string& report = calls->report();
+	std::cout << report.substr(0, report.find('\n') + 1);
+
+	std::unique_ptr<emu6502> cpu(new emu6502());
+	if (!setUpWorkload(*cpu, "calls")) return false;
+	calls->clear();
+	cpu->setCallGraph(calls.get());
+	for (QWord round = 0; ok and round < CALL_ROUNDS; ++round)
+		if (cpu->run_cycles(CALL_KERNEL_CYCLES).cycles != CALL_KERNEL_CYCLES or calls->getDepth() != 0)
+		{
+			std::cout << "calls: round " << round << " didn't come back to the loop in " << CALL_KERNEL_CYCLES << " cycles\n";
+			ok = false;
+		}
+
+	const struct { Word routine; QWord self; QWord inclusive; } expected[] =
+	{
+		{ 0x030C, 12, 20 }, { 0x0310, 8, 8 }, { 0x0312, 24, 24 }, { 0x031B, 12, 20 }, { 0x031F, 8, 8 }
+	};
+	for (const auto& routine : expected)
+	{
+		const CallGraph::Routine counted = calls->getRoutine(routine.routine);
+		if (counted.calls != CALL_ROUNDS or counted.self != routine.self * CALL_ROUNDS or counted.inclusive != routine.inclusive * CALL_ROUNDS)
+		{
+			std::cout << "calls: $" << std::hex << std::uppercase << routine.routine << std::dec << " counted " << counted.calls << " calls, "
+					  << counted.self << " cycles itself and " << counted.inclusive << " in all\n";
+			ok = false;
+		}
+	}
+
+	// The stacks name what they can and put the dropped return's routine under the one that called it
+	Symbols names;
+	names.add(0x031B, "DROP");
+	names.add(0x031F, "PULL");
+	const std::string stacks = calls->stacks(&names);
+	const std::string pulled = "apple1;DROP;PULL " + std::to_string(8 * CALL_ROUNDS) + "\n";
+	const std::string root = "apple1 " + std::to_string((CALL_KERNEL_CYCLES - 64) * CALL_ROUNDS) + "\n";
+	if (stacks.find(pulled) == std::string::npos or stacks.compare(0, root.size(), root) != 0)
+	{
+		std::cout << "calls: the collapsed stacks came out as\n" << stacks;
+		ok = false;
+	}
+
+	std::cout << "calls: " << (ok ? "every cycle in a frame and the kernel's routines counted exactly" : "something came out wrong") << '\n';
+	return ok;
+}
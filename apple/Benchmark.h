@@ -0,0 +1,81 @@
+#pragma once
+#include <string>
+#include "Bit.h"
+#include "emu6502.h"
+
+/*
+	Headless benchmarks for the interpreter cores. Nothing here touches the console, each machine gets its own pia with the keystrokes
+	fed in from a string and the display captured, so the bundled roms run exactly like they do interactively.
+
+	Apple1 --bench [workload] [instructions]		workload is wozmon, basic, alu, delay or all (default). Times the cores and the jit and checks they agree
+													alu is a flag heavy multiply loop, it and basic are the ones to compare lazy and eager flags on.
+													delay is nested countdown loops, for timing run_cycles with and without loop skipping
+	Apple1 --bench verify [instructions]			runs the cores in lockstep over random memory and compares them after every instruction,
+													the jit translates everything it can right away and is compared after every block.
+													Then checks run_cycles and run_until the same way, slice by slice
+	Apple1 --bench snapshot [instructions]			times saving and loading a snapshot of basic halfway through, and checks the machine it's
+													loaded into carries on exactly like the one it was saved from
+	Apple1 --bench rewind [instructions]			runs basic with rewind checkpoints, then rewinds to random ones and checks each against a full
+													copy taken at the time. Prints what the checkpoints take and what capturing them costs
+	Apple1 --bench roms [rounds]					times loading each rom with RomLoader and with the old stream loader and checks they match,
+													then checks addresses, Intel HEX and loads that run off the end of the bus. Times the rom sets,
+													checks the built in roms match roms/ and times a cold start to the wozmon prompt both ways
+	Apple1 --bench disasm [rounds]					times tracing and listing the wozmon, basic and Forth, reads each listing back to check it has every
+													byte of the rom, checks an instruction in each addressing mode and that disassembling a bus leaves it alone
+	Apple1 --bench trace [instructions]				times basic untraced and traced both ways (Trace.h), checks every record against a machine stepping
+													through the same run and that coding a record gives it back exactly
+	Apple1 --bench profile [instructions]			times basic with and without the profiler (Profiler.h), checks the count at every address against
+													a machine stepping through the same run and that the symbol files in roms/ load
+	Apple1 --bench calls [instructions]				times basic with and without the call graph (CallGraph.h), checks every cycle lands in a frame and
+													that a kernel returning by RTS, a pushed address and PLA PLA gets each routine's cycles exactly
+*/
+
+namespace Emu
+{
+
+class Benchmark
+{
+public:
+	struct Result
+	{
+		QWord		instructions = 0;
+		QWord		cycles		 = 0;
+		double		seconds		 = 0.0;
+		std::string output;							// everything written to the display register
+		BlockCacheStats blocks;
+	};
+
+	static	int					run						(int argc, char* argv[]);
+
+	static	bool				verifyRandom			(QWord instructions);						// Lockstep compare the cores over random memory
+
+	static	bool				verifySlices			(QWord instructions);						// Check run_cycles and run_until against the lookup core over random memory
+
+	static	bool				verifyWorkload			(const std::string& workload,				// Lockstep compare the cores on a rom workload
+														 QWord instructions);
+
+	static	bool				verifySnapshot			(QWord instructions);						// Save basic part way through, load it into another machine and check they carry on the same
+
+	static	bool				verifyRewind			(QWord instructions);						// Rewind basic to random checkpoints and check each is the machine it was
+
+	static	bool				verifyRoms				(QWord rounds);								// Time RomLoader on the roms and check it on the formats they don't use
+
+	static	bool				verifyDisassembler		(QWord rounds);								// Time the disassembler on the roms and check the listings
+
+	static	bool				verifyTrace				(QWord instructions);						// Time tracing basic and check the trace against the run
+
+	static	bool				verifyProfiler			(QWord instructions);						// Time profiling basic and check the counts against the run
+
+	static	bool				verifyCallGraph			(QWord instructions);						// Time following basic's calls and check the call graph on a kernel
+
+	static	bool				setUpWorkload			(emu6502& cpu,								// Apple1::setUpMachine plus whatever else the workload needs in memory
+															 const std::string& workload);
+
+	static	std::string			workloadKeys			(const std::string& workload);				// The keystrokes typed in for a workload
+
+	static	bool				sameRegisters			(emu6502& lhs, emu6502& rhs);				// Compares registers, cycles and m_addrVal
+
+	static	bool				sameState				(emu6502& lhs, emu6502& rhs);				// Compares registers, cycles and the whole bus
+};
+
+}
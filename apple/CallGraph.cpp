@@ -0,0 +1,183 @@
+#include "CallGraph.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+using namespace Emu;
+
+namespace
+{
+	const DWord		ROOT_TOP		= ~DWord(0);
+	const size_t	LINE_CHARS		= 160;
+
+	double percent(QWord part, QWord whole)
+	{
+		return whole == 0 ? 0.0 : 100.0 * static_cast<double>(part) / static_cast<double>(whole);
+	}
+
+	bool writeText(const char* fname, const std::string& text)
+	{
+		if (std::strcmp(fname, "-") == 0)
+		{
+			std::cout.write(text.data(), text.size());
+			return std::cout.good();
+		}
+
+		std::FILE* file = std::fopen(fname, "wb");
+		if (file == nullptr) return false;
+		bool ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+		return std::fclose(file) == 0 and ok;
+	}
+
+	// The exact symbol or the address, an entry point named after the symbol before it would only mislead
+	std::string routineName(Word routine, bool interrupt, const Symbols* symbols)
+	{
+		const std::string* symbol = symbols != nullptr ? symbols->find(routine) : nullptr;
+		char text[8];
+		std::snprintf(text, sizeof(text), "$%04X", routine);
+		std::string name = symbol != nullptr ? *symbol : text;
+		return interrupt ? name + "(interrupt)" : name;
+	}
+}
+
+CallGraph::CallGraph()
+{
+	clear();
+}
+
+void CallGraph::interrupt(Word pc, Word s)
+{
+	call(pc, s + 3, true);
+}
+
+void CallGraph::clear()
+{
+	m_nodes.assign(1, Node{ 0, false, 0, 0, 0 });
+	m_frames.assign(1, Frame{ 0, ROOT_TOP });
+	m_children.clear();
+}
+
+// Only a routine called down a path it hasn't been before makes a node, the rest is one lookup
+void CallGraph::call(Word routine, DWord top, bool interrupt)
+{
+	const size_t parent = m_frames.back().node;
+	const QWord key = (static_cast<QWord>(parent) << 17) | (static_cast<QWord>(interrupt) << 16) | routine;
+	auto child = m_children.find(key);
+	if (child == m_children.end())
+	{
+		child = m_children.emplace(key, m_nodes.size()).first;
+		m_nodes.push_back(Node{ routine, interrupt, parent, 0, 0 });
+	}
+
+	++m_nodes[child->second].calls;
+	if (m_frames.size() > CALL_GRAPH_DEPTH) m_frames.erase(m_frames.begin() + 1);
+	m_frames.push_back(Frame{ child->second, top });
+}
+
+CallGraph::Routine CallGraph::getRoutine(Word addr) const
+{
+	const std::map<Word, Routine> routines = summarise();
+	auto routine = routines.find(addr);
+	return routine == routines.end() ? Routine() : routine->second;
+}
+
+QWord CallGraph::getCycles() const
+{
+	QWord cycles = 0;
+	for (const Node& node : m_nodes) cycles += node.self;
+	return cycles;
+}
+
+size_t CallGraph::getDepth() const
+{
+	return m_frames.size() - 1;
+}
+
+// A parent always comes before its children, so going backwards adds every node's inclusive cycles into its parent's once they're whole.
+// A node only counts towards its routine's inclusive cycles if the routine isn't further up the same path
+std::map<Word, CallGraph::Routine> CallGraph::summarise() const
+{
+	std::vector<QWord> inclusive(m_nodes.size());
+	for (size_t i = m_nodes.size(); i-- > 1;)
+	{
+		inclusive[i] += m_nodes[i].self;
+		inclusive[m_nodes[i].parent] += inclusive[i];
+	}
+
+	std::map<Word, Routine> routines;
+	for (size_t i = 1; i < m_nodes.size(); ++i)
+	{
+		const Node& node = m_nodes[i];
+		Routine& routine = routines[node.routine];
+		routine.calls += node.calls;
+		routine.self += node.self;
+
+		bool outermost = true;
+		for (size_t up = node.parent; up != 0 and outermost; up = m_nodes[up].parent) outermost = m_nodes[up].routine != node.routine;
+		if (outermost) routine.inclusive += inclusive[i];
+	}
+	return routines;
+}
+
+const std::string& CallGraph::report(const Symbols* symbols)
+{
+	m_text.clear();
+	char line[LINE_CHARS];
+
+	const QWord cycles = getCycles();
+	std::map<Word, Routine> summary = summarise();
+	std::vector<std::pair<Word, Routine>> routines(summary.begin(), summary.end());
+	const size_t shown = std::min<size_t>(routines.size(), CALL_GRAPH_ROUTINES);
+	std::partial_sort(routines.begin(), routines.begin() + shown, routines.end(),
+					  [](const std::pair<Word, Routine>& lhs, const std::pair<Word, Routine>& rhs)
+	{
+		return lhs.second.inclusive != rhs.second.inclusive ? lhs.second.inclusive > rhs.second.inclusive : lhs.first < rhs.first;
+	});
+
+	std::snprintf(line, sizeof(line), "%llu cycles, %zu routines called down %zu paths, %llu cycles outside any call\n\n",
+				  static_cast<unsigned long long>(cycles), routines.size(), m_nodes.size() - 1, static_cast<unsigned long long>(m_nodes[0].self));
+	m_text += line;
+	m_text += "routine                     address        calls          self       %       inclusive       %  cycles a call\n";
+	for (size_t i = 0; i < shown; ++i)
+	{
+		const Routine& routine = routines[i].second;
+		std::snprintf(line, sizeof(line), "%-26s  $%04X   %12llu  %12llu  %6.2f  %14llu  %6.2f  %13.1f\n",
+					  routineName(routines[i].first, false, symbols).c_str(), routines[i].first,
+					  static_cast<unsigned long long>(routine.calls), static_cast<unsigned long long>(routine.self), percent(routine.self, cycles),
+					  static_cast<unsigned long long>(routine.inclusive), percent(routine.inclusive, cycles),
+					  routine.calls == 0 ? 0.0 : static_cast<double>(routine.inclusive) / routine.calls);
+		m_text += line;
+	}
+	return m_text;
+}
+
+bool CallGraph::write(const char* fname, const Symbols* symbols)
+{
+	return writeText(fname, report(symbols));
+}
+
+// The format flamegraph.pl and speedscope read: the frames from the root down separated by semicolons, a space and the count. Each
+// node's path is its parent's plus its own name, and the parent's has always been made by then
+const std::string& CallGraph::stacks(const Symbols* symbols)
+{
+	m_text.clear();
+	std::vector<std::string> paths(m_nodes.size());
+	paths[0] = CALL_GRAPH_ROOT;
+	for (size_t i = 1; i < m_nodes.size(); ++i) paths[i] = paths[m_nodes[i].parent] + ';' + routineName(m_nodes[i].routine, m_nodes[i].interrupt, symbols);
+
+	for (size_t i = 0; i < m_nodes.size(); ++i)
+	{
+		if (m_nodes[i].self == 0) continue;
+		m_text += paths[i];
+		m_text += ' ';
+		m_text += std::to_string(m_nodes[i].self);
+		m_text += '\n';
+	}
+	return m_text;
+}
+
+bool CallGraph::writeStacks(const char* fname, const Symbols* symbols)
+{
+	return writeText(fname, stacks(symbols));
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Bit.h"
+#include "Symbols.h"
+
+#define CALL_GRAPH_DEPTH	128					// frames kept, as many return addresses as the stack can hold
+#define CALL_GRAPH_ROUTINES	40					// routines the report ranks
+#define CALL_GRAPH_ROOT		"apple1"			// what the stacks start with, the code that isn't in any call
+
+namespace Emu
+{
+
+/*
+	Which subroutines the time goes to, counting both what runs in each one itself and everything it calls. The cpu tells it about every
+	instruction run_cycles and run_until run (see emu6502::setCallGraph) and it keeps a shadow of the call stack from them:
+
+		a JSR pushes a frame for where it went, a BRK or an irq or nmi pushes one for the handler
+		a frame comes off once the stack pointer is back above the return address it was pushed with
+
+	So it doesn't matter how the return address goes, an RTS or RTI, PLA PLA to drop it or the stack being reset, and an RTS to an address
+	the program pushed itself, the way an interpreter dispatches, doesn't end anything. It's a jump inside the routine that did it. Each
+	instruction's cycles go to the frame on top, and the frames are nodes in a call tree, one for every path a routine was called by:
+
+		cpu.setCallGraph(&calls);					from the next slice on
+		...
+		cpu.setCallGraph(nullptr);
+		calls.write("calls.txt", &symbols);			each routine's calls, self and inclusive cycles, ranked
+		calls.writeStacks("calls.folded", &symbols);	a line for every path, flamegraph.pl calls.folded > calls.svg
+
+	A routine that's on the stack more than once, calling itself, only counts its inclusive cycles for the outermost call. More than
+	CALL_GRAPH_DEPTH frames and the oldest go, whatever's kept the stack that deep has long since lost track of them.
+
+	Apple1 --headless --calls FILE [--stacks FILE] [--symbols FILE]...		see Headless.h
+*/
+class CallGraph
+{
+public:
+	struct Routine
+	{
+		QWord		calls		= 0;
+		QWord		self		= 0;				// cycles run in the routine itself
+		QWord		inclusive	= 0;				// and in everything it called
+	};
+
+						 CallGraph			();
+
+		void			 step				(Byte opcode,								// The cpu thread, after each instruction with its cycles and the
+											 Byte cycles,								// stack pointer and program counter it left
+											 Word s,
+											 Word pc)
+	{
+		m_nodes[m_frames.back().node].self += cycles;
+		if (opcode == 0x20) call(pc, s + 2, false);								// JSR
+		else if (opcode == 0x00) call(pc, s + 3, true);							// BRK
+		else while (s >= m_frames.back().top) m_frames.pop_back();
+	}
+
+		void			 interrupt			(Word pc,									// An irq or nmi was taken, pc is the handler
+											 Word s);
+
+		void			 clear				();											// Back to nothing called and no cycles
+
+		Routine			 getRoutine			(Word addr)							 const;		// Summed over every path it was called by
+
+		QWord			 getCycles			()									 const;		// All of them, in a call or not
+
+		size_t			 getDepth			()									 const;		// Frames on the shadow stack now
+
+		const std::string& report			(const Symbols* symbols = nullptr);			// Kept until the next call
+
+		bool			 write				(const char* fname,							// The report, - for stdout
+											 const Symbols* symbols = nullptr);
+
+		const std::string& stacks			(const Symbols* symbols = nullptr);			// Collapsed stacks, a path and its self cycles a line
+
+		bool			 writeStacks		(const char* fname,
+											 const Symbols* symbols = nullptr);
+
+private:
+	struct Node
+	{
+		Word		routine;
+		bool		interrupt;
+		size_t		parent;
+		QWord		calls;
+		QWord		self;
+	};
+
+	struct Frame
+	{
+		size_t		node;
+		DWord		top;						// the stack pointer once the return address is gone
+	};
+
+		void			 call				(Word routine,
+											 DWord top,
+											 bool interrupt);
+
+		std::map<Word, Routine> summarise	()									 const;
+
+	std::vector<Node>					m_nodes;			// 0 is the root, what runs outside any call. A node's parent is always before it
+	std::vector<Frame>					m_frames;			// the shadow stack, the root's frame never comes off
+	std::unordered_map<QWord, size_t>	m_children;			// by the parent and the routine
+	std::string							m_text;
+};
+
+}
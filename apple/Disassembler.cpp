@@ -0,0 +1,374 @@
+#include "Disassembler.h"
+#include "Opcodes.h"
+#include "emu6502.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+using namespace Emu;
+
+namespace
+{
+	const char		HEX[]			= "0123456789ABCDEF";
+	const DWord		BUS_SIZE		= 0x10000;
+	const size_t	DATA_PER_LINE	= 8;
+	const size_t	LINE_CHARS		= 96;			// the longest line is a full .BYTE one, 61 chars
+
+	char* putHex2(char* out, Byte val)
+	{
+		*out++ = HEX[val >> 4];
+		*out++ = HEX[val & 0xF];
+		return out;
+	}
+
+	char* putHex4(char* out, Word val)
+	{
+		return putHex2(putHex2(out, static_cast<Byte>(val >> 8)), static_cast<Byte>(val));
+	}
+
+	char* putText(char* out, const char* text)
+	{
+		while (*text != '\0') *out++ = *text++;
+		return out;
+	}
+
+	char* pad(char* out, const char* from, size_t width)
+	{
+		while (static_cast<size_t>(out - from) < width) *out++ = ' ';
+		return out;
+	}
+
+	Word operandOf(const OpcodeInfo& op, const Byte* bytes)
+	{
+		switch (operandBytes(op.mode))
+		{
+		case 2:		return static_cast<Word>(bytes[1] | (bytes[2] << 8));
+		case 1:		return bytes[1];
+		default:	return 0;
+		}
+	}
+
+	// Where the operand points, or where the branch goes
+	Word targetOf(const OpcodeInfo& op, Word addr, Word value)
+	{
+		if (op.mode == Address_Mode::REL) return static_cast<Word>(addr + 2 + static_cast<S_Byte>(value));
+		return value;
+	}
+
+	// The undefined opcodes the cores run as NOPs are taken as data too, real code doesn't use them
+	bool isDefined(const OpcodeInfo& op)
+	{
+		return op.mnemonic[0] != '?';
+	}
+
+	Word parseAddress(const std::string& text)
+	{
+		return static_cast<Word>(std::stoul(text[0] == '$' ? text.substr(1) : text, nullptr, 16));
+	}
+}
+
+Disassembler::Disassembler()
+	: m_memory(nullptr), m_first(0), m_last(0), m_flags(new Byte[BUS_SIZE]())
+{
+}
+
+void Disassembler::reset(const Byte* memory, Word first, Word last)
+{
+	m_memory = memory;
+	m_first = first;
+	m_last = last;
+	m_pending.clear();
+	std::memset(m_flags.get(), 0, BUS_SIZE);
+}
+
+RomLoader::Result Disassembler::load(const char* fname, Word addr, RomLoader::Format format)
+{
+	if (!m_image) m_image.reset(new Byte[BUS_SIZE]);
+	std::memset(m_image.get(), 0, BUS_SIZE);									// gaps between the spans list as zeros
+
+	std::vector<RomLoader::Span> spans;
+	RomLoader::Result result = RomLoader::load(fname, addr, m_image.get(), spans, format);
+	if (result != RomLoader::Result::OK) return result;
+	if (spans.empty()) return RomLoader::Result::BAD_TEXT;
+
+	Word first = spans.front().start, last = first;
+	for (const RomLoader::Span& span : spans)
+	{
+		first = std::min(first, span.start);
+		last = std::max<Word>(last, static_cast<Word>(span.start + span.length - 1));
+	}
+	reset(m_image.get(), first, last);
+	return result;
+}
+
+void Disassembler::addEntry(Word addr, Flag kind)
+{
+	if (addr < m_first or addr > m_last) return;
+	m_flags[addr] |= kind;
+	m_pending.push_back(addr);
+}
+
+void Disassembler::addVectors()
+{
+	for (DWord vector = NMI_VECTOR; vector < BUS_SIZE; vector += 2)
+	{
+		if (vector < m_first or vector + 1 > m_last) continue;
+		label(static_cast<Word>(vector), DATA);
+		addEntry(static_cast<Word>(m_memory[vector] | (m_memory[vector + 1] << 8)));
+	}
+}
+
+// A path stops where it runs into one already traced. One that would overlap another instruction's bytes stops short of it, the bytes
+// it was going to use stay whatever they already were
+size_t Disassembler::trace()
+{
+	size_t found = 0;
+	while (!m_pending.empty())
+	{
+		DWord addr = m_pending.back();
+		m_pending.pop_back();
+
+		while (addr >= m_first and addr <= m_last and (m_flags[addr] & (OPCODE | OPERAND)) == 0)
+		{
+			const Byte* bytes = m_memory + addr;
+			const OpcodeInfo& op = OPCODES[bytes[0]];
+			const DWord size = 1 + operandBytes(op.mode);
+			if (!isDefined(op) or addr + size - 1 > m_last) break;
+
+			bool overlaps = false;
+			for (DWord i = 1; i < size; ++i) overlaps = overlaps or (m_flags[addr + i] & (OPCODE | OPERAND)) != 0;
+			if (overlaps) break;
+
+			m_flags[addr] |= OPCODE;
+			for (DWord i = 1; i < size; ++i) m_flags[addr + i] |= OPERAND;
+			found += size;
+
+			const Word value = operandOf(op, bytes);
+			const Word target = targetOf(op, static_cast<Word>(addr), value);
+			addr += size;
+
+			switch (op.operation)
+			{
+			case Operation::JSR:
+				addEntry(target, SUBROUTINE);
+				break;
+			case Operation::JMP:
+				if (op.mode == Address_Mode::ABS) addEntry(target, BRANCH);
+				else label(target, DATA);										// through a pointer, only the pointer is known
+				addr = BUS_SIZE;
+				break;
+			case Operation::RTS: case Operation::RTI: case Operation::BRK:
+				addr = BUS_SIZE;
+				break;
+			default:
+				if (op.mode == Address_Mode::REL) addEntry(target, BRANCH);
+				else if (op.mode != Address_Mode::IMP and op.mode != Address_Mode::IMM) label(target, DATA);
+			}
+		}
+	}
+	return found;
+}
+
+// Roughly 40 chars a line, so reserving for a line every two bytes means it hardly ever grows
+const std::string& Disassembler::listing()
+{
+	m_text.clear();
+	m_text.reserve((static_cast<size_t>(m_last) - m_first + 1) * 20);
+
+	char line[LINE_CHARS];
+	DWord addr = m_first;
+	while (addr <= m_last)
+	{
+		char* out = putHex4(line, static_cast<Word>(addr));
+		*out++ = ' ';
+		*out++ = ' ';
+
+		if (m_flags[addr] & OPCODE)
+		{
+			const Byte* bytes = m_memory + addr;
+			const DWord size = 1 + operandBytes(OPCODES[bytes[0]].mode);
+			char* column = out;
+			for (DWord i = 0; i < size; ++i)
+			{
+				out = putHex2(out, bytes[i]);
+				*out++ = ' ';
+			}
+			out = pad(out, column, 10);
+			column = out;
+			out = pad(putLabel(out, static_cast<Word>(addr)), column, 8);
+			out = putOperand(out, static_cast<Word>(addr), bytes);
+			addr += size;
+		}
+		else
+		{
+			out = pad(out, out, 10);
+			char* column = out;
+			out = pad(putLabel(out, static_cast<Word>(addr)), column, 8);
+			out = putText(out, ".BYTE ");
+			for (size_t i = 0; i < DATA_PER_LINE and addr <= m_last and (m_flags[addr] & OPCODE) == 0
+				and (i == 0 or !hasLabel(static_cast<Word>(addr))); ++i, ++addr)
+			{
+				if (i != 0) *out++ = ',';
+				*out++ = '$';
+				out = putHex2(out, m_memory[addr]);
+			}
+		}
+		*out++ = '\n';
+		m_text.append(line, out);
+	}
+	return m_text;
+}
+
+bool Disassembler::write(const char* fname)
+{
+	const std::string& text = listing();
+	if (std::strcmp(fname, "-") == 0)
+	{
+		std::cout.write(text.data(), text.size());
+		return std::cout.good();
+	}
+
+	std::FILE* file = std::fopen(fname, "wb");
+	if (file == nullptr) return false;
+	bool ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+	return std::fclose(file) == 0 and ok;
+}
+
+Byte Disassembler::getFlags(Word addr) const
+{
+	return m_flags[addr];
+}
+
+char* Disassembler::format(char* out, Word addr, const Byte* bytes)
+{
+	static const Disassembler none;												// nothing traced, so nothing has a label
+	return none.putOperand(out, addr, bytes);
+}
+
+void Disassembler::label(Word addr, Flag kind)
+{
+	if (addr >= m_first and addr <= m_last) m_flags[addr] |= kind;
+}
+
+// The mnemonic and the operand, with the operand as a label if it points at the start of a line that has one
+char* Disassembler::putOperand(char* out, Word addr, const Byte* bytes) const
+{
+	const OpcodeInfo& op = OPCODES[bytes[0]];
+	for (char c : op.mnemonic) *out++ = c;
+
+	const Word value = operandOf(op, bytes);
+	const Word target = targetOf(op, addr, value);
+	const bool named = hasLabel(target);
+	const bool zeroPage = operandBytes(op.mode) == 1;
+
+	auto address = [&](char* at)
+	{
+		if (named) return putLabel(at, target);
+		*at++ = '$';
+		return zeroPage ? putHex2(at, static_cast<Byte>(value)) : putHex4(at, value);
+	};
+
+	switch (op.mode)
+	{
+	case Address_Mode::IMP:
+		if (op.access == Access::RMW) out = putText(out, " A");
+		break;
+	case Address_Mode::IMM:
+		out = putHex2(putText(out, " #$"), static_cast<Byte>(value));
+		break;
+	case Address_Mode::REL:
+		*out++ = ' ';
+		if (named) out = putLabel(out, target);
+		else out = putHex4(putText(out, "$"), target);
+		break;
+	case Address_Mode::ZP0: case Address_Mode::ABS:
+		*out++ = ' ';
+		out = address(out);
+		break;
+	case Address_Mode::ZPX: case Address_Mode::ABX:
+		*out++ = ' ';
+		out = putText(address(out), ",X");
+		break;
+	case Address_Mode::ZPY: case Address_Mode::ABY:
+		*out++ = ' ';
+		out = putText(address(out), ",Y");
+		break;
+	case Address_Mode::IND:
+		out = putText(out, " (");
+		out = putText(address(out), ")");
+		break;
+	case Address_Mode::IZX:
+		out = putText(out, " (");
+		out = putText(address(out), ",X)");
+		break;
+	case Address_Mode::IZY:
+		out = putText(out, " (");
+		out = putText(address(out), "),Y");
+		break;
+	}
+	return out;
+}
+
+char* Disassembler::putLabel(char* out, Word addr) const
+{
+	const Byte flags = m_flags[addr];
+	if ((flags & LABELS) == 0) return out;
+	*out++ = (flags & ENTRY) ? 'E' : (flags & SUBROUTINE) ? 'S' : (flags & BRANCH) ? 'L' : 'D';
+	return putHex4(out, addr);
+}
+
+bool Disassembler::hasLabel(Word addr) const
+{
+	const Byte flags = m_flags[addr];
+	return (flags & LABELS) != 0 and (flags & OPERAND) == 0 and addr >= m_first and addr <= m_last;
+}
+
+int Disassembler::run(int argc, char* argv[])
+{
+	if (argc < 1)
+	{
+		std::cerr << "Apple1 --disasm FILE [--at ADDR] [--entry ADDR]... [--out FILE], see Disassembler.h\n";
+		return 1;
+	}
+	const char* fname = argv[0];
+	std::string outFile = "-";
+	Word addr = USER_PROGRAM;
+	std::vector<Word> entries;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		bool value = i + 1 < argc;
+		if		(arg == "--at"	  and value) addr = parseAddress(argv[++i]);
+		else if (arg == "--entry" and value) entries.push_back(parseAddress(argv[++i]));
+		else if (arg == "--out"	  and value) outFile = argv[++i];
+		else
+		{
+			std::cerr << "Unknown option " << arg << ", see Disassembler.h\n";
+			return 1;
+		}
+	}
+
+	Disassembler dis;
+	RomLoader::Result result = dis.load(fname, addr);
+	if (result != RomLoader::Result::OK)
+	{
+		std::cerr << fname << ": " << RomLoader::describe(result) << '\n';
+		return 1;
+	}
+	if (entries.empty()) entries.push_back(dis.m_first);
+	for (Word entry : entries) dis.addEntry(entry);
+	dis.addVectors();
+	size_t code = dis.trace();
+
+	if (!dis.write(outFile.c_str()))
+	{
+		std::cerr << "Couldn't write " << outFile << '\n';
+		return 1;
+	}
+	std::cerr << "disasm: $" << std::hex << std::uppercase << dis.m_first << "-$" << dis.m_last << std::dec << ", " << code
+			  << " bytes of code\n";
+	return 0;
+}
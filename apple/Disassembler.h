@@ -0,0 +1,95 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "Bit.h"
+#include "RomLoader.h"
+
+/*
+	Disassembles any range of memory or a rom file, only ever reading it. Code is told apart from data by following it from the entry
+	points the way the cpu would:
+
+		dis.reset(memory, 0xFF00, 0xFFFF);			memory is laid out like the bus, only first to last is read
+		dis.addVectors();							and addEntry for anywhere else execution starts
+		dis.trace();
+		dis.listing();								or write(fname)
+
+	Tracing goes down both sides of every branch and into every JSR and JMP, and a path ends at an RTS, RTI, BRK, indirect JMP, undefined
+	opcode or the end of the range. Whatever no path reaches is data and is listed as .BYTE. What each address is, an opcode, an operand or
+	a label, is kept in one flat 64K table, and the listing goes into a buffer kept from one call to the next.
+
+	Apple1 --disasm FILE [options]
+		--at ADDR		where the rom goes (hex), FF00 (USER_PROGRAM) by default. Lines with their own address (E000: A2 00) go there
+		--entry ADDR	somewhere execution starts, as many as needed. Without any the start of the rom is one. The vectors always are
+		--out FILE		where the listing goes, stdout by default
+*/
+
+namespace Emu
+{
+
+class Disassembler
+{
+public:
+	enum Flag : Byte
+	{
+		OPCODE		= 0x01,
+		OPERAND		= 0x02,						// the bytes after an opcode
+		ENTRY		= 0x04,						// labelled E, an entry point or a vector
+		SUBROUTINE	= 0x08,						// labelled S, a JSR goes there
+		BRANCH		= 0x10,						// labelled L, a branch or JMP goes there
+		DATA		= 0x20,						// labelled D, an instruction reads or writes it
+		LABELS		= ENTRY | SUBROUTINE | BRANCH | DATA
+	};
+
+						 Disassembler		();
+
+		void			 reset				(const Byte* memory,											// Forgets everything traced before. memory has to
+											 Word first,													// outlive the disassembler
+											 Word last);
+
+		RomLoader::Result load				(const char* fname,												// Parses the rom into an image of the disassembler's own
+											 Word addr,														// and resets to the range it covers
+											 RomLoader::Format format = RomLoader::Format::AUTO);
+
+		void			 addEntry			(Word addr,
+											 Flag kind = ENTRY);
+
+		void			 addVectors			();																// The NMI, reset and IRQ vectors, where they're in range
+
+		size_t			 trace				();																// Follows the entries, returns how many bytes are code
+
+		const std::string& listing			();																// One line per instruction or up to 8 bytes of data
+
+		bool			 write				(const char* fname);											// The listing, - for stdout
+
+		Byte			 getFlags			(Word addr)											 const;
+
+static	char*			 format				(char* out,														// Just the mnemonic and operand, no labels, for anything
+											 Word addr,														// that disassembles an instruction at a time. Writes
+											 const Byte* bytes);											// at most 16 chars and returns the end
+
+static	int				 run				(int argc, char* argv[]);										// The command line entry
+
+private:
+		void			 label				(Word addr,
+											 Flag kind);
+
+		char*			 putOperand			(char* out,
+											 Word addr,
+											 const Byte* bytes)									 const;
+
+		char*			 putLabel			(char* out,
+											 Word addr)											 const;
+
+		bool			 hasLabel			(Word addr)											 const;		// Labelled and the start of a line
+
+	const Byte*					m_memory;
+	Word						m_first;
+	Word						m_last;
+	std::unique_ptr<Byte[]>		m_flags;				// one per address
+	std::vector<Word>			m_pending;				// entries still to follow
+	std::unique_ptr<Byte[]>		m_image;				// what load() parses into
+	std::string					m_text;
+};
+
+}
@@ -0,0 +1,84 @@
+// Build tool, not part of the emulator. Writes the roms given on the command line out as a source file of constant arrays for
+// EmbeddedRoms.h:
+//
+//		EmbedRoms output.cpp name=file ...
+//
+// where name is what the emulator asks for (roms/basic.bin) and file is where it is now. Each rom is parsed twice, loaded at 0 and at 1,
+// and a run that moved with it is relative to where it's loaded
+#include "RomLoader.h"
+#include "MappedFile.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace Emu;
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "usage: EmbedRoms output.cpp name=file ...\n");
+		return 1;
+	}
+
+	std::ofstream out(argv[1]);
+	out << "// Generated by EmbedRoms from the roms directory, don't edit\n"
+		<< "#include \"EmbeddedRoms.h\"\n"
+		<< "#include <cstring>\n\n"
+		<< "namespace\n{\n";
+
+	std::vector<Byte> atZero(0x10000), atOne(0x10000);
+	std::vector<RomLoader::Span> zeroSpans, oneSpans;
+	std::vector<std::string> names;
+	for (int i = 2; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		const size_t equals = arg.find('=');
+		if (equals == std::string::npos)
+		{
+			std::fprintf(stderr, "EmbedRoms: %s should be name=file\n", argv[i]);
+			return 1;
+		}
+		const std::string name = arg.substr(0, equals), fname = arg.substr(equals + 1);
+
+		MappedFile file(fname.c_str());
+		RomLoader::Result result = file.data() == nullptr ? RomLoader::Result::NO_FILE
+								 : RomLoader::parse(file.data(), file.size(), 0, atZero.data(), zeroSpans);
+		if (result == RomLoader::Result::OK) result = RomLoader::parse(file.data(), file.size(), 1, atOne.data(), oneSpans);
+		if (result != RomLoader::Result::OK or zeroSpans.size() != oneSpans.size())
+		{
+			std::fprintf(stderr, "EmbedRoms: %s: %s\n", fname.c_str(), RomLoader::describe(result));
+			return 1;
+		}
+
+		const size_t rom = names.size();
+		for (size_t run = 0; run < zeroSpans.size(); ++run)
+		{
+			out << "\tconstexpr Byte ROM_" << rom << "_" << run << "[] =\n\t{";
+			for (size_t j = 0; j < zeroSpans[run].length; ++j)
+			{
+				static const char HEX[] = "0123456789ABCDEF";
+				const Byte val = atZero[zeroSpans[run].start + j];
+				out << (j % 16 == 0 ? "\n\t\t" : " ") << "0x" << HEX[val >> 4] << HEX[val & 0xF] << ',';
+			}
+			out << "\n\t};\n";
+		}
+		out << "\tconst Emu::EmbeddedRun ROM_" << rom << "_RUNS[] =\n\t{\n";
+		for (size_t run = 0; run < zeroSpans.size(); ++run)
+			out << "\t\t{ " << zeroSpans[run].start << ", " << (oneSpans[run].start != zeroSpans[run].start ? "true" : "false") << ", ROM_"
+				<< rom << "_" << run << ", sizeof(ROM_" << rom << "_" << run << ") },\n";
+		out << "\t};\n\n";
+		names.push_back(name);
+	}
+
+	out << "\tconst Emu::EmbeddedRom ROMS[] =\n\t{\n";
+	for (size_t rom = 0; rom < names.size(); ++rom)
+		out << "\t\t{ \"" << names[rom] << "\", ROM_" << rom << "_RUNS, sizeof(ROM_" << rom << "_RUNS) / sizeof(Emu::EmbeddedRun) },\n";
+	out << "\t};\n}\n\n"
+		<< "const Emu::EmbeddedRom* Emu::findEmbeddedRom(const char* fname)\n{\n"
+		<< "\tfor (const EmbeddedRom& rom : ROMS)\n"
+		<< "\t\tif (std::strcmp(rom.fname, fname) == 0) return &rom;\n"
+		<< "\treturn nullptr;\n}\n";
+	return out.good() ? 0 : 1;
+}
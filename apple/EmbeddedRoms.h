@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include "Bit.h"
+
+namespace Emu
+{
+
+/*
+	The roms/ directory built into the program. EmbedRoms parses each rom with RomLoader when it's built and writes out the bytes, so
+	nothing is read or parsed when it starts and it runs from any directory. CMake builds it with EMU_EMBEDDED_ROMS defined unless it's
+	configured with -DAPPLE1_EMBED_ROMS=OFF, without it there are none and the roms come off the disk as before.
+
+	A run is where a rom's bytes go. Text without an address in front, and binary, goes wherever the rom is loaded, so its run is relative
+	to that. The bytes after a wozmon style "E000:" go at that address whatever it's loaded at
+*/
+struct EmbeddedRun
+{
+	Word		addr;
+	bool		relative;						// addr is from where the rom is loaded
+	const Byte* data;
+	size_t		size;
+};
+
+struct EmbeddedRom
+{
+	const char*			fname;					// the way it's named in Apple1.h, "roms/basic.bin"
+	const EmbeddedRun*	runs;
+	size_t				count;
+};
+
+const EmbeddedRom* findEmbeddedRom(const char* fname);			// nullptr if it wasn't built in
+}
@@ -0,0 +1,286 @@
+#include "Headless.h"
+#include "Apple1.h"
+#include "Trace.h"
+#include "Profiler.h"
+#include "CallGraph.h"
+#include "Symbols.h"
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <vector>
+
+using namespace Emu;
+
+namespace
+{
+	const char* stopName(Headless::Stop stop)
+	{
+		switch (stop)
+		{
+		case Headless::Stop::PATTERN:	return "the pattern";
+		case Headless::Stop::BRK:		return "a BRK";
+		default:						return "the cycle limit";
+		}
+	}
+
+	// The whole of text as a decimal number that fits in value, anything else leaves value alone and is false
+	template<typename T>
+	bool parseNumber(const char* text, T& value)
+	{
+		const char* end = text + std::strlen(text);
+		T parsed = 0;
+		const std::from_chars_result result = std::from_chars(text, end, parsed);
+		if (result.ec != std::errc() or result.ptr != end) return false;
+		value = parsed;
+		return true;
+	}
+}
+
+Headless::Headless(std::istream* keys, std::ostream* display)
+	: m_cpu(new emu6502()), m_pacer(0), m_keys(keys), m_display(display), m_nextTyped(0), m_matched(false)
+{
+	m_cpu->map(KEYBOARD_INPUT_REGISTER & 0xFF00, KEYBOARD_INPUT_REGISTER | 0xFF, Memory::Page::DEVICE, &m_pia);
+	m_pia.onKeyboardPoll([this] { nextKey(); });
+	m_pia.onDisplay([this](Byte val) { this->display(val); });
+}
+
+bool Headless::boot()
+{
+	m_pia.reset();
+	return Apple1::setUpMachine(*m_cpu);
+}
+
+void Headless::setSpeed(unsigned speed)
+{
+	m_pacer.setSpeed(speed);
+}
+
+void Headless::type(const std::string& keys)
+{
+	m_typed += keys;
+}
+
+// The display is ready again straight away so the program never waits on it. A run that ends on the display, which is every slice that
+// didn't use up its cycles, is where the pattern gets looked at
+Headless::Result Headless::run(QWord cycles, const std::string& pattern)
+{
+	Result result;
+	m_pattern = pattern;
+	m_matched = false;
+
+	auto start = std::chrono::steady_clock::now();
+	while (result.cycles < cycles)
+	{
+		RunResult slice = m_cpu->run_cycles(std::min<QWord>(m_pacer.budget(), cycles - result.cycles));
+		m_pacer.ran(slice.cycles);
+		result.cycles += slice.cycles;
+		result.instructions += slice.instructions;
+
+		if (m_matched)
+		{
+			result.stop = Stop::PATTERN;
+			break;
+		}
+		if (slice.stop == Emu::Stop::INTERRUPT)
+		{
+			result.stop = Stop::BRK;
+			break;
+		}
+		m_pacer.wait();
+	}
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (m_display != nullptr) m_display->flush();
+	return result;
+}
+
+const std::string& Headless::getOutput() const
+{
+	return m_output;
+}
+
+emu6502& Headless::getCPU()
+{
+	return *m_cpu;
+}
+
+// The program is polling with nothing waiting. Returns and newlines are both typed as return, a \r\n pair only once
+void Headless::nextKey()
+{
+	char key;
+	if (m_nextTyped < m_typed.size())
+		key = m_typed[m_nextTyped++];
+	else
+	{
+		if (m_keys == nullptr or !m_keys->get(key)) return;
+		if (key == '\r' and m_keys->peek() == '\n') m_keys->get();
+	}
+	if (key == '\n') key = CR;
+	m_pia.pressKey(static_cast<Byte>(std::toupper(static_cast<unsigned char>(key))));
+}
+
+// Only what the Apple 1 would show gets kept, return starts a new line
+void Headless::display(const Byte& val)
+{
+	m_pia.setDisplayBusy(false);
+
+	char c;
+	if (val == CR) c = '\n';
+	else if (val >= 32 and val <= 126) c = static_cast<char>(std::toupper(val));
+	else return;
+
+	m_output += c;
+	if (m_display != nullptr) m_display->put(c);
+	if (!m_pattern.empty() and m_output.size() >= m_pattern.size()
+		and m_output.compare(m_output.size() - m_pattern.size(), m_pattern.size(), m_pattern) == 0)
+		m_matched = true;
+}
+
+int Headless::run(int argc, char* argv[])
+{
+	std::string keysFile, outFile, pattern, traceFile, profileFile, callsFile, stacksFile;
+	std::vector<std::string> symbolFiles;
+	QWord cycles = ~QWord(0);
+	unsigned speed = 0;
+	bool basic = false, jit = false;
+
+	for (int i = 0; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		bool value = i + 1 < argc;
+		if		(arg == "--keys"    and value) keysFile = argv[++i];
+		else if (arg == "--out"     and value) outFile = argv[++i];
+		else if (arg == "--until"   and value) pattern = argv[++i];
+		else if (arg == "--cycles"  and value)
+		{
+			if (!parseNumber(argv[++i], cycles))
+			{
+				std::cerr << "Bad number " << argv[i] << " for --cycles, see Headless.h\n";
+				return 1;
+			}
+		}
+		else if (arg == "--speed"   and value)
+		{
+			if (!parseNumber(argv[++i], speed))
+			{
+				std::cerr << "Bad number " << argv[i] << " for --speed, see Headless.h\n";
+				return 1;
+			}
+		}
+		else if (arg == "--trace"   and value) traceFile = argv[++i];
+		else if (arg == "--profile" and value) profileFile = argv[++i];
+		else if (arg == "--calls"   and value) callsFile = argv[++i];
+		else if (arg == "--stacks"  and value) stacksFile = argv[++i];
+		else if (arg == "--symbols" and value) symbolFiles.push_back(argv[++i]);
+		else if (arg == "--basic")			   basic = true;
+		else if (arg == "--jit")			   jit = true;
+		else
+		{
+			std::cerr << "Unknown option " << arg << ", see Headless.h\n";
+			return 1;
+		}
+	}
+
+	std::ifstream keysStream;
+	std::istream* keys = nullptr;
+	if (keysFile == "-")
+		keys = &std::cin;
+	else if (!keysFile.empty())
+	{
+		keysStream.open(keysFile, std::ios::binary);
+		if (!keysStream)
+		{
+			std::cerr << "Couldn't open " << keysFile << '\n';
+			return 1;
+		}
+		keys = &keysStream;
+	}
+
+	std::ofstream outStream;
+	std::ostream* out = &std::cout;
+	if (!outFile.empty())
+	{
+		outStream.open(outFile, std::ios::binary);
+		if (!outStream)
+		{
+			std::cerr << "Couldn't open " << outFile << '\n';
+			return 1;
+		}
+		out = &outStream;
+	}
+
+	// The upper case pattern matches what the display shows
+	for (char& c : pattern) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+
+	Headless machine(keys, out);
+	if (!machine.boot()) return 1;
+	if (jit) machine.getCPU().setJit(true);
+	machine.setSpeed(speed);
+	if (basic) machine.type("E000R\r");
+
+	std::unique_ptr<Trace> trace;
+	if (!traceFile.empty())
+	{
+		trace.reset(new Trace());
+		if (!trace->start(traceFile.c_str()))
+		{
+			std::cerr << "Couldn't open " << traceFile << '\n';
+			return 1;
+		}
+		machine.getCPU().setTrace(trace.get());
+	}
+
+	Symbols symbols;
+	for (const std::string& fname : symbolFiles)
+		if (!symbols.load(fname.c_str()))
+		{
+			std::cerr << "Couldn't read the symbols in " << fname << '\n';
+			return 1;
+		}
+
+	Profiler profiler;
+	if (!profileFile.empty()) machine.getCPU().setProfiler(&profiler);
+	CallGraph calls;
+	const bool following = !callsFile.empty() or !stacksFile.empty();
+	if (following) machine.getCPU().setCallGraph(&calls);
+
+	Result result = machine.run(cycles, pattern);
+	if (trace != nullptr)
+	{
+		machine.getCPU().setTrace(nullptr);
+		trace->stop();
+		const Trace::Stats stats = trace->getStats();
+		std::cerr << "headless: traced " << stats.records << " instructions into " << stats.bytes << " bytes, the ring filled "
+				  << stats.stalls << " times\n";
+	}
+	if (!profileFile.empty())
+	{
+		machine.getCPU().setProfiler(nullptr);
+		if (!profiler.write(profileFile.c_str(), machine.getCPU().getBus(), &symbols))
+		{
+			std::cerr << "Couldn't write " << profileFile << '\n';
+			return 1;
+		}
+	}
+	if (following)
+	{
+		machine.getCPU().setCallGraph(nullptr);
+		if (!callsFile.empty() and !calls.write(callsFile.c_str(), &symbols))
+		{
+			std::cerr << "Couldn't write " << callsFile << '\n';
+			return 1;
+		}
+		if (!stacksFile.empty() and !calls.writeStacks(stacksFile.c_str(), &symbols))
+		{
+			std::cerr << "Couldn't write " << stacksFile << '\n';
+			return 1;
+		}
+	}
+	std::cerr << "headless: stopped at " << stopName(result.stop) << " after " << result.instructions << " instructions, "
+			  << result.cycles << " cycles in " << result.seconds << "s (" << (result.cycles / result.seconds / 1e6) << " MHz, "
+			  << (result.cycles / result.seconds / APPLE1_CLOCK_HZ) << "x an Apple 1)\n";
+
+	return (!pattern.empty() and result.stop != Stop::PATTERN) ? 1 : 0;
+}
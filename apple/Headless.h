@@ -0,0 +1,92 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <istream>
+#include <ostream>
+#include "Bit.h"
+#include "Pia.h"
+#include "Pacer.h"
+#include "emu6502.h"
+
+/*
+	The Apple 1 without a console. It boots straight into the wozmon, takes its keystrokes from a stream and captures the display, and
+	runs unthrottled (or paced, see Pacer.h) until it has used up its cycles, the display shows a pattern or the cpu hits a BRK.
+
+	Apple1 --headless [options]
+		--keys FILE		keystrokes to type, - for stdin. A newline is typed as return
+		--out FILE		where the display goes, stdout by default
+		--basic			type E000R first to start basic
+		--cycles N		stop after N cycles
+		--speed N		run at N times the Apple 1's 1.023 MHz, 0 (the default) is unlimited
+		--until TEXT	stop once TEXT is on the display
+		--jit			turn the recompiler on. It pays off on loops and on basic waiting for keys, but code that keeps hitting a BRK runs
+						slower than without it, so it is off by default
+		--trace FILE	trace every instruction into FILE, which also keeps the recompiler off. Apple1 --trace FILE prints it (Trace.h)
+		--profile FILE	count the cycles spent at every address and write the hot spots to FILE, - for stdout (Profiler.h)
+		--calls FILE	follow every JSR and RTS and write the routines ranked by the cycles in them and what they call (CallGraph.h)
+		--stacks FILE	the same calls as collapsed stacks for flamegraph.pl or speedscope, with or without --calls
+		--symbols FILE	names for the profile and the calls, as many as needed, e.g. roms/wozmon1.sym (Symbols.h)
+
+	The run is summed up on stderr. Returns 0, or 1 if the roms or files couldn't be opened or --until never matched. The roms are the
+	built in ones (EmbeddedRoms.h), so it runs from any directory
+*/
+
+namespace Emu
+{
+
+class Headless
+{
+public:
+	enum class Stop
+	{
+		CYCLES,						// used up the cycles it was given
+		PATTERN,					// the pattern showed up on the display
+		BRK							// the cpu ran a BRK
+	};
+
+	struct Result
+	{
+		QWord		instructions = 0;
+		QWord		cycles		 = 0;
+		double		seconds		 = 0.0;
+		Stop		stop		 = Stop::CYCLES;
+	};
+
+						 Headless			(std::istream* keys,								// The streams have to outlive this. Without keys nothing is
+											 std::ostream* display);							// typed, without a display the output is only kept in memory
+
+						 Headless			(const Headless&) = delete;							// the pia's callbacks point back at this one
+
+		bool			 boot				();													// Loads the roms the way the F2 reset does and resets the cpu
+
+		void			 setSpeed			(unsigned speed);									// Multiple of the Apple 1's clock, 0 (the default) for unlimited
+
+		void			 type				(const std::string& keys);							// Typed before anything from the key stream
+
+		Result			 run				(QWord cycles,										// Runs until the cycles are used up, pattern is on the display
+											 const std::string& pattern = "");					// (if there is one) or a BRK
+
+		const std::string& getOutput		()													 const;		// Everything the display has shown, a newline for each return
+
+		emu6502&		 getCPU				();
+
+static	int				 run				(int argc, char* argv[]);							// The command line entry
+
+private:
+		void			 nextKey			();
+
+		void			 display			(const Byte& val);
+
+	std::unique_ptr<emu6502> m_cpu;
+	Pia				m_pia;
+	Pacer			m_pacer;
+	std::istream*	m_keys;
+	std::ostream*	m_display;
+	std::string		m_typed;						// keys from type(), ahead of the stream
+	size_t			m_nextTyped;
+	std::string		m_output;
+	std::string		m_pattern;
+	bool			m_matched;
+};
+
+}
@@ -0,0 +1,1064 @@
+#include "Jit.h"
+#include <cstring>
+#include <cstdint>
+#include <functional>
+
+#if defined(EMU_JIT_X64)
+	#ifdef _WIN32
+		#include <windows.h>
+	#else
+		#include <sys/mman.h>
+	#endif
+#endif
+
+using namespace Emu;
+
+/*			START
+* x86-64 recompiler */
+
+#if defined(EMU_JIT_X64)
+
+namespace
+{
+	const size_t ARENA_SIZE = 4 << 20;
+
+	constexpr Byte DECIMAL_BIT = BIT_VALUE(Flags::DECIMALE_MODE);
+
+	enum Reg { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+	// rbx points at the emu6502 for the whole block. ebp adds up the page crossing and branch cycles, edi keeps the page crossing cycle of
+	// the last instruction that could take one so m_cycles is right if the block leaves straight after it
+	constexpr Reg CPU_REG = RBX, REG_A = R12, REG_X = R13, REG_Y = R14, REG_S = R15, EXTRA = RBP, LAST_EXTRA = RDI;
+	constexpr Reg FLAG_N = R8, FLAG_Z = R9, FLAG_C = R10, FLAG_V = R11;
+
+#ifdef _WIN32
+	constexpr Reg  ARG0 = RCX, ARG1 = RDX, ARG2 = R8;
+	constexpr Byte SHADOW_SPACE = 32;
+#else
+	constexpr Reg  ARG0 = RDI, ARG1 = RSI, ARG2 = RDX;
+	constexpr Byte SHADOW_SPACE = 0;
+#endif
+
+	enum Condition : Byte { BELOW_EQUAL = 0x6, ABOVE_EQUAL = 0x3, EQUAL = 0x4, NOT_EQUAL = 0x5 };
+
+	// The /digit of the immediate form, the "op r/m32, r32" opcode is digit * 8 + 1
+	enum Alu : Byte { ALU_ADD = 0, ALU_OR = 1, ALU_AND = 4, ALU_SUB = 5, ALU_XOR = 6, ALU_CMP = 7 };
+
+	// [base + index + disp32], index is -1 for none
+	struct Mem
+	{
+		Reg		base;
+		int		index;
+		int32_t disp;
+	};
+
+	// Just enough of an x86-64 assembler for the translator. Everything is 32 bit unless the name says otherwise, the 6502 registers are
+	// kept zero extended so the byte and word results are picked back out with movzx
+	class Assembler
+	{
+	public:
+		using Label = size_t;
+
+		std::vector<Byte> code;
+
+		Label	label		()								{ m_labels.push_back(0); return m_labels.size() - 1; }
+		void	bind		(Label label)					{ m_labels[label] = code.size(); }
+
+		void	movzxByte	(Reg dst, const Mem& m)			{ memory({ 0x0F, 0xB6 }, dst, m, 4); }
+		void	movzxWord	(Reg dst, const Mem& m)			{ memory({ 0x0F, 0xB7 }, dst, m, 4); }
+		void	movzxByte	(Reg dst, Reg src)				{ registers({ 0x0F, 0xB6 }, dst, src, 1); }
+		void	movzxWord	(Reg dst, Reg src)				{ registers({ 0x0F, 0xB7 }, dst, src, 4); }
+		void	storeByte	(const Mem& m, Reg src)			{ memory({ 0x88 }, src, m, 1); }
+		void	storeWord	(const Mem& m, Reg src)			{ memory({ 0x89 }, src, m, 2); }
+		void	storeDWord	(const Mem& m, Reg src)			{ memory({ 0x89 }, src, m, 4); }
+		void	storeByte	(const Mem& m, Byte imm)		{ memory({ 0xC6 }, 0, m, 4); byte(imm); }
+		void	storeDWord	(const Mem& m, DWord imm)		{ memory({ 0xC7 }, 0, m, 4); dword(imm); }
+		void	mov			(Reg dst, Reg src)				{ registers({ 0x89 }, src, dst, 4); }
+		void	mov			(Reg dst, DWord imm)			{ rex(false, 0, 0, dst, false); byte(0xB8 + (dst & 7)); dword(imm); }
+		void	mov64		(Reg dst, Reg src)				{ registers({ 0x89 }, src, dst, 8); }
+		void	mov64		(Reg dst, QWord imm)			{ rex(true, 0, 0, dst, false); byte(0xB8 + (dst & 7)); qword(imm); }
+		void	mov			(Reg dst, const Mem& m)			{ memory({ 0x8B }, dst, m, 4); }
+		void	mov64		(Reg dst, const Mem& m)			{ memory({ 0x8B }, dst, m, 8); }
+		void	store64		(const Mem& m, Reg src)			{ memory({ 0x89 }, src, m, 8); }
+		void	lea			(Reg dst, const Mem& m)			{ memory({ 0x8D }, dst, m, 4); }
+		void	alu			(Alu op, Reg dst, Reg src)		{ registers({ Byte(op * 8 + 1) }, src, dst, 4); }
+		void	alu			(Alu op, Reg dst, DWord imm)	{ registers({ 0x81 }, op, dst, 4); dword(imm); }
+		void	alu			(Alu op, Reg dst, const Mem& m)	{ memory({ Byte(op * 8 + 3) }, dst, m, 4); }
+		void	alu			(Alu op, const Mem& m, Reg src)	{ memory({ Byte(op * 8 + 1) }, src, m, 4); }
+		void	shl			(Reg dst, Byte n)				{ registers({ 0xC1 }, 4, dst, 4); byte(n); }
+		void	shr			(Reg dst, Byte n)				{ registers({ 0xC1 }, 5, dst, 4); byte(n); }
+		void	inc			(Reg dst)						{ registers({ 0xFF }, 0, dst, 4); }
+		void	dec			(Reg dst)						{ registers({ 0xFF }, 1, dst, 4); }
+		void	bitNot		(Reg dst)						{ registers({ 0xF7 }, 2, dst, 4); }
+		void	testByte	(Reg reg, Byte imm)				{ registers({ 0xF6 }, 0, reg, 1); byte(imm); }
+		void	testByte	(Reg lhs, Reg rhs)				{ registers({ 0x84 }, rhs, lhs, 1); }
+		void	testByte	(const Mem& m, Byte imm)		{ memory({ 0xF6 }, 0, m, 4); byte(imm); }
+		void	cmpByte		(const Mem& m, Byte imm)		{ memory({ 0x80 }, 7, m, 4); byte(imm); }
+		void	setcc		(Condition cc, Reg dst)			{ registers({ 0x0F, Byte(0x90 | cc) }, 0, dst, 1); }
+		void	jcc			(Condition cc, Label target)	{ byte(0x0F); byte(0x80 | cc); fixup(target); }
+		void	jmp			(Label target)					{ byte(0xE9); fixup(target); }
+		void	call		(Reg target)					{ registers({ 0xFF }, 2, target, 4); }
+		void	jmp			(Reg target)					{ registers({ 0xFF }, 4, target, 4); }
+		void	push		(Reg reg)						{ rex(false, 0, 0, reg, false); byte(0x50 + (reg & 7)); }
+		void	pop			(Reg reg)						{ rex(false, 0, 0, reg, false); byte(0x58 + (reg & 7)); }
+		void	addRsp		(DWord n)						{ registers({ 0x81 }, ALU_ADD, RSP, 8); dword(n); }
+		void	subRsp		(DWord n)						{ registers({ 0x81 }, ALU_SUB, RSP, 8); dword(n); }
+		void	shl64		(Reg dst, Byte n)				{ registers({ 0xC1 }, 4, dst, 8); byte(n); }
+		void	or64		(Reg dst, Reg src)				{ registers({ 0x09 }, src, dst, 8); }
+		void	test64		(Reg lhs, Reg rhs)				{ registers({ 0x85 }, rhs, lhs, 8); }
+		void	add64		(Reg dst, DWord imm)			{ registers({ 0x81 }, ALU_ADD, dst, 8); dword(imm); }
+		void	ret			()								{ byte(0xC3); }
+
+		// Jumps are all rel32 and get patched once every label is bound
+		void resolve()
+		{
+			for (const std::pair<size_t, Label>& fixup : m_fixups)
+			{
+				int32_t rel = static_cast<int32_t>(m_labels[fixup.second] - (fixup.first + 4));
+				std::memcpy(&code[fixup.first], &rel, 4);
+			}
+		}
+
+	private:
+		void byte(Byte b)		{ code.push_back(b); }
+		void dword(DWord d)		{ for (int i = 0; i < 32; i += 8) byte(static_cast<Byte>(d >> i)); }
+		void qword(QWord q)		{ for (int i = 0; i < 64; i += 8) byte(static_cast<Byte>(q >> i)); }
+		void fixup(Label target)
+		{
+			m_fixups.push_back({ code.size(), target });
+			dword(0);
+		}
+
+		// REX is needed for r8-r15, 64 bit operands and to get at spl, bpl, sil and dil instead of ah, ch, dh and bh
+		void rex(bool wide, int reg, int index, int base, bool byteRegs)
+		{
+			Byte prefix = 0x40 | (wide << 3) | ((reg & 8) >> 1) | ((index & 8) >> 2) | ((base & 8) >> 3);
+			if (prefix != 0x40 or byteRegs) byte(prefix);
+		}
+
+		// size is the operand size, 1, 2, 4 or 8. reg is a register or the /digit of the opcode
+		void memory(std::initializer_list<Byte> opcode, int reg, const Mem& m, int size)
+		{
+			if (size == 2) byte(0x66);
+			rex(size == 8, reg, m.index < 0 ? 0 : m.index, m.base, size == 1 and reg >= RSP and reg <= RDI);
+			for (Byte b : opcode) byte(b);
+			if (m.index < 0 and (m.base & 7) != RSP)
+				byte(0x80 | ((reg & 7) << 3) | (m.base & 7));
+			else
+			{
+				byte(0x80 | ((reg & 7) << 3) | RSP);
+				byte((((m.index < 0 ? RSP : m.index) & 7) << 3) | (m.base & 7));
+			}
+			dword(static_cast<DWord>(m.disp));
+		}
+
+		void registers(std::initializer_list<Byte> opcode, int reg, int rm, int size)
+		{
+			if (size == 2) byte(0x66);
+			rex(size == 8, reg, 0, rm, size == 1 and ((reg >= RSP and reg <= RDI) or (rm >= RSP and rm <= RDI)));
+			for (Byte b : opcode) byte(b);
+			byte(0xC0 | ((reg & 7) << 3) | (rm & 7));
+		}
+
+		std::vector<size_t>					m_labels;
+		std::vector<std::pair<size_t, Label>> m_fixups;
+	};
+
+	// Offsets into the emu6502 of everything the translated code reads and writes, and native's offset into a Block
+	struct Layout
+	{
+		int32_t a, x, y, flags, p, s;
+		int32_t flagN, flagZ, flagC, flagV;
+		int32_t addrVal, addrRel, opcode, cycles;
+		int32_t bus, pageWatch;
+		int32_t block, blockEntry, skipLoops, native;
+	};
+
+	// The translated code's own stack slots, above the shadow space a call out needs on Windows. Every block chained into adds the
+	// instructions and cycles it ran to the totals
+	const int32_t TOTAL_INSTRUCTIONS = 0, TOTAL_CYCLES = 4, BUDGET = 8;
+	const DWord	  FRAME_SIZE = 24;
+
+	struct Source
+	{
+		const OpcodeInfo* info;
+		Word pc, next, operand;
+		Byte opcode;
+	};
+
+	// Leaving the translated code. m_opcode and m_cycles are left as the last instruction run would have left them
+	struct Exit
+	{
+		DWord		  instructions = 0;				// instructions run
+		DWord		  cycles	   = 0;				// their base cycles, the extra ones are in ebp
+		const Source* last		   = nullptr;		// the last instruction run
+		Byte		  lastCycles   = 0;
+		bool		  lastCrossed  = false;			// add edi, the page crossing cycle of the last instruction, to lastCycles
+		bool		  pcInEcx	   = false;			// otherwise the program counter is pc
+		Word		  pc		   = 0;
+		bool		  entry		   = false;			// pc is past the end of the block or where it jumped, so a block can start there
+		bool		  chain		   = false;			// go straight on into the translated block at pc if the budget isn't used up
+		bool		  delayLoop	   = false;			// unless loop skipping is on, this goes back to a loop run might skip
+	};
+
+	// Where an operand is. A fixed address goes straight into the instruction, anything else is worked out into a register
+	struct Operand
+	{
+		bool fixed;
+		Word addr;
+		Reg	 reg;
+	};
+
+	bool transfers(Operation op)
+	{
+		switch (op)
+		{
+		case Operation::BCC: case Operation::BCS: case Operation::BEQ: case Operation::BMI:
+		case Operation::BNE: case Operation::BPL: case Operation::BVC: case Operation::BVS:
+		case Operation::JMP: case Operation::JSR: case Operation::RTS:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	bool crossesPages(Address_Mode mode)
+	{
+		return mode == ABX or mode == ABY or mode == IZY;
+	}
+
+	// Emits one block. Every quirk the interpreters have is kept, the translated code has to leave exactly the same state behind
+	class Translator
+	{
+	public:
+		Translator(const Layout& layout, QWord write, QWord read, QWord table, const Byte* watch, Byte io)
+			: m_layout(layout), m_write(write), m_read(read), m_table(table), m_watch(watch), m_io(io), m_block(nullptr), m_index(0),
+			  m_body(0), m_chain(0), m_epilogue(0) {	}
+
+		// Translates from the start of the block up to the first instruction that can't be, false if that's the first one
+		bool translate(const std::vector<Source>& block)
+		{
+			size_t count = 0;
+			while (count < block.size() and translatable(block[count])) ++count;
+			if (count == 0) return false;
+
+			m_block = &block;
+			m_baseCycles.assign(1, 0);
+			for (const Source& source : block)
+				m_baseCycles.push_back(m_baseCycles.back() + source.info->cycles);
+			m_chain = m_as.label();
+			m_epilogue = m_as.label();
+
+			prologue();
+			m_body = m_as.code.size();
+			for (size_t i = 0; i < count; ++i)
+				if (block[i].info->operation == Operation::ADC)			// nothing translated can change D, so checking it once covers the block
+				{
+					m_as.testByte(field(m_layout.flags), DECIMAL_BIT);
+					m_as.jcc(NOT_EQUAL, coldExit(before(0)));
+					break;
+				}
+
+			for (m_index = 0; m_index < count; ++m_index)
+				instruction(block[m_index]);
+
+			if (!transfers(block[count - 1].info->operation))
+			{
+				m_index = count - 1;
+				exit(after());
+			}
+
+			chain();
+			epilogue();
+			for (size_t i = 0; i < m_cold.size(); ++i)
+			{
+				std::function<void()> cold = m_cold[i];			// it can add more cold code, which may move m_cold
+				cold();
+			}
+			m_as.resolve();
+			return true;
+		}
+
+		const std::vector<Byte>& code() const { return m_as.code; }
+		size_t body() const { return m_body; }					// where a block chained into starts, past the prologue
+
+	private:
+		bool io(Byte page)				const { return (m_watch[page] & m_io) != 0; }
+
+		// The pages an instruction can only ever touch are checked here, a device mapped onto them later throws the translation away.
+		// Anything else is checked by address() when it runs
+		bool translatable(const Source& source) const
+		{
+			const OpcodeInfo& info = *source.info;
+			switch (info.access)
+			{
+			case Access::READ:
+				if (info.mode == IMP) return false;			// the undefined implied SBC reads from wherever m_addrVal was left
+				if (info.mode == ZP0 or info.mode == ABS) return true;		// a device is read through Jit::read
+				// fall through
+			case Access::WRITE:
+			case Access::RMW:
+				switch (info.mode)
+				{
+				case ZP0: case ABS:	return !io(source.operand >> 8);
+				case ZPX: case ZPY:							// the unwrapped sum and the pointers stay inside $0000-$01FF
+				case IZX: case IZY:	return !io(0x00) and !io(0x01);
+				default:			return true;
+				}
+			default:
+				break;
+			}
+
+			switch (info.operation)
+			{
+			case Operation::PHP: case Operation::PLP: case Operation::RTI: case Operation::BRK:
+			case Operation::SEI: case Operation::CLI: case Operation::SED: case Operation::CLD:
+				return false;
+			case Operation::JMP:
+				return info.mode == ABS;
+			default:
+				return true;
+			}
+		}
+
+		Mem field(int32_t offset)		const { return { CPU_REG, -1, offset }; }
+		Mem stack(int32_t offset)		const { return { RSP, -1, offset }; }
+		Mem bus(Word addr)				const { return { CPU_REG, -1, m_layout.bus + addr }; }
+		Mem bus(Reg addr)				const { return { CPU_REG, addr, m_layout.bus }; }
+		Mem at(const Operand& operand)	const { return operand.fixed ? bus(operand.addr) : bus(operand.reg); }
+
+		// Leaving after the current instruction, or before it without having changed anything
+		Exit after() const
+		{
+			const Source& source = (*m_block)[m_index];
+			Exit exit;
+			exit.instructions = static_cast<DWord>(m_index + 1);
+			exit.cycles = m_baseCycles[m_index + 1];
+			exit.last = &source;
+			exit.lastCycles = source.info->cycles;
+			exit.lastCrossed = crossesPages(source.info->mode);
+			exit.pc = source.next;
+			exit.entry = transfers(source.info->operation) or m_index + 1 == m_block->size();
+			exit.chain = exit.entry;
+			return exit;
+		}
+
+		Exit before(size_t index) const
+		{
+			Exit exit;
+			if (index > 0)
+			{
+				const Source& source = (*m_block)[index - 1];
+				exit.instructions = static_cast<DWord>(index);
+				exit.cycles = m_baseCycles[index];
+				exit.last = &source;
+				exit.lastCycles = source.info->cycles;
+				exit.lastCrossed = crossesPages(source.info->mode);
+			}
+			exit.pc = (*m_block)[index].pc;
+			exit.entry = index == 0;
+			return exit;
+		}
+
+		void exit(const Exit& exit)
+		{
+			if (exit.last != nullptr)
+			{
+				m_as.storeByte(field(m_layout.opcode), exit.last->opcode);
+				if (exit.lastCrossed)
+				{
+					m_as.lea(RAX, { LAST_EXTRA, -1, exit.lastCycles });
+					m_as.storeByte(field(m_layout.cycles), RAX);
+				}
+				else
+					m_as.storeByte(field(m_layout.cycles), exit.lastCycles);
+			}
+			m_as.storeByte(field(m_layout.blockEntry), Byte(exit.entry));
+			if (!exit.pcInEcx) m_as.mov(RCX, DWord(exit.pc));
+			m_as.mov(RAX, exit.instructions);
+			m_as.mov(RDX, exit.cycles);
+			if (exit.delayLoop)
+			{
+				m_as.cmpByte(field(m_layout.skipLoops), 0);
+				m_as.jcc(NOT_EQUAL, m_epilogue);
+			}
+			m_as.jmp(exit.chain ? m_chain : m_epilogue);
+		}
+
+		// Exits that are rarely taken go out of line after the block
+		Assembler::Label coldExit(const Exit& exit)
+		{
+			Assembler::Label label = m_as.label();
+			m_cold.push_back([this, label, exit] { m_as.bind(label); this->exit(exit); });
+			return label;
+		}
+
+		void prologue()
+		{
+			for (Reg reg : { RBX, RBP, R12, R13, R14, R15 }) m_as.push(reg);
+#ifdef _WIN32
+			m_as.push(RSI);
+			m_as.push(RDI);
+#endif
+			m_as.subRsp(FRAME_SIZE);								// keeps calls out to the block cache 16 byte aligned
+			m_as.mov64(CPU_REG, ARG0);
+			m_as.storeDWord(stack(BUDGET), ARG1);
+			m_as.storeDWord(stack(TOTAL_INSTRUCTIONS), DWord(0));
+			m_as.storeDWord(stack(TOTAL_CYCLES), DWord(0));
+
+			m_as.movzxByte(REG_A, field(m_layout.a));
+			m_as.movzxByte(REG_X, field(m_layout.x));
+			m_as.movzxByte(REG_Y, field(m_layout.y));
+			m_as.movzxWord(REG_S, field(m_layout.s));
+			m_as.movzxByte(FLAG_N, field(m_layout.flagN));
+			m_as.movzxByte(FLAG_Z, field(m_layout.flagZ));
+			m_as.movzxByte(FLAG_C, field(m_layout.flagC));
+			m_as.movzxByte(FLAG_V, field(m_layout.flagV));
+			m_as.alu(ALU_XOR, EXTRA, EXTRA);
+			m_as.alu(ALU_XOR, LAST_EXTRA, LAST_EXTRA);
+		}
+
+		// An exit at the end of the block or a jump adds what it ran to the totals and carries on into the block at the program counter,
+		// with the registers as they are, if there's budget left and that block has been translated. Anything else leaves as usual
+		void chain()
+		{
+			Assembler::Label leave = m_as.label();
+			m_as.bind(m_chain);
+			m_as.alu(ALU_ADD, stack(TOTAL_INSTRUCTIONS), RAX);
+			m_as.alu(ALU_ADD, RDX, EXTRA);
+			m_as.alu(ALU_ADD, stack(TOTAL_CYCLES), RDX);
+			m_as.alu(ALU_XOR, EXTRA, EXTRA);
+			m_as.mov(RSI, stack(TOTAL_CYCLES));
+			m_as.alu(ALU_CMP, RSI, stack(BUDGET));
+			m_as.jcc(ABOVE_EQUAL, leave);
+
+			m_as.mov(RSI, RCX);										// m_blockTable[pc]->native
+			m_as.shl(RSI, 3);
+			m_as.mov64(RAX, m_table);
+			m_as.mov64(RAX, { RAX, RSI, 0 });
+			m_as.test64(RAX, RAX);
+			m_as.jcc(EQUAL, leave);
+			m_as.mov64(RSI, { RAX, -1, m_layout.native });
+			m_as.test64(RSI, RSI);
+			m_as.jcc(EQUAL, leave);
+
+			m_as.store64(field(m_layout.block), RAX);
+			m_as.alu(ALU_XOR, RAX, RAX);
+			m_as.alu(ALU_XOR, LAST_EXTRA, LAST_EXTRA);
+			m_as.add64(RSI, static_cast<DWord>(m_body));
+			m_as.jmp(RSI);
+
+			m_as.bind(leave);										// it's all in the totals already
+			m_as.alu(ALU_XOR, RAX, RAX);
+			m_as.alu(ALU_XOR, RDX, RDX);
+		}
+
+		// Every exit comes here with the program counter in ecx, the instructions run in eax and their base cycles in edx, on top of the
+		// totals of the blocks chained through
+		void epilogue()
+		{
+			m_as.bind(m_epilogue);
+			m_as.storeByte(field(m_layout.a), REG_A);
+			m_as.storeByte(field(m_layout.x), REG_X);
+			m_as.storeByte(field(m_layout.y), REG_Y);
+			m_as.storeWord(field(m_layout.s), REG_S);
+			m_as.storeWord(field(m_layout.p), RCX);
+			m_as.storeByte(field(m_layout.flagN), FLAG_N);
+			m_as.storeByte(field(m_layout.flagZ), FLAG_Z);
+			m_as.storeByte(field(m_layout.flagC), FLAG_C);
+			m_as.storeByte(field(m_layout.flagV), FLAG_V);
+
+			m_as.alu(ALU_ADD, RDX, EXTRA);
+			m_as.alu(ALU_ADD, RAX, stack(TOTAL_INSTRUCTIONS));
+			m_as.alu(ALU_ADD, RDX, stack(TOTAL_CYCLES));
+			m_as.shl64(RDX, 32);
+			m_as.or64(RAX, RDX);
+
+			m_as.addRsp(FRAME_SIZE);
+#ifdef _WIN32
+			m_as.pop(RDI);
+			m_as.pop(RSI);
+#endif
+			for (Reg reg : { R15, R14, R13, R12, RBP, RBX }) m_as.pop(reg);
+			m_as.ret();
+		}
+
+		void setNZ(Reg reg)
+		{
+			m_as.mov(FLAG_N, reg);
+			m_as.mov(FLAG_Z, reg);
+		}
+
+		// Same as the interpreters' addressing, including m_addrVal not being wrapped for the indexed modes. An access that could land on
+		// a device is checked before anything has changed so the block can back out and leave the instruction to the interpreter
+		Operand address(const Source& source, bool setAddrVal)
+		{
+			Address_Mode mode = source.info->mode;
+			Byte zp = static_cast<Byte>(source.operand);
+
+			switch (mode)
+			{
+			case ZP0:
+			case ABS:
+				if (setAddrVal) m_as.storeDWord(field(m_layout.addrVal), DWord(source.operand));
+				return { true, source.operand, RAX };
+			case ZPX:
+			case ZPY:												// at most $01FE, translatable() checked those pages
+				m_as.lea(RCX, { mode == ZPX ? REG_X : REG_Y, -1, zp });
+				if (setAddrVal) m_as.storeDWord(field(m_layout.addrVal), RCX);
+				return { false, 0, RCX };
+			case ABX:
+			case ABY:
+			{
+				Reg index = (mode == ABX) ? REG_X : REG_Y;
+				m_as.lea(RDX, { index, -1, source.operand });
+				m_as.movzxWord(RCX, RDX);
+				m_as.lea(RSI, { index, -1, source.operand & 0xFF });
+				m_as.shr(RSI, 8);
+				break;
+			}
+			case IZX:
+				m_as.lea(RAX, { REG_X, -1, zp });
+				m_as.movzxByte(RAX, RAX);
+				m_as.movzxByte(RCX, bus(RAX));
+				m_as.inc(RAX);
+				m_as.movzxByte(RAX, RAX);
+				m_as.movzxByte(RAX, bus(RAX));
+				m_as.shl(RAX, 8);
+				m_as.alu(ALU_OR, RCX, RAX);
+				m_as.mov(RDX, RCX);
+				break;
+			case IZY:
+				m_as.movzxByte(RCX, bus(Word(zp)));
+				m_as.movzxByte(RAX, bus(Word(zp + 1)));
+				m_as.movzxByte(RSI, RCX);
+				m_as.alu(ALU_ADD, RSI, REG_Y);
+				m_as.shr(RSI, 8);
+				m_as.shl(RAX, 8);
+				m_as.alu(ALU_OR, RCX, RAX);
+				m_as.lea(RDX, { RCX, REG_Y, 0 });
+				m_as.movzxWord(RCX, RDX);
+				break;
+			default:
+				break;
+			}
+
+			m_as.mov(RAX, RCX);
+			m_as.shr(RAX, 8);
+			m_as.testByte({ CPU_REG, RAX, m_layout.pageWatch }, m_io);
+			m_as.jcc(NOT_EQUAL, coldExit(before(m_index)));
+
+			if (setAddrVal) m_as.storeDWord(field(m_layout.addrVal), RDX);
+			if (crossesPages(mode))
+			{
+				m_as.mov(LAST_EXTRA, RSI);
+				m_as.alu(ALU_ADD, EXTRA, RSI);
+			}
+			return { false, 0, RCX };
+		}
+
+		// Stores val, the same as emu6502::write. A page that isn't plain ram without cached code goes through Jit::write instead, so rom
+		// is left alone and a write over cached code invalidates it. If that was the block being run it stops after this instruction,
+		// unless the instruction ends the block anyway. esi is the scratch register, val can be eax
+		void write(const Operand& operand, Reg val)
+		{
+			Assembler::Label slow = m_as.label();
+			Assembler::Label resume = m_as.label();
+
+			if (operand.fixed)
+				m_as.cmpByte(field(m_layout.pageWatch + (operand.addr >> 8)), 0);
+			else
+			{
+				m_as.mov(RSI, operand.reg);
+				m_as.shr(RSI, 8);
+				m_as.cmpByte({ CPU_REG, RSI, m_layout.pageWatch }, 0);
+			}
+			m_as.jcc(NOT_EQUAL, slow);
+			m_as.storeByte(at(operand), val);
+			m_as.bind(resume);
+
+			bool last = transfers((*m_block)[m_index].info->operation);
+			Exit stop = after();
+			m_cold.push_back([this, slow, resume, operand, val, last, stop]
+			{
+				const Reg SAVED[] = { R8, R9, R10, R11, RDI, RSI, RCX, RDX };
+				m_as.bind(slow);
+				for (Reg reg : SAVED) m_as.push(reg);
+				if (SHADOW_SPACE) m_as.subRsp(SHADOW_SPACE);
+				if (operand.fixed)
+					m_as.mov(ARG1, DWord(operand.addr));
+				else
+					m_as.mov(ARG1, operand.reg);
+				m_as.mov(ARG2, val);
+				m_as.mov64(ARG0, CPU_REG);
+				m_as.mov64(RAX, m_write);
+				m_as.call(RAX);
+				if (SHADOW_SPACE) m_as.addRsp(SHADOW_SPACE);
+				for (size_t i = sizeof(SAVED) / sizeof(SAVED[0]); i-- > 0; ) m_as.pop(SAVED[i]);
+				if (!last)
+				{
+					m_as.testByte(RAX, RAX);
+					m_as.jcc(EQUAL, coldExit(stop));
+				}
+				m_as.jmp(resume);
+			});
+		}
+
+		// A read of a device's register, which the device can answer however it likes, e.g. the keyboard strobe is cleared by reading the
+		// key. The value comes back in eax
+		void readDevice(Word addr)
+		{
+			const Reg SAVED[] = { R8, R9, R10, R11, RDI, RSI, RCX, RDX };
+			for (Reg reg : SAVED) m_as.push(reg);
+			if (SHADOW_SPACE) m_as.subRsp(SHADOW_SPACE);
+			m_as.mov(ARG1, DWord(addr));
+			m_as.mov64(ARG0, CPU_REG);
+			m_as.mov64(RAX, m_read);
+			m_as.call(RAX);
+			if (SHADOW_SPACE) m_as.addRsp(SHADOW_SPACE);
+			for (size_t i = sizeof(SAVED) / sizeof(SAVED[0]); i-- > 0; ) m_as.pop(SAVED[i]);
+			m_as.movzxByte(RAX, RAX);
+		}
+
+		// The address for write(m_cpu.s--, val) goes in addr, the stack pointer is 16 bits and wraps freely
+		void push(Reg addr)
+		{
+			m_as.mov(addr, REG_S);
+			m_as.dec(REG_S);
+			m_as.movzxWord(REG_S, REG_S);
+		}
+
+		// The stack pointer is 16 bits so a pull can come from anywhere, one from a device backs out before the instruction like address()
+		void checkPull(int count)
+		{
+			for (int i = 1; i <= count; ++i)
+			{
+				m_as.lea(RSI, { REG_S, -1, i });
+				m_as.movzxWord(RSI, RSI);
+				m_as.shr(RSI, 8);
+				m_as.testByte({ CPU_REG, RSI, m_layout.pageWatch }, m_io);
+				m_as.jcc(NOT_EQUAL, coldExit(before(m_index)));
+			}
+		}
+
+		// m_bus[++m_cpu.s], after checkPull
+		void pull(Reg dst)
+		{
+			m_as.inc(REG_S);
+			m_as.movzxWord(REG_S, REG_S);
+			m_as.movzxByte(dst, bus(REG_S));
+		}
+
+		void adc()
+		{
+			m_as.mov(RDX, REG_A);
+			m_as.alu(ALU_ADD, RDX, RAX);
+			m_as.alu(ALU_ADD, RDX, FLAG_C);
+			m_as.mov(RSI, REG_A);									// V = ~(a ^ val) & (a ^ result)
+			m_as.alu(ALU_XOR, RSI, RAX);
+			m_as.bitNot(RSI);
+			m_as.mov(RCX, REG_A);
+			m_as.alu(ALU_XOR, RCX, RDX);
+			m_as.alu(ALU_AND, RSI, RCX);
+			m_as.mov(FLAG_V, RSI);
+			m_as.mov(FLAG_C, RDX);
+			m_as.shr(FLAG_C, 8);
+			m_as.movzxByte(REG_A, RDX);
+			setNZ(REG_A);
+		}
+
+		void compare(Reg reg)
+		{
+			m_as.alu(ALU_XOR, FLAG_C, FLAG_C);
+			m_as.alu(ALU_CMP, reg, RAX);
+			m_as.setcc(ABOVE_EQUAL, FLAG_C);
+			m_as.mov(RDX, reg);
+			m_as.alu(ALU_SUB, RDX, RAX);
+			setNZ(RDX);
+		}
+
+		void read(const Source& source)
+		{
+			Operation op = source.info->operation;
+
+			if (source.info->mode == IMM)
+			{
+				m_as.mov(RAX, DWord(source.operand & 0xFF));
+				if (op != Operation::SBC) m_as.storeDWord(field(m_layout.addrVal), DWord(source.operand & 0xFF));
+			}
+			else
+			{
+				Operand operand = address(source, op == Operation::BIT);		// BIT leaves the address in m_addrVal, the rest the value read
+				if (operand.fixed and io(operand.addr >> 8))
+					readDevice(operand.addr);
+				else
+					m_as.movzxByte(RAX, at(operand));
+				if (op != Operation::BIT and op != Operation::SBC) m_as.storeDWord(field(m_layout.addrVal), RAX);
+			}
+
+			switch (op)
+			{
+			case Operation::LDA: m_as.mov(REG_A, RAX); setNZ(REG_A); break;
+			case Operation::LDX: m_as.mov(REG_X, RAX); setNZ(REG_X); break;
+			case Operation::LDY: m_as.mov(REG_Y, RAX); setNZ(REG_Y); break;
+			case Operation::AND: m_as.alu(ALU_AND, REG_A, RAX); setNZ(REG_A); break;
+			case Operation::ORA: m_as.alu(ALU_OR, REG_A, RAX); setNZ(REG_A); break;
+			case Operation::EOR: m_as.alu(ALU_XOR, REG_A, RAX); setNZ(REG_A); break;
+			case Operation::ADC: adc(); break;
+			case Operation::SBC:
+				m_as.alu(ALU_XOR, RAX, DWord(0xFF));
+				m_as.storeDWord(field(m_layout.addrVal), RAX);
+				adc();
+				break;
+			case Operation::CMP: compare(REG_A); break;
+			case Operation::CPX: compare(REG_X); break;
+			case Operation::CPY: compare(REG_Y); break;
+			case Operation::BIT:
+				m_as.mov(FLAG_Z, REG_A);
+				m_as.alu(ALU_AND, FLAG_Z, RAX);
+				m_as.mov(FLAG_N, RAX);
+				m_as.lea(FLAG_V, { RAX, RAX, 0 });
+				break;
+			default:
+				break;
+			}
+		}
+
+		void store(const Source& source)
+		{
+			Operand operand = address(source, true);
+			Operation op = source.info->operation;
+			write(operand, op == Operation::STA ? REG_A : op == Operation::STX ? REG_X : REG_Y);
+		}
+
+		// Value in eax
+		void shift(Operation op, bool accumulator)
+		{
+			switch (op)
+			{
+			case Operation::ASL:
+				m_as.mov(FLAG_C, RAX);
+				m_as.shr(FLAG_C, 7);
+				m_as.alu(ALU_ADD, RAX, RAX);
+				m_as.movzxByte(RAX, RAX);
+				break;
+			case Operation::LSR:
+				m_as.mov(FLAG_C, RAX);
+				m_as.alu(ALU_AND, FLAG_C, DWord(1));
+				m_as.shr(RAX, 1);
+				break;
+			case Operation::ROL:
+				m_as.mov(RDX, RAX);
+				m_as.shr(RDX, 7);
+				m_as.alu(ALU_ADD, RAX, RAX);
+				m_as.alu(ALU_OR, RAX, FLAG_C);
+				m_as.movzxByte(RAX, RAX);
+				m_as.mov(FLAG_C, RDX);
+				break;
+			case Operation::ROR:
+				m_as.mov(RDX, RAX);
+				m_as.alu(ALU_AND, RDX, DWord(1));
+				m_as.shr(RAX, 1);
+				if (!accumulator)									// the accumulator ROR never rotates the carry in, same as the interpreters
+				{
+					m_as.mov(RSI, FLAG_C);
+					m_as.shl(RSI, 7);
+					m_as.alu(ALU_OR, RAX, RSI);
+				}
+				m_as.mov(FLAG_C, RDX);
+				break;
+			case Operation::INC:
+				m_as.inc(RAX);
+				m_as.movzxByte(RAX, RAX);
+				break;
+			case Operation::DEC:
+				m_as.dec(RAX);
+				m_as.movzxByte(RAX, RAX);
+				break;
+			default:
+				break;
+			}
+		}
+
+		void modify(const Source& source)
+		{
+			if (source.info->mode == IMP)
+			{
+				m_as.mov(RAX, REG_A);
+				shift(source.info->operation, true);
+				m_as.mov(REG_A, RAX);
+				setNZ(REG_A);
+				return;
+			}
+
+			Operand operand = address(source, true);
+			m_as.movzxByte(RAX, at(operand));
+			shift(source.info->operation, false);
+			setNZ(RAX);
+			write(operand, RAX);
+		}
+
+		void branch(const Source& source)
+		{
+			Byte rel = static_cast<Byte>(source.operand);
+			m_as.storeByte(field(m_layout.addrRel), rel);
+			m_as.storeDWord(field(m_layout.addrVal), DWord(rel));
+
+			Reg flag;
+			Byte mask = 0x80;
+			bool set;
+			switch (source.info->operation)
+			{
+			case Operation::BPL: flag = FLAG_N; set = false; break;
+			case Operation::BMI: flag = FLAG_N; set = true;	 break;
+			case Operation::BVC: flag = FLAG_V; set = false; break;
+			case Operation::BVS: flag = FLAG_V; set = true;	 break;
+			case Operation::BCC: flag = FLAG_C; set = false; mask = 0xFF; break;
+			case Operation::BCS: flag = FLAG_C; set = true;	 mask = 0xFF; break;
+			case Operation::BNE: flag = FLAG_Z; set = true;	 mask = 0xFF; break;		// Z is set when the byte is 0
+			default:			 flag = FLAG_Z; set = false; mask = 0xFF; break;
+			}
+
+			Assembler::Label taken = m_as.label();
+			m_as.testByte(flag, mask);
+			m_as.jcc(set ? NOT_EQUAL : EQUAL, taken);
+			exit(after());
+
+			m_as.bind(taken);											// +1 cycle for a successful branch
+			m_as.inc(EXTRA);
+			Exit jump = after();
+			jump.pc = Word(source.next + static_cast<S_Byte>(rel));
+			++jump.lastCycles;
+			jump.delayLoop = source.info->operation == Operation::BNE and (rel == 0xFD or rel == 0xF8);
+			exit(jump);
+		}
+
+		void instruction(const Source& source)
+		{
+			switch (source.info->access)
+			{
+			case Access::READ:	read(source);	return;
+			case Access::WRITE: store(source);	return;
+			case Access::RMW:	modify(source); return;
+			default:			break;
+			}
+
+			Exit jump = after();
+			switch (source.info->operation)
+			{
+			case Operation::BPL: case Operation::BMI: case Operation::BVC: case Operation::BVS:
+			case Operation::BCC: case Operation::BCS: case Operation::BNE: case Operation::BEQ:
+				branch(source);
+				break;
+			case Operation::JMP:
+				m_as.storeDWord(field(m_layout.addrVal), DWord(source.operand));
+				jump.pc = source.operand;
+				exit(jump);
+				break;
+			case Operation::JSR:
+				m_as.storeDWord(field(m_layout.addrVal), DWord(source.operand));
+				push(RCX);
+				push(RDX);
+				m_as.mov(RAX, DWord(source.next >> 8));
+				write({ false, 0, RCX }, RAX);
+				m_as.mov(RAX, DWord(source.next & 0xFF));
+				write({ false, 0, RDX }, RAX);
+				jump.pc = source.operand;
+				exit(jump);
+				break;
+			case Operation::RTS:
+				checkPull(2);
+				pull(RCX);
+				pull(RAX);
+				m_as.shl(RAX, 8);
+				m_as.alu(ALU_OR, RCX, RAX);
+				jump.pcInEcx = true;
+				exit(jump);
+				break;
+			// PLA doesn't set flags and TSX/TXS go through the stack memory, same as the interpreters
+			case Operation::PHA:
+			case Operation::TXS:
+				push(RCX);
+				write({ false, 0, RCX }, source.info->operation == Operation::PHA ? REG_A : REG_X);
+				break;
+			case Operation::PLA: checkPull(1); pull(REG_A); break;
+			case Operation::TSX: checkPull(1); pull(REG_X); setNZ(REG_X); break;
+			case Operation::TAX: m_as.mov(REG_X, REG_A); setNZ(REG_X); break;
+			case Operation::TXA: m_as.mov(REG_A, REG_X); setNZ(REG_A); break;
+			case Operation::TAY: m_as.mov(REG_Y, REG_A); setNZ(REG_Y); break;
+			case Operation::TYA: m_as.mov(REG_A, REG_Y); setNZ(REG_A); break;
+			case Operation::INX: m_as.inc(REG_X); m_as.movzxByte(REG_X, REG_X); setNZ(REG_X); break;
+			case Operation::DEX: m_as.dec(REG_X); m_as.movzxByte(REG_X, REG_X); setNZ(REG_X); break;
+			case Operation::INY: m_as.inc(REG_Y); m_as.movzxByte(REG_Y, REG_Y); setNZ(REG_Y); break;
+			case Operation::DEY: m_as.dec(REG_Y); m_as.movzxByte(REG_Y, REG_Y); setNZ(REG_Y); break;
+			case Operation::CLC: m_as.alu(ALU_XOR, FLAG_C, FLAG_C); break;
+			case Operation::SEC: m_as.mov(FLAG_C, DWord(1)); break;
+			case Operation::CLV: m_as.alu(ALU_XOR, FLAG_V, FLAG_V); break;
+			default:											// NOP and the undefined opcodes only use up cycles
+				break;
+			}
+		}
+
+		Assembler							m_as;
+		Layout								m_layout;
+		QWord								m_write;				// address of Jit::write
+		QWord								m_read;					// address of Jit::read
+		QWord								m_table;				// emu6502::m_blockTable's entries
+		const Byte*							m_watch;				// emu6502::m_pageWatch
+		Byte								m_io;					// emu6502::WATCH_IO
+		const std::vector<Source>*			m_block;
+		size_t								m_index;				// the instruction being translated
+		std::vector<DWord>					m_baseCycles;			// base cycles of the instructions before each one
+		size_t								m_body;					// see body()
+		Assembler::Label					m_chain;
+		Assembler::Label					m_epilogue;
+		std::vector<std::function<void()>>	m_cold;
+	};
+}
+
+Jit::Jit()
+	: m_arena(nullptr), m_size(ARENA_SIZE), m_used(0)
+{
+#ifdef _WIN32
+	m_arena = static_cast<Byte*>(VirtualAlloc(nullptr, m_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+#else
+	void* arena = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	m_arena = (arena == MAP_FAILED) ? nullptr : static_cast<Byte*>(arena);
+#endif
+}
+
+Jit::~Jit()
+{
+	if (m_arena == nullptr) return;
+#ifdef _WIN32
+	VirtualFree(m_arena, 0, MEM_RELEASE);
+#else
+	munmap(m_arena, m_size);
+#endif
+}
+
+bool Jit::ready() const
+{
+	return m_arena != nullptr;
+}
+
+bool Jit::compile(emu6502& cpu, emu6502::Block& block)
+{
+	block.jitTried = true;
+	if (!ready()) return false;
+
+	const Byte* base = reinterpret_cast<const Byte*>(&cpu);
+	auto offset = [base](const void* member) { return static_cast<int32_t>(static_cast<const Byte*>(member) - base); };
+
+	Layout layout;
+	layout.a		= offset(&cpu.m_cpu.a.get());
+	layout.x		= offset(&cpu.m_cpu.x.get());
+	layout.y		= offset(&cpu.m_cpu.y.get());
+	layout.flags	= offset(&cpu.m_cpu.flags.get());
+	layout.p		= offset(&cpu.m_cpu.p.get());
+	layout.s		= offset(&cpu.m_cpu.s.get());
+	layout.flagN	= offset(&cpu.m_flagN);
+	layout.flagZ	= offset(&cpu.m_flagZ);
+	layout.flagC	= offset(&cpu.m_flagC);
+	layout.flagV	= offset(&cpu.m_flagV);
+	layout.addrVal	= offset(&cpu.m_addrVal.get());
+	layout.addrRel	= offset(&cpu.m_addrRel.get());
+	layout.opcode	= offset(&cpu.m_opcode);
+	layout.cycles	= offset(&cpu.m_cycles);
+	layout.bus		= offset(cpu.m_memory.getBus());
+	layout.pageWatch = offset(cpu.m_pageWatch);
+	layout.block	= offset(&cpu.m_block);
+	layout.blockEntry = offset(&cpu.m_blockEntry);
+	layout.skipLoops = offset(&cpu.m_skipLoops);
+	layout.native	= static_cast<int32_t>(reinterpret_cast<const Byte*>(&block.native) - reinterpret_cast<const Byte*>(&block));
+
+	std::vector<Source> sources;
+	sources.reserve(block.instructions.size());
+	for (const emu6502::DecodedInstruction& instruction : block.instructions)
+		sources.push_back({ &OPCODES[instruction.opcode], instruction.pc, instruction.next, instruction.operand, instruction.opcode });
+
+	Translator translator(layout, reinterpret_cast<QWord>(&Jit::write), reinterpret_cast<QWord>(&Jit::read),
+						  reinterpret_cast<QWord>(cpu.m_blockTable.data()), cpu.m_pageWatch, emu6502::WATCH_IO);
+	if (!translator.translate(sources)) return false;
+
+	const std::vector<Byte>& code = translator.code();
+	if (code.size() > m_size) return false;
+	if (m_used + code.size() > m_size) reset(cpu);
+
+	// The arena is only ever writable or executable, never both
+#ifdef _WIN32
+	DWORD old;
+	VirtualProtect(m_arena, m_size, PAGE_READWRITE, &old);
+	std::memcpy(m_arena + m_used, code.data(), code.size());
+	VirtualProtect(m_arena, m_size, PAGE_EXECUTE_READ, &old);
+	FlushInstructionCache(GetCurrentProcess(), m_arena + m_used, code.size());
+#else
+	mprotect(m_arena, m_size, PROT_READ | PROT_WRITE);
+	std::memcpy(m_arena + m_used, code.data(), code.size());
+	mprotect(m_arena, m_size, PROT_READ | PROT_EXEC);
+#endif
+
+	block.native = reinterpret_cast<emu6502::NativeBlock>(m_arena + m_used);
+	m_used = (m_used + code.size() + 15) & ~size_t(15);
+	return true;
+}
+
+Byte Jit::write(emu6502* cpu, DWord addr, DWord val)
+{
+	cpu->watchWrite(static_cast<Word>(addr), static_cast<Byte>(val));
+	return cpu->m_block->valid and !(cpu->m_pageWatch[static_cast<Word>(addr) >> 8] & emu6502::WATCH_IO);
+}
+
+Byte Jit::read(emu6502* cpu, DWord addr)
+{
+	return cpu->m_memory.read(static_cast<Word>(addr));
+}
+
+void Jit::reset(emu6502& cpu)
+{
+	for (std::pair<const Word, emu6502::Block>& entry : cpu.m_blocks)
+	{
+		entry.second.native = nullptr;
+		entry.second.jitTried = false;
+	}
+	m_used = 0;
+}
+
+#else
+
+Jit::Jit()
+	: m_arena(nullptr), m_size(0), m_used(0) {	}
+
+Jit::~Jit() {	}
+
+bool Jit::ready() const
+{
+	return false;
+}
+
+bool Jit::compile(emu6502&, emu6502::Block& block)
+{
+	block.jitTried = true;
+	return false;
+}
+
+Byte Jit::write(emu6502* cpu, DWord addr, DWord val)
+{
+	cpu->watchWrite(static_cast<Word>(addr), static_cast<Byte>(val));
+	return cpu->m_block->valid and !(cpu->m_pageWatch[static_cast<Word>(addr) >> 8] & emu6502::WATCH_IO);
+}
+
+Byte Jit::read(emu6502* cpu, DWord addr)
+{
+	return cpu->m_memory.read(static_cast<Word>(addr));
+}
+
+void Jit::reset(emu6502&)
+{
+	m_used = 0;
+}
+
+#endif
+
+/*			END
+* x86-64 recompiler */
@@ -0,0 +1,56 @@
+#pragma once
+#include "Bit.h"
+#include "emu6502.h"
+
+// The recompiler is only built for x86-64, everywhere else Jit::ready() is false and setJit(true) does nothing
+#if defined(__x86_64__) || defined(_M_X64)
+	#define EMU_JIT_X64
+#endif
+
+/*
+	Translates hot blocks from the block cache into x86-64 code. A, X, Y, S and the lazy N, Z, C and V live in host registers while a
+	block runs and are written back when it leaves. A block that ends at a jump or runs off its end goes straight into the translated
+	block at the program counter with everything still in registers, until the budget it was called with is used up, so a loop that stays
+	in translated code only pays for the call in and out once. The code goes into an executable arena, when that fills up every translation
+	is thrown away and blocks get translated again as they heat back up.
+
+	Things the translation leaves to the interpreter:
+		- anything that packs or unpacks the status register or changes I or D (PHP, PLP, RTI, BRK, SEI, CLI, SED, CLD) and JMP (ind)
+		- absolute and zero page stores to a device such as the display. Reads of one, like the keyboard polling loop, call Jit::read.
+		  An indexed or indirect access or a pull that lands on a device backs out before it
+		- ADC with decimal mode set, checked once on the way in since nothing translated can change D
+	A store to a page with cached code or rom calls back into the block cache, and if it wrote over the block being run the block stops there.
+	A BNE back over a delay loop returns instead of chaining while loop skipping is on, so run gets to skip it
+*/
+
+namespace Emu
+{
+
+class Jit
+{
+public:
+						Jit						();
+
+						~Jit					();
+
+	bool				ready					()										const;		// The arena is mapped and this is an x86-64 build
+
+	bool				compile					(emu6502& cpu,									// Translates the block and sets block.native, false if not even
+												 emu6502::Block& block);						// its first instruction can be translated
+
+private:
+	static	Byte		write					(emu6502* cpu,									// Called from translated code for a store to a watched page.
+												 DWord addr,									// Returns whether the running block is still valid and can
+												 DWord val);									// carry on
+
+	static	Byte		read					(emu6502* cpu,									// Called from translated code for a read of a device
+												 DWord addr);
+
+	void				reset					(emu6502& cpu);									// Drops every translation and empties the arena
+
+	Byte*	m_arena;
+	size_t	m_size;
+	size_t	m_used;
+};
+
+}
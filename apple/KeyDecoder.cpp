@@ -0,0 +1,114 @@
+#include "KeyDecoder.h"
+
+using namespace Emu;
+
+namespace
+{
+	const Byte ESCAPE_KEY = 0x1B;
+	const Byte RETURN_KEY = 0x0D;
+}
+
+KeyDecoder::KeyDecoder()
+	: m_state(State::GROUND), m_param(0), m_params(0)
+{
+}
+
+KeyDecoder::Event KeyDecoder::feed(const Byte& byte)
+{
+	Event event;
+
+	switch (m_state)
+	{
+	case State::GROUND:
+		if (byte == ESCAPE_KEY)
+			m_state = State::ESCAPE;
+		else
+			event.key = byte == '\n' ? RETURN_KEY : byte;
+		break;
+
+	case State::ESCAPE:
+		if (byte == 'O')
+			m_state = State::SS3;
+		else if (byte == '[')
+		{
+			m_state = State::CSI;
+			m_param = m_params = 0;
+		}
+		else if (byte == ESCAPE_KEY)
+			event.key = ESCAPE_KEY;										// the first one was the key, this one might start a sequence
+		else
+		{
+			m_state = State::GROUND;									// alt and a key, the key is what's wanted
+			event.key = byte == '\n' ? RETURN_KEY : byte;
+		}
+		break;
+
+	case State::SS3:
+		m_state = State::GROUND;
+		if (byte >= 'P' and byte <= 'S') event = function(byte - 'P' + 1);
+		break;
+
+	case State::CSI:
+		if (byte == '[' and m_params == 0)
+			m_state = State::CONSOLE;
+		else if (byte >= '0' and byte <= '9')
+		{
+			if (m_params == 0) m_params = 1;
+			if (m_params == 1) m_param = m_param * 10 + (byte - '0');
+		}
+		else if (byte == ';')
+			m_params = m_params == 0 ? 2 : m_params + 1;
+		else if (byte >= 0x40 and byte <= 0x7E)
+			event = finish(byte);
+		else if (byte < 0x20 or byte > 0x3F)
+			m_state = State::GROUND;									// not a sequence after all, drop it
+		break;
+
+	case State::CONSOLE:
+		m_state = State::GROUND;
+		if (byte >= 'A' and byte <= 'E') event = function(byte - 'A' + 1);
+		break;
+	}
+
+	return event;
+}
+
+KeyDecoder::Event KeyDecoder::flush()
+{
+	Event event;
+	if (m_state == State::ESCAPE) event.key = ESCAPE_KEY;
+	m_state = State::GROUND;
+	return event;
+}
+
+bool KeyDecoder::pending() const
+{
+	return m_state != State::GROUND;
+}
+
+KeyDecoder::Event KeyDecoder::function(Byte number)
+{
+	Event event;
+	event.function = number;
+	return event;
+}
+
+KeyDecoder::Event KeyDecoder::finish(const Byte& last)
+{
+	m_state = State::GROUND;
+
+	if (last >= 'P' and last <= 'S') return function(last - 'P' + 1);
+	if (last != '~') return Event();
+
+	switch (m_param)
+	{
+	case 11: case 12: case 13: case 14: case 15:
+		return function(static_cast<Byte>(m_param - 10));
+	case 17: case 18: case 19: case 20: case 21:
+		return function(static_cast<Byte>(m_param - 11));
+	case 23: case 24:
+		return function(static_cast<Byte>(m_param - 12));
+	default:
+		return Event();
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "Bit.h"
+
+namespace Emu
+{
+
+/*
+	Turns the bytes a terminal sends into keys, one byte at a time so a sequence split across reads picks up where it left off. The
+	function keys come in as escape sequences, the ones xterm and the Linux console send are understood:
+
+		ESC O P..S			F1-F4
+		ESC [ 11~..15~		F1-F5, then 17~..21~ for F6-F10 and 23~ 24~ for F11 F12. A modifier (ESC [ 15;2~) is ignored
+		ESC [ 1;2P..S		F1-F4 with a modifier
+		ESC [ [ A..E		F1-F5 on the Linux console
+
+	Anything else that starts with ESC [ or ESC O is swallowed whole, the arrows included. A lone ESC can't be told from the start of a
+	sequence until nothing else comes, so the caller waits a little and then calls flush() to get it as the ESC key.
+*/
+class KeyDecoder
+{
+public:
+	struct Event
+	{
+		Byte		key		 = 0;				// a plain key, return for both \r and \n
+		Byte		function = 0;				// 1-12 for a function key, then key is 0
+	};
+
+						 KeyDecoder			();
+
+		Event			 feed				(const Byte& byte);												// Nothing in the event until a key is complete
+
+		Event			 flush				();																// Gives up on a sequence that stopped, a lone ESC is the ESC key
+
+		bool			 pending			()													 const;		// Part way through a sequence
+
+private:
+		Event			 function			(Byte number);
+
+		Event			 finish				(const Byte& last);											// The final byte of an ESC [ sequence arrived
+
+	enum class State : Byte
+	{
+		GROUND,
+		ESCAPE,							// had ESC
+		SS3,							// ESC O
+		CSI,							// ESC [ and maybe some parameters
+		CONSOLE							// ESC [ [
+	};
+
+	State		m_state;
+	unsigned	m_param;				// the first parameter of a CSI sequence
+	Byte		m_params;				// how many parameters have started
+};
+
+}
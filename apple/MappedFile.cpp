@@ -0,0 +1,68 @@
+#include "MappedFile.h"
+#ifdef __linux__
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#else
+	#include <fstream>
+#endif
+
+using namespace Emu;
+
+namespace
+{
+	const size_t MAP_THRESHOLD = 1 << 20;			// smaller than this and one read costs less than setting up and tearing down a mapping
+}
+
+MappedFile::MappedFile(const char* fname)
+{
+#ifdef __linux__
+	int fd = open(fname, O_RDONLY);
+	if (fd < 0) return;
+	struct stat info;
+	if (fstat(fd, &info) != 0) info.st_size = 0;
+	if (static_cast<size_t>(info.st_size) >= MAP_THRESHOLD)
+	{
+		void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapped != MAP_FAILED)
+		{
+			m_data = static_cast<const Byte*>(mapped);
+			m_size = info.st_size;
+			m_mapped = true;
+		}
+	}
+	else if (info.st_size > 0)
+	{
+		m_buffer.resize(info.st_size);
+		size_t done = 0;
+		while (done < m_buffer.size())
+		{
+			ssize_t count = read(fd, m_buffer.data() + done, m_buffer.size() - done);
+			if (count <= 0) break;
+			done += count;
+		}
+		if (done == m_buffer.size())
+		{
+			m_data = m_buffer.data();
+			m_size = m_buffer.size();
+		}
+	}
+	close(fd);
+#else
+	std::ifstream file(fname, std::ios::binary | std::ios::ate);
+	if (file.fail()) return;
+	m_buffer.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	if (m_buffer.empty() or !file.read(reinterpret_cast<char*>(m_buffer.data()), m_buffer.size())) return;
+	m_data = m_buffer.data();
+	m_size = m_buffer.size();
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef __linux__
+	if (m_mapped) munmap(const_cast<Byte*>(m_data), m_size);
+#endif
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+#include "Bit.h"
+
+namespace Emu
+{
+
+/*
+	A file's contents, whole and read only, for as long as this is around. On Linux a big file is mapped so nothing is copied, one the
+	size of a rom or a snapshot is read in with one read(), which costs a few microseconds where mapping and unmapping it costs a dozen
+	or more. Read in elsewhere. data() is nullptr if the file couldn't be opened or is empty
+*/
+class MappedFile
+{
+public:
+	explicit			 MappedFile			(const char* fname);
+
+						~MappedFile			();
+
+						 MappedFile			(const MappedFile&) = delete;
+
+		MappedFile&		 operator=			(const MappedFile&) = delete;
+
+		const Byte*		 data				()													 const		{ return m_data; }
+
+		size_t			 size				()													 const		{ return m_size; }
+
+private:
+	const Byte*			m_data = nullptr;
+	size_t				m_size = 0;
+	std::vector<Byte>	m_buffer;						// where it was read into when it isn't mapped
+	bool				m_mapped = false;
+};
+
+}
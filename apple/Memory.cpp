@@ -3,16 +3,34 @@
 using namespace Emu;
 
 Memory::Memory()
-	: m_bus{ (Byte)0xFF }
+	: m_bus{ (Byte)0xFF }, m_devices(), m_pages()
 {
+	map(0x0000, 0xFFFF, Page::RAM);
 }
 
-Byte Emu::Memory::read(const Word& addr) const
+bool Memory::map(const Word& start, const Word& end, const Page& type, Device* device)
 {
-	return Byte();
+	if (type == Page::DEVICE and device == nullptr) return false;
+
+	for (size_t page = start >> 8; page <= static_cast<size_t>(end >> 8); ++page)
+	{
+		Byte* memory = m_bus + (page << 8);
+		m_write[page]	= (type == Page::RAM) ? memory : nullptr;
+		m_devices[page] = (type == Page::DEVICE) ? device : nullptr;
+		m_pages[page]	= type;
+	}
+	return true;
+}
+
+Memory::Page Memory::getPage(const Word& addr) const
+{
+	return m_pages[addr >> 8];
 }
 
-bool Emu::Memory::write(const Word& addr, const Byte& val)
+bool Memory::writeDevice(const Word& addr, const Byte& val)
 {
-	return false;
+	Device* device = m_devices[addr >> 8];
+	if (device == nullptr) return false;
+	device->write(addr, val);
+	return true;
 }
@@ -4,20 +4,72 @@
 namespace Emu
 {
 
+// Anything mapped onto the bus that isn't plain memory. It gets every read and write to its pages, including addresses it doesn't decode
+class Device
+{
+public:
+	virtual				~Device			() = default;
+
+	virtual	Byte		read			(const Word& addr) = 0;
+
+	virtual	void		write			(const Word& addr,
+										 const Byte& val) = 0;
+};
+
+/*
+	The 64K bus as a table of 256 pages, each one ram, rom or a device. Ram and rom are read straight out of the backing store, a single
+	indexed load once the page's device has been checked for, and the two loads don't wait on each other. Writing rom is ignored and only
+	device pages cost a call. Every page starts out as ram.
+
+	Instruction bytes are fetched from the backing store whatever the page is, code isn't run out of a device. getBus() hands out the
+	backing store for loading roms and snapshots, writes made through it go straight to memory and ignore the map.
+*/
 class Memory
 {
 public:
+	enum class Page : Byte { RAM, ROM, DEVICE };
+
 						 Memory			();
 
-		Byte			 read			(const Word& addr)									 const;
+inline	Byte			 read			(const Word& addr)									 const;
 
-		bool			 write			(const Word& addr, 
+inline	bool			 write			(const Word& addr,									// False if the page is rom and the write was ignored
 										 const Byte& val);
 
+inline	Byte			 fetch			(const Word& addr)									 const		{ return m_bus[addr]; }		// An instruction byte
+
+		bool			 map			(const Word& start,									// Maps the whole pages from start to end. A device page
+										 const Word& end,									// needs the device, which has to outlive the mapping
+										 const Page& type,
+										 Device* device = nullptr);
+
+		Page			 getPage		(const Word& addr)									 const;
+
 inline	Byte*			 getBus			()																			{ return m_bus; }
 
 private:
-	Byte m_bus[0xFFFF];
+		bool			 writeDevice	(const Word& addr,									// Write slow path for pages without a write pointer
+										 const Byte& val);
+
+	Byte	m_bus[0x10000];
+	Byte*	m_write[256];					// the page in m_bus, nullptr for rom and device pages
+	Device* m_devices[256];					// nullptr for ram and rom
+	Page	m_pages[256];
 };
 
-}
\ No newline at end of file
+inline Byte Memory::read(const Word& addr) const
+{
+	Device* device = m_devices[addr >> 8];
+	if (device == nullptr) return m_bus[addr];
+	return device->read(addr);
+}
+
+inline bool Memory::write(const Word& addr, const Byte& val)
+{
+	Byte* page = m_write[addr >> 8];
+	if (page == nullptr) return writeDevice(addr, val);
+	page[addr & 0xFF] = val;
+	return true;
+}
+
+}
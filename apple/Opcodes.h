@@ -0,0 +1,132 @@
+#pragma once
+#include <string_view>
+#include "Bit.h"
+
+/*
+	The opcode table. Everything the cores and the disassembler need to know about an opcode lives here, the lookup core builds its
+	table of member function pointers from it and the switch core instantiates one handler<Operation, Address_Mode> per entry at compile time.
+*/
+
+namespace Emu
+{
+
+	// Make it easy to determine which addressing mode we used. Now the addressing mode function can return which address mode it was
+	// with an Address_Mode enum that matches it's index in the ADDRESS_STRINGS array
+	enum Address_Mode
+	{
+		IMP, IMM, REL, ZP0, ZPX, ZPY, ABS, ABX, ABY, IND, IZX, IZY
+	};
+
+	// One for every instruction, in the same order as the instruction member functions. XXX is any undefined opcode
+	enum class Operation : Byte
+	{
+		ADC, AND, ASL, BCC, BCS, BEQ, BIT, BMI,
+		BNE, BPL, BRK, BVC, BVS, CLC, CLD, CLI,
+		CLV, CMP, CPX, CPY, DEC, DEX, DEY, EOR,
+		INC, INX, INY, JMP, JSR, LDA, LDX, LDY,
+		LSR, NOP, ORA, PHA, PHP, PLA, PLP, ROL,
+		ROR, RTI, RTS, SBC, SEC, SED, SEI, STA,
+		STX, STY, TAX, TAY, TSX, TXA, TXS, TYA,
+		XXX
+	};
+
+	// How the instruction uses its operand. READ loads it (or takes it straight from an immediate), WRITE stores a register to it and
+	// RMW modifies it in place, which is the accumulator when the addressing mode is implied
+	enum class Access : Byte
+	{
+		NONE, READ, WRITE, RMW
+	};
+
+	struct OpcodeInfo
+	{
+		std::string_view	mnemonic;			// the name of the opcode
+		Operation			operation;
+		Address_Mode		mode;
+		Byte				cycles;				// base cycles, page crossings and branches taken are added while executing
+		Access				access;
+	};
+
+	// Number of operand bytes following the opcode
+	constexpr Byte operandBytes(Address_Mode mode)
+	{
+		switch (mode)
+		{
+		case Address_Mode::IMP:
+			return 0;
+		case Address_Mode::ABS: case Address_Mode::ABX: case Address_Mode::ABY: case Address_Mode::IND:
+			return 2;
+		default:
+			return 1;
+		}
+	}
+
+	// Table of opcodes correctly indexed to their hex value
+	inline constexpr OpcodeInfo OPCODES[256] =
+	{
+		/* 00 */ { "BRK", Operation::BRK, Address_Mode::IMM, 7, Access::NONE },   { "ORA", Operation::ORA, Address_Mode::IZX, 6, Access::READ },   { "???", Operation::XXX, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::XXX, Address_Mode::IMP, 8, Access::NONE },
+		/* 04 */ { "???", Operation::NOP, Address_Mode::IMP, 3, Access::NONE },   { "ORA", Operation::ORA, Address_Mode::ZP0, 3, Access::READ },   { "ASL", Operation::ASL, Address_Mode::ZP0, 5, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 5, Access::NONE },
+		/* 08 */ { "PHP", Operation::PHP, Address_Mode::IMP, 3, Access::NONE },   { "ORA", Operation::ORA, Address_Mode::IMM, 2, Access::READ },   { "ASL", Operation::ASL, Address_Mode::IMP, 2, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 2, Access::NONE },
+		/* 0C */ { "???", Operation::NOP, Address_Mode::IMP, 4, Access::NONE },   { "ORA", Operation::ORA, Address_Mode::ABS, 4, Access::READ },   { "ASL", Operation::ASL, Address_Mode::ABS, 6, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 6, Access::NONE },
+		/* 10 */ { "BPL", Operation::BPL, Address_Mode::REL, 2, Access::NONE },   { "ORA", Operation::ORA, Address_Mode::IZY, 5, Access::READ },   { "???", Operation::XXX, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::XXX, Address_Mode::IMP, 8, Access::NONE },
+		/* 14 */ { "???", Operation::NOP, Address_Mode::IMP, 4, Access::NONE },   { "ORA", Operation::ORA, Address_Mode::ZPX, 4, Access::READ },   { "ASL", Operation::ASL, Address_Mode::ZPX, 6, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 6, Access::NONE },
+		/* 18 */ { "CLC", Operation::CLC, Address_Mode::IMP, 2, Access::NONE },   { "ORA", Operation::ORA, Address_Mode::ABY, 4, Access::READ },   { "???", Operation::NOP, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::XXX, Address_Mode::IMP, 7, Access::NONE },
+		/* 1C */ { "???", Operation::NOP, Address_Mode::IMP, 4, Access::NONE },   { "ORA", Operation::ORA, Address_Mode::ABX, 4, Access::READ },   { "ASL", Operation::ASL, Address_Mode::ABX, 7, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 7, Access::NONE },
+		/* 20 */ { "JSR", Operation::JSR, Address_Mode::ABS, 6, Access::NONE },   { "AND", Operation::AND, Address_Mode::IZX, 6, Access::READ },   { "???", Operation::XXX, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::XXX, Address_Mode::IMP, 8, Access::NONE },
+		/* 24 */ { "BIT", Operation::BIT, Address_Mode::ZP0, 3, Access::READ },   { "AND", Operation::AND, Address_Mode::ZP0, 3, Access::READ },   { "ROL", Operation::ROL, Address_Mode::ZP0, 5, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 5, Access::NONE },
+		/* 28 */ { "PLP", Operation::PLP, Address_Mode::IMP, 4, Access::NONE },   { "AND", Operation::AND, Address_Mode::IMM, 2, Access::READ },   { "ROL", Operation::ROL, Address_Mode::IMP, 2, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 2, Access::NONE },
+		/* 2C */ { "BIT", Operation::BIT, Address_Mode::ABS, 4, Access::READ },   { "AND", Operation::AND, Address_Mode::ABS, 4, Access::READ },   { "ROL", Operation::ROL, Address_Mode::ABS, 6, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 6, Access::NONE },
+		/* 30 */ { "BMI", Operation::BMI, Address_Mode::REL, 2, Access::NONE },   { "AND", Operation::AND, Address_Mode::IZY, 5, Access::READ },   { "???", Operation::XXX, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::XXX, Address_Mode::IMP, 8, Access::NONE },
+		/* 34 */ { "???", Operation::NOP, Address_Mode::IMP, 4, Access::NONE },   { "AND", Operation::AND, Address_Mode::ZPX, 4, Access::READ },   { "ROL", Operation::ROL, Address_Mode::ZPX, 6, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 6, Access::NONE },
+		/* 38 */ { "SEC", Operation::SEC, Address_Mode::IMP, 2, Access::NONE },   { "AND", Operation::AND, Address_Mode::ABY, 4, Access::READ },   { "???", Operation::NOP, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::XXX, Address_Mode::IMP, 7, Access::NONE },
+		/* 3C */ { "???", Operation::NOP, Address_Mode::IMP, 4, Access::NONE },   { "AND", Operation::AND, Address_Mode::ABX, 4, Access::READ },   { "ROL", Operation::ROL, Address_Mode::ABX, 7, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 7, Access::NONE },
+		/* 40 */ { "RTI", Operation::RTI, Address_Mode::IMP, 6, Access::NONE },   { "EOR", Operation::EOR, Address_Mode::IZX, 6, Access::READ },   { "???", Operation::XXX, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::XXX, Address_Mode::IMP, 8, Access::NONE },
+		/* 44 */ { "???", Operation::NOP, Address_Mode::IMP, 3, Access::NONE },   { "EOR", Operation::EOR, Address_Mode::ZP0, 3, Access::READ },   { "LSR", Operation::LSR, Address_Mode::ZP0, 5, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 5, Access::NONE },
+		/* 48 */ { "PHA", Operation::PHA, Address_Mode::IMP, 3, Access::NONE },   { "EOR", Operation::EOR, Address_Mode::IMM, 2, Access::READ },   { "LSR", Operation::LSR, Address_Mode::IMP, 2, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 2, Access::NONE },
+		/* 4C */ { "JMP", Operation::JMP, Address_Mode::ABS, 3, Access::NONE },   { "EOR", Operation::EOR, Address_Mode::ABS, 4, Access::READ },   { "LSR", Operation::LSR, Address_Mode::ABS, 6, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 6, Access::NONE },
+		/* 50 */ { "BVC", Operation::BVC, Address_Mode::REL, 2, Access::NONE },   { "EOR", Operation::EOR, Address_Mode::IZY, 5, Access::READ },   { "???", Operation::XXX, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::XXX, Address_Mode::IMP, 8, Access::NONE },
+		/* 54 */ { "???", Operation::NOP, Address_Mode::IMP, 4, Access::NONE },   { "EOR", Operation::EOR, Address_Mode::ZPX, 4, Access::READ },   { "LSR", Operation::LSR, Address_Mode::ZPX, 6, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 6, Access::NONE },
+		/* 58 */ { "CLI", Operation::CLI, Address_Mode::IMP, 2, Access::NONE },   { "EOR", Operation::EOR, Address_Mode::ABY, 4, Access::READ },   { "???", Operation::NOP, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::XXX, Address_Mode::IMP, 7, Access::NONE },
+		/* 5C */ { "???", Operation::NOP, Address_Mode::IMP, 4, Access::NONE },   { "EOR", Operation::EOR, Address_Mode::ABX, 4, Access::READ },   { "LSR", Operation::LSR, Address_Mode::ABX, 7, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 7, Access::NONE },
+		/* 60 */ { "RTS", Operation::RTS, Address_Mode::IMP, 6, Access::NONE },   { "ADC", Operation::ADC, Address_Mode::IZX, 6, Access::READ },   { "???", Operation::XXX, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::XXX, Address_Mode::IMP, 8, Access::NONE },
+		/* 64 */ { "???", Operation::NOP, Address_Mode::IMP, 3, Access::NONE },   { "ADC", Operation::ADC, Address_Mode::ZP0, 3, Access::READ },   { "ROR", Operation::ROR, Address_Mode::ZP0, 5, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 5, Access::NONE },
+		/* 68 */ { "PLA", Operation::PLA, Address_Mode::IMP, 4, Access::NONE },   { "ADC", Operation::ADC, Address_Mode::IMM, 2, Access::READ },   { "ROR", Operation::ROR, Address_Mode::IMP, 2, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 2, Access::NONE },
+		/* 6C */ { "JMP", Operation::JMP, Address_Mode::IND, 5, Access::NONE },   { "ADC", Operation::ADC, Address_Mode::ABS, 4, Access::READ },   { "ROR", Operation::ROR, Address_Mode::ABS, 6, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 6, Access::NONE },
+		/* 70 */ { "BVS", Operation::BVS, Address_Mode::REL, 2, Access::NONE },   { "ADC", Operation::ADC, Address_Mode::IZY, 5, Access::READ },   { "???", Operation::XXX, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::XXX, Address_Mode::IMP, 8, Access::NONE },
+		/* 74 */ { "???", Operation::NOP, Address_Mode::IMP, 4, Access::NONE },   { "ADC", Operation::ADC, Address_Mode::ZPX, 4, Access::READ },   { "ROR", Operation::ROR, Address_Mode::ZPX, 6, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 6, Access::NONE },
+		/* 78 */ { "SEI", Operation::SEI, Address_Mode::IMP, 2, Access::NONE },   { "ADC", Operation::ADC, Address_Mode::ABY, 4, Access::READ },   { "???", Operation::NOP, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::XXX, Address_Mode::IMP, 7, Access::NONE },
+		/* 7C */ { "???", Operation::NOP, Address_Mode::IMP, 4, Access::NONE },   { "ADC", Operation::ADC, Address_Mode::ABX, 4, Access::READ },   { "ROR", Operation::ROR, Address_Mode::ABX, 7, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 7, Access::NONE },
+		/* 80 */ { "???", Operation::NOP, Address_Mode::IMP, 2, Access::NONE },   { "STA", Operation::STA, Address_Mode::IZX, 6, Access::WRITE },  { "???", Operation::NOP, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::XXX, Address_Mode::IMP, 6, Access::NONE },
+		/* 84 */ { "STY", Operation::STY, Address_Mode::ZP0, 3, Access::WRITE },  { "STA", Operation::STA, Address_Mode::ZP0, 3, Access::WRITE },  { "STX", Operation::STX, Address_Mode::ZP0, 3, Access::WRITE },  { "???", Operation::XXX, Address_Mode::IMP, 3, Access::NONE },
+		/* 88 */ { "DEY", Operation::DEY, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::NOP, Address_Mode::IMP, 2, Access::NONE },   { "TXA", Operation::TXA, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::XXX, Address_Mode::IMP, 2, Access::NONE },
+		/* 8C */ { "STY", Operation::STY, Address_Mode::ABS, 4, Access::WRITE },  { "STA", Operation::STA, Address_Mode::ABS, 4, Access::WRITE },  { "STX", Operation::STX, Address_Mode::ABS, 4, Access::WRITE },  { "???", Operation::XXX, Address_Mode::IMP, 4, Access::NONE },
+		/* 90 */ { "BCC", Operation::BCC, Address_Mode::REL, 2, Access::NONE },   { "STA", Operation::STA, Address_Mode::IZY, 6, Access::WRITE },  { "???", Operation::XXX, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::XXX, Address_Mode::IMP, 6, Access::NONE },
+		/* 94 */ { "STY", Operation::STY, Address_Mode::ZPX, 4, Access::WRITE },  { "STA", Operation::STA, Address_Mode::ZPX, 4, Access::WRITE },  { "STX", Operation::STX, Address_Mode::ZPY, 4, Access::WRITE },  { "???", Operation::XXX, Address_Mode::IMP, 4, Access::NONE },
+		/* 98 */ { "TYA", Operation::TYA, Address_Mode::IMP, 2, Access::NONE },   { "STA", Operation::STA, Address_Mode::ABY, 5, Access::WRITE },  { "TXS", Operation::TXS, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::XXX, Address_Mode::IMP, 5, Access::NONE },
+		/* 9C */ { "???", Operation::NOP, Address_Mode::IMP, 5, Access::NONE },   { "STA", Operation::STA, Address_Mode::ABX, 5, Access::WRITE },  { "???", Operation::XXX, Address_Mode::IMP, 5, Access::NONE },   { "???", Operation::XXX, Address_Mode::IMP, 5, Access::NONE },
+		/* A0 */ { "LDY", Operation::LDY, Address_Mode::IMM, 2, Access::READ },   { "LDA", Operation::LDA, Address_Mode::IZX, 6, Access::READ },   { "LDX", Operation::LDX, Address_Mode::IMM, 2, Access::READ },   { "???", Operation::XXX, Address_Mode::IMP, 6, Access::NONE },
+		/* A4 */ { "LDY", Operation::LDY, Address_Mode::ZP0, 3, Access::READ },   { "LDA", Operation::LDA, Address_Mode::ZP0, 3, Access::READ },   { "LDX", Operation::LDX, Address_Mode::ZP0, 3, Access::READ },   { "???", Operation::XXX, Address_Mode::IMP, 3, Access::NONE },
+		/* A8 */ { "TAY", Operation::TAY, Address_Mode::IMP, 2, Access::NONE },   { "LDA", Operation::LDA, Address_Mode::IMM, 2, Access::READ },   { "TAX", Operation::TAX, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::XXX, Address_Mode::IMP, 2, Access::NONE },
+		/* AC */ { "LDY", Operation::LDY, Address_Mode::ABS, 4, Access::READ },   { "LDA", Operation::LDA, Address_Mode::ABS, 4, Access::READ },   { "LDX", Operation::LDX, Address_Mode::ABS, 4, Access::READ },   { "???", Operation::XXX, Address_Mode::IMP, 4, Access::NONE },
+		/* B0 */ { "BCS", Operation::BCS, Address_Mode::REL, 2, Access::NONE },   { "LDA", Operation::LDA, Address_Mode::IZY, 5, Access::READ },   { "???", Operation::XXX, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::XXX, Address_Mode::IMP, 5, Access::NONE },
+		/* B4 */ { "LDY", Operation::LDY, Address_Mode::ZPX, 4, Access::READ },   { "LDA", Operation::LDA, Address_Mode::ZPX, 4, Access::READ },   { "LDX", Operation::LDX, Address_Mode::ZPY, 4, Access::READ },   { "???", Operation::XXX, Address_Mode::IMP, 4, Access::NONE },
+		/* B8 */ { "CLV", Operation::CLV, Address_Mode::IMP, 2, Access::NONE },   { "LDA", Operation::LDA, Address_Mode::ABY, 4, Access::READ },   { "TSX", Operation::TSX, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::XXX, Address_Mode::IMP, 4, Access::NONE },
+		/* BC */ { "LDY", Operation::LDY, Address_Mode::ABX, 4, Access::READ },   { "LDA", Operation::LDA, Address_Mode::ABX, 4, Access::READ },   { "LDX", Operation::LDX, Address_Mode::ABY, 4, Access::READ },   { "???", Operation::XXX, Address_Mode::IMP, 4, Access::NONE },
+		/* C0 */ { "CPY", Operation::CPY, Address_Mode::IMM, 2, Access::READ },   { "CMP", Operation::CMP, Address_Mode::IZX, 6, Access::READ },   { "???", Operation::NOP, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::XXX, Address_Mode::IMP, 8, Access::NONE },
+		/* C4 */ { "CPY", Operation::CPY, Address_Mode::ZP0, 3, Access::READ },   { "CMP", Operation::CMP, Address_Mode::ZP0, 3, Access::READ },   { "DEC", Operation::DEC, Address_Mode::ZP0, 5, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 5, Access::NONE },
+		/* C8 */ { "INY", Operation::INY, Address_Mode::IMP, 2, Access::NONE },   { "CMP", Operation::CMP, Address_Mode::IMM, 2, Access::READ },   { "DEX", Operation::DEX, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::XXX, Address_Mode::IMP, 2, Access::NONE },
+		/* CC */ { "CPY", Operation::CPY, Address_Mode::ABS, 4, Access::READ },   { "CMP", Operation::CMP, Address_Mode::ABS, 4, Access::READ },   { "DEC", Operation::DEC, Address_Mode::ABS, 6, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 6, Access::NONE },
+		/* D0 */ { "BNE", Operation::BNE, Address_Mode::REL, 2, Access::NONE },   { "CMP", Operation::CMP, Address_Mode::IZY, 5, Access::READ },   { "???", Operation::XXX, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::XXX, Address_Mode::IMP, 8, Access::NONE },
+		/* D4 */ { "???", Operation::NOP, Address_Mode::IMP, 4, Access::NONE },   { "CMP", Operation::CMP, Address_Mode::ZPX, 4, Access::READ },   { "DEC", Operation::DEC, Address_Mode::ZPX, 6, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 6, Access::NONE },
+		/* D8 */ { "CLD", Operation::CLD, Address_Mode::IMP, 2, Access::NONE },   { "CMP", Operation::CMP, Address_Mode::ABY, 4, Access::READ },   { "NOP", Operation::NOP, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::XXX, Address_Mode::IMP, 7, Access::NONE },
+		/* DC */ { "???", Operation::NOP, Address_Mode::IMP, 4, Access::NONE },   { "CMP", Operation::CMP, Address_Mode::ABX, 4, Access::READ },   { "DEC", Operation::DEC, Address_Mode::ABX, 7, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 7, Access::NONE },
+		/* E0 */ { "CPX", Operation::CPX, Address_Mode::IMM, 2, Access::READ },   { "SBC", Operation::SBC, Address_Mode::IZX, 6, Access::READ },   { "???", Operation::NOP, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::XXX, Address_Mode::IMP, 8, Access::NONE },
+		/* E4 */ { "CPX", Operation::CPX, Address_Mode::ZP0, 3, Access::READ },   { "SBC", Operation::SBC, Address_Mode::ZP0, 3, Access::READ },   { "INC", Operation::INC, Address_Mode::ZP0, 5, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 5, Access::NONE },
+		/* E8 */ { "INX", Operation::INX, Address_Mode::IMP, 2, Access::NONE },   { "SBC", Operation::SBC, Address_Mode::IMM, 2, Access::READ },   { "NOP", Operation::NOP, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::SBC, Address_Mode::IMP, 2, Access::READ },
+		/* EC */ { "CPX", Operation::CPX, Address_Mode::ABS, 4, Access::READ },   { "SBC", Operation::SBC, Address_Mode::ABS, 4, Access::READ },   { "INC", Operation::INC, Address_Mode::ABS, 6, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 6, Access::NONE },
+		/* F0 */ { "BEQ", Operation::BEQ, Address_Mode::REL, 2, Access::NONE },   { "SBC", Operation::SBC, Address_Mode::IZY, 5, Access::READ },   { "???", Operation::XXX, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::XXX, Address_Mode::IMP, 8, Access::NONE },
+		/* F4 */ { "???", Operation::NOP, Address_Mode::IMP, 4, Access::NONE },   { "SBC", Operation::SBC, Address_Mode::ZPX, 4, Access::READ },   { "INC", Operation::INC, Address_Mode::ZPX, 6, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 6, Access::NONE },
+		/* F8 */ { "SED", Operation::SED, Address_Mode::IMP, 2, Access::NONE },   { "SBC", Operation::SBC, Address_Mode::ABY, 4, Access::READ },   { "NOP", Operation::NOP, Address_Mode::IMP, 2, Access::NONE },   { "???", Operation::XXX, Address_Mode::IMP, 7, Access::NONE },
+		/* FC */ { "???", Operation::NOP, Address_Mode::IMP, 4, Access::NONE },   { "SBC", Operation::SBC, Address_Mode::ABX, 4, Access::READ },   { "INC", Operation::INC, Address_Mode::ABX, 7, Access::RMW },    { "???", Operation::XXX, Address_Mode::IMP, 7, Access::NONE }
+	};
+
+}
@@ -0,0 +1,92 @@
+#include "Pacer.h"
+#include <algorithm>
+#include <thread>
+
+using namespace Emu;
+
+namespace
+{
+	const double SLICE_SECONDS	  = 0.001;			// host time each budget is for when the cpu is keeping up
+	const double CATCH_UP_SECONDS = 0.05;			// most of the lag one budget makes up, more than a coarse sleep can oversleep by
+	const double MAX_LAG_SECONDS  = 0.25;			// behind by more than this and the time is dropped instead of caught up
+	const double CATCH_UP_SPEED	  = 4.0;			// lag is made up at no more than this times the target speed
+}
+
+Pacer::Pacer(unsigned speed)
+	: m_speed(0), m_rate(0.0), m_cycles(0), m_sliceCycles(0), m_measureStart(Clock::now()), m_measureCycles(0)
+{
+	setSpeed(speed);
+}
+
+void Pacer::setSpeed(unsigned speed)
+{
+	m_speed = speed;
+	m_rate = static_cast<double>(APPLE1_CLOCK_HZ) * speed;
+	restart(Clock::now());
+}
+
+unsigned Pacer::getSpeed() const
+{
+	return m_speed;
+}
+
+QWord Pacer::budget()
+{
+	m_sliceCycles = 0;
+	if (m_speed == 0) return RUN_SLICE_CYCLES;
+
+	Clock::time_point now = Clock::now();
+	double owed = std::chrono::duration<double>(now - m_epoch).count() * m_rate - static_cast<double>(m_cycles);
+	if (owed > MAX_LAG_SECONDS * m_rate)
+	{
+		restart(now);
+		owed = 0.0;
+	}
+	m_sliceStart = now;
+
+	owed = std::min(std::max(owed, 0.0), CATCH_UP_SECONDS * m_rate);
+	return std::max<QWord>(1, static_cast<QWord>(SLICE_SECONDS * m_rate + owed));
+}
+
+void Pacer::ran(QWord cycles)
+{
+	m_cycles += cycles;
+	m_sliceCycles += cycles;
+	m_measureCycles += cycles;
+}
+
+// Behind, the deadline has already gone and the slice only has to take long enough to keep catching up at CATCH_UP_SPEED
+void Pacer::wait()
+{
+	if (m_speed == 0) return;
+
+	Clock::time_point due = m_epoch + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(m_cycles / m_rate));
+	Clock::time_point least = m_sliceStart + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(m_sliceCycles / (m_rate * CATCH_UP_SPEED)));
+	std::this_thread::sleep_until(std::max(due, least));
+}
+
+QWord Pacer::skip(Clock::duration idle)
+{
+	double rate = m_speed == 0 ? static_cast<double>(APPLE1_CLOCK_HZ) : m_rate;
+	QWord cycles = static_cast<QWord>(std::chrono::duration<double>(idle).count() * rate);
+	m_cycles += cycles;
+	m_measureCycles += cycles;
+	return cycles;
+}
+
+double Pacer::measure()
+{
+	Clock::time_point now = Clock::now();
+	double seconds = std::chrono::duration<double>(now - m_measureStart).count();
+	double hz = seconds > 0.0 ? m_measureCycles / seconds : 0.0;
+
+	m_measureStart = now;
+	m_measureCycles = 0;
+	return hz;
+}
+
+void Pacer::restart(Clock::time_point now)
+{
+	m_epoch = m_sliceStart = now;
+	m_cycles = m_sliceCycles = 0;
+}
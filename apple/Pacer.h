@@ -0,0 +1,59 @@
+#pragma once
+#include <chrono>
+#include "Bit.h"
+
+#define APPLE1_CLOCK_HZ  1023000				// the real board's 6502
+#define RUN_SLICE_CYCLES 10000					// cycles the cpu runs between looks at the keyboard and display at unlimited speed
+
+namespace Emu
+{
+
+/*
+	Paces the cpu to a multiple of the Apple 1's clock. The host hands out cycles a slice of host time at a time:
+
+		QWord budget = pacer.budget();
+		pacer.ran(cpu.run_cycles(budget).cycles);
+		pacer.wait();
+
+	Every cycle has a deadline counted from when the pacing started, and wait() sleeps until the deadline of the last one that ran. A
+	slice that ends early or oversleeps is made up by the next budget, so the speed doesn't drift. After a stall the lost time is caught
+	up at no more than a few times the target speed, and a stall that's too long to be worth catching up is dropped.
+	A speed of 0 is unlimited, the budget is RUN_SLICE_CYCLES and wait() returns straight away. Time skipped while the cpu is idle counts
+	at the real clock then.
+*/
+class Pacer
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+						 Pacer				(unsigned speed = 1);
+
+		void			 setSpeed			(unsigned speed);												// Multiple of APPLE1_CLOCK_HZ, 0 for unlimited. Pacing starts again from now
+
+		unsigned		 getSpeed			()													 const;
+
+		QWord			 budget				();																// The cycles to run before the next wait()
+
+		void			 ran				(QWord cycles);													// How many the cpu actually ran, it can stop early
+
+		void			 wait				();																// Sleeps until the cycles that ran are due
+
+		QWord			 skip				(Clock::duration idle);											// The cpu sat out idle without running, returns the cycles it would have
+																											// run and counts them as run so the deadlines carry on from where they were
+
+		double			 measure			();																// Cycles a second since the last measure(), whatever the speed
+
+private:
+		void			 restart			(Clock::time_point now);
+
+	unsigned			m_speed;
+	double				m_rate;							// cycles a second, 0 when unlimited
+	Clock::time_point	m_epoch;						// m_cycles are due m_cycles / m_rate after this
+	QWord				m_cycles;
+	Clock::time_point	m_sliceStart;
+	QWord				m_sliceCycles;
+	Clock::time_point	m_measureStart;
+	QWord				m_measureCycles;
+};
+
+}
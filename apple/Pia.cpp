@@ -0,0 +1,113 @@
+#include "Pia.h"
+
+using namespace Emu;
+
+namespace
+{
+	enum Register : Byte { KBD, KBDCR, DSP, DSPCR };
+}
+
+Pia::Pia()
+	: m_key(0x00), m_keyControl(0x00), m_display(0x00), m_displayControl(0x00), m_strobe(false), m_displayBusy(false)
+{
+}
+
+Byte Pia::read(const Word& addr)
+{
+	if (!(addr & 0x10)) return 0x00;
+
+	switch (addr & 0x03)
+	{
+	case KBD:
+		m_strobe = false;
+		return m_key;
+	case KBDCR:
+		if (!m_strobe and m_onKeyboardPoll) m_onKeyboardPoll();
+		return (m_keyControl & 0x7F) | (m_strobe ? 0x80 : 0x00);
+	case DSP:
+		return (m_display & 0x7F) | (m_displayBusy ? 0x80 : 0x00);
+	default:
+		return m_displayControl & 0x7F;
+	}
+}
+
+void Pia::write(const Word& addr, const Byte& val)
+{
+	if (!(addr & 0x10)) return;
+
+	switch (addr & 0x03)
+	{
+	case KBD:
+		break;											// port A is all inputs
+	case KBDCR:
+		m_keyControl = val & 0x7F;
+		break;
+	case DSP:
+		m_display = val;
+		m_displayBusy = true;
+		if (m_onDisplay) m_onDisplay(val & 0x7F);
+		break;
+	default:
+		m_displayControl = val & 0x7F;
+		break;
+	}
+}
+
+void Pia::reset()
+{
+	m_key = m_keyControl = m_display = m_displayControl = 0x00;
+	m_strobe = m_displayBusy = false;
+}
+
+void Pia::pressKey(const Byte& key)
+{
+	m_key = key | 0x80;
+	m_strobe = true;
+}
+
+bool Pia::getKeyReady() const
+{
+	return m_strobe;
+}
+
+void Pia::setDisplayBusy(bool busy)
+{
+	m_displayBusy = busy;
+}
+
+bool Pia::getDisplayBusy() const
+{
+	return m_displayBusy;
+}
+
+void Pia::onDisplay(std::function<void(Byte)> display)
+{
+	m_onDisplay = display;
+}
+
+void Pia::onKeyboardPoll(std::function<void()> poll)
+{
+	m_onKeyboardPoll = poll;
+}
+
+Pia::State Pia::getState() const
+{
+	State state;
+	state.key = m_key;
+	state.keyControl = m_keyControl;
+	state.display = m_display;
+	state.displayControl = m_displayControl;
+	state.strobe = m_strobe;
+	state.displayBusy = m_displayBusy;
+	return state;
+}
+
+void Pia::setState(const State& state)
+{
+	m_key = state.key;
+	m_keyControl = state.keyControl;
+	m_display = state.display;
+	m_displayControl = state.displayControl;
+	m_strobe = state.strobe;
+	m_displayBusy = state.displayBusy;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <functional>
+#include "Bit.h"
+#include "Memory.h"
+
+namespace Emu
+{
+
+/*
+	The Apple 1's 6821 PIA, the keyboard on port A and the display on port B. It decodes any address in its page with bit 4 set, so the
+	registers are mirrored through the page like on the real board and everything else in it reads as 0.
+
+		$D010	KBD		the last key with bit 7 set. Reading it clears the strobe
+		$D011	KBDCR	bit 7 is the strobe, set while a key is waiting
+		$D012	DSP		writing it hands the character to the display, bit 7 reads as set while the display is busy with it
+		$D013	DSPCR
+
+	The bus calls the device at the moment of the access, so the host only hears about the registers when a program touches them.
+	Bit 7 of the control registers belongs to the hardware, a write only keeps bits 0-6.
+*/
+class Pia : public Device
+{
+public:
+	// The registers and the two flags the host drives, for snapshots
+	struct State
+	{
+		Byte	key				= 0x00;
+		Byte	keyControl		= 0x00;
+		Byte	display			= 0x00;
+		Byte	displayControl	= 0x00;
+		bool	strobe			= false;
+		bool	displayBusy		= false;
+	};
+
+						 Pia				();
+
+		Byte			 read				(const Word& addr)									 override;
+
+		void			 write				(const Word& addr,
+											 const Byte& val)									 override;
+
+		void			 reset				();																// Clears the registers, the strobe and the busy display
+
+		void			 pressKey			(const Byte& key);												// Latches the key and sets the strobe. A key that wasn't read yet is lost
+
+		bool			 getKeyReady		()													 const;		// The strobe
+
+		void			 setDisplayBusy		(bool busy);													// The host says when the display can take the next character
+
+		bool			 getDisplayBusy		()													 const;
+
+		void			 onDisplay			(std::function<void(Byte)> display);							// Gets each character written to DSP without bit 7, the display is already busy
+
+		void			 onKeyboardPoll		(std::function<void()> poll);									// Called when KBDCR is read with no key waiting, it can pressKey
+
+		State			 getState			()													 const;
+
+		void			 setState			(const State& state);											// Doesn't call back, whatever the state says
+
+private:
+	Byte						m_key;
+	Byte						m_keyControl;
+	Byte						m_display;
+	Byte						m_displayControl;
+	bool						m_strobe;
+	bool						m_displayBusy;
+	std::function<void(Byte)>	m_onDisplay;
+	std::function<void()>		m_onKeyboardPoll;
+};
+
+}
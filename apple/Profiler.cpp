@@ -0,0 +1,168 @@
+#include "Profiler.h"
+#include "Apple1.h"
+#include "Disassembler.h"
+#include "Opcodes.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+using namespace Emu;
+
+namespace
+{
+	const DWord		BUS_SIZE		= 0x10000;
+	const size_t	LINE_CHARS		= 160;
+
+	double percent(QWord part, QWord whole)
+	{
+		return whole == 0 ? 0.0 : 100.0 * static_cast<double>(part) / static_cast<double>(whole);
+	}
+}
+
+// Checked in order, so the roms come before the ram they sit in
+Profiler::Profiler()
+	: m_executions(new QWord[BUS_SIZE]()), m_cycles(new QWord[BUS_SIZE]())
+{
+	m_regions =
+	{
+		{ WOZMON_ENTRY,								0xFFFF,										"wozmon" },
+		{ BASIC_ENTRY,								0xEFFF,										"basic or the assembler" },
+		{ KEYBOARD_INPUT_REGISTER & 0xFF00,			KEYBOARD_INPUT_REGISTER | 0xFF,				"pia" },
+		{ WOZACI_ENTRY,								WOZACI_ENTRY + 0xFF,						"wozaci" },
+		{ 0x0000,									0x00FF,										"zero page" },
+		{ 0x0100,									0x01FF,										"stack" },
+		{ 0x0200,									0x027F,										"input buffer" },
+		{ 0x0000,									0xFFFF,										"ram" }
+	};
+}
+
+void Profiler::clear()
+{
+	std::fill(m_executions.get(), m_executions.get() + BUS_SIZE, 0);
+	std::fill(m_cycles.get(), m_cycles.get() + BUS_SIZE, 0);
+}
+
+void Profiler::addRegion(Word first, Word last, const std::string& name)
+{
+	m_regions.insert(m_regions.begin(), Region{ first, last, name });
+}
+
+QWord Profiler::getExecutions(Word pc) const
+{
+	return m_executions[pc];
+}
+
+QWord Profiler::getCycles(Word pc) const
+{
+	return m_cycles[pc];
+}
+
+// Three tables, each ranked by cycles: the regions, the symbols with what runs from each up to the next one, and the single addresses
+const std::string& Profiler::report(const Byte* memory, const Symbols* symbols)
+{
+	m_text.clear();
+	char line[LINE_CHARS];
+
+	QWord cycles = 0, executions = 0;
+	std::vector<Word> hot;
+	std::vector<QWord> regionCycles(m_regions.size()), regionExecutions(m_regions.size());
+	for (DWord addr = 0; addr < BUS_SIZE; ++addr)
+	{
+		if (m_executions[addr] == 0) continue;
+		cycles += m_cycles[addr];
+		executions += m_executions[addr];
+		hot.push_back(static_cast<Word>(addr));
+		for (size_t i = 0; i < m_regions.size(); ++i)
+			if (addr >= m_regions[i].first and addr <= m_regions[i].last)
+			{
+				regionCycles[i] += m_cycles[addr];
+				regionExecutions[i] += m_executions[addr];
+				break;
+			}
+	}
+
+	std::snprintf(line, sizeof(line), "%llu instructions, %llu cycles at %zu addresses\n\n", static_cast<unsigned long long>(executions),
+				  static_cast<unsigned long long>(cycles), hot.size());
+	m_text += line;
+
+	std::vector<size_t> regions;
+	for (size_t i = 0; i < m_regions.size(); ++i) if (regionExecutions[i] != 0) regions.push_back(i);
+	std::stable_sort(regions.begin(), regions.end(), [&](size_t lhs, size_t rhs) { return regionCycles[lhs] > regionCycles[rhs]; });
+	m_text += "region                      range          cycles       %    instructions\n";
+	for (size_t i : regions)
+	{
+		std::snprintf(line, sizeof(line), "%-26s  $%04X-$%04X  %14llu  %6.2f  %14llu\n", m_regions[i].name.c_str(), m_regions[i].first,
+					  m_regions[i].last, static_cast<unsigned long long>(regionCycles[i]), percent(regionCycles[i], cycles),
+					  static_cast<unsigned long long>(regionExecutions[i]));
+		m_text += line;
+	}
+
+	if (symbols != nullptr and !symbols->empty())
+	{
+		struct Routine { Symbols::Iterator symbol; QWord cycles; QWord executions; };
+		std::vector<Routine> routines;
+		for (auto symbol = symbols->begin(); symbol != symbols->end(); ++symbol)
+		{
+			auto next = std::next(symbol);
+			const DWord end = next == symbols->end() ? BUS_SIZE : next->first;
+			Routine routine{ symbol, 0, 0 };
+			for (DWord addr = symbol->first; addr < end; ++addr)
+			{
+				routine.cycles += m_cycles[addr];
+				routine.executions += m_executions[addr];
+			}
+			if (routine.executions != 0) routines.push_back(routine);
+		}
+		const size_t shown = std::min<size_t>(routines.size(), PROFILE_ROUTINES);
+		std::partial_sort(routines.begin(), routines.begin() + shown, routines.end(),
+						  [](const Routine& lhs, const Routine& rhs) { return lhs.cycles > rhs.cycles; });
+
+		m_text += "\nsymbol                      address        cycles       %    instructions\n";
+		for (size_t i = 0; i < shown; ++i)
+		{
+			std::snprintf(line, sizeof(line), "%-26s  $%04X        %14llu  %6.2f  %14llu\n", routines[i].symbol->second.c_str(),
+						  routines[i].symbol->first, static_cast<unsigned long long>(routines[i].cycles), percent(routines[i].cycles, cycles),
+						  static_cast<unsigned long long>(routines[i].executions));
+			m_text += line;
+		}
+	}
+
+	const size_t shown = std::min<size_t>(hot.size(), PROFILE_HOT_SPOTS);
+	std::partial_sort(hot.begin(), hot.begin() + shown, hot.end(), [this](Word lhs, Word rhs)
+	{
+		return m_cycles[lhs] != m_cycles[rhs] ? m_cycles[lhs] > m_cycles[rhs] : lhs < rhs;
+	});
+
+	const Symbols none;
+	const Symbols& names = symbols != nullptr ? *symbols : none;
+	m_text += "\n rank  address  where                   instruction          cycles       %   total %      executions  cycles each\n";
+	QWord total = 0;
+	for (size_t i = 0; i < shown; ++i)
+	{
+		const Word addr = hot[i];
+		total += m_cycles[addr];
+		char text[24] = "";
+		if (memory != nullptr and addr + operandBytes(OPCODES[memory[addr]].mode) < BUS_SIZE) *Disassembler::format(text, addr, memory + addr) = '\0';
+		std::snprintf(line, sizeof(line), "%5zu  $%04X    %-22s  %-16s  %14llu  %6.2f  %8.2f  %14llu  %11.2f\n", i + 1, addr,
+					  names.describe(addr).c_str(), text, static_cast<unsigned long long>(m_cycles[addr]), percent(m_cycles[addr], cycles),
+					  percent(total, cycles), static_cast<unsigned long long>(m_executions[addr]), static_cast<double>(m_cycles[addr]) / m_executions[addr]);
+		m_text += line;
+	}
+	return m_text;
+}
+
+bool Profiler::write(const char* fname, const Byte* memory, const Symbols* symbols)
+{
+	const std::string& text = report(memory, symbols);
+	if (std::strcmp(fname, "-") == 0)
+	{
+		std::cout.write(text.data(), text.size());
+		return std::cout.good();
+	}
+
+	std::FILE* file = std::fopen(fname, "wb");
+	if (file == nullptr) return false;
+	bool ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+	return std::fclose(file) == 0 and ok;
+}
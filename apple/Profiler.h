@@ -0,0 +1,73 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "Bit.h"
+#include "Symbols.h"
+
+#define PROFILE_HOT_SPOTS	40					// addresses the report ranks
+#define PROFILE_ROUTINES	20					// and symbols, when there are any
+
+namespace Emu
+{
+
+/*
+	Where a program spends its time, by the address of every instruction run_cycles and run_until run (see emu6502::setProfiler). Each
+	one adds the cycles the cpu says it took to two flat 64K tables indexed by the program counter, so counting is two adds and nothing
+	is sampled or looked up:
+
+		cpu.setProfiler(&profiler);					from the next slice on
+		...
+		cpu.setProfiler(nullptr);
+		profiler.write("profile.txt", bus, &symbols);	the bus is only for disassembling the hot spots, the symbols (Symbols.h) name them
+
+	The report has the cycles spent in each region of the Apple 1's memory (the wozmon, basic or the assembler at E000, the zero page...),
+	the symbols ranked by the cycles spent from them up to the next symbol, and the hottest addresses with their share and the running
+	total.
+
+	Apple1 --headless --profile FILE [--symbols FILE]...		profiles a headless run, see Headless.h
+*/
+class Profiler
+{
+public:
+	struct Region
+	{
+		Word		first	= 0;
+		Word		last	= 0;
+		std::string name;
+	};
+
+						 Profiler			();											// With the Apple 1's regions
+
+		void			 count				(Word pc,									// The cpu thread, after each instruction
+											 Byte cycles)
+	{
+		++m_executions[pc];
+		m_cycles[pc] += cycles;
+	}
+
+		void			 clear				();											// Forgets the counts, the regions stay
+
+		void			 addRegion			(Word first,								// Goes before the ones already there, the first one an address
+											 Word last,									// is in is the one it counts towards
+											 const std::string& name);
+
+		QWord			 getExecutions		(Word pc)							 const;
+
+		QWord			 getCycles			(Word pc)							 const;
+
+		const std::string& report			(const Byte* memory = nullptr,				// Kept until the next call. With memory the hot spots are
+											 const Symbols* symbols = nullptr);			// disassembled, with symbols they're named
+
+		bool			 write				(const char* fname,							// The report, - for stdout
+											 const Byte* memory = nullptr,
+											 const Symbols* symbols = nullptr);
+
+private:
+	std::unique_ptr<QWord[]>	m_executions;			// by address
+	std::unique_ptr<QWord[]>	m_cycles;
+	std::vector<Region>			m_regions;
+	std::string					m_text;
+};
+
+}
@@ -0,0 +1,137 @@
+#include "Rewind.h"
+#include "emu6502.h"
+#include <chrono>
+#include <cstring>
+
+using namespace Emu;
+
+namespace
+{
+	const size_t PAGE_SIZE = 0x100;
+}
+
+Rewind::Rewind(size_t capacity, size_t budget)
+	: m_ring(capacity < 1 ? 1 : capacity), m_newest(0), m_count(0), m_budget(budget), m_saved(0)
+{
+}
+
+// A page that was written back with what it already held isn't worth keeping, so the dirty ones are checked against the copy first
+void Rewind::capture(emu6502& cpu, const Snapshot::Machine& machine, QWord cycle)
+{
+	auto start = std::chrono::steady_clock::now();
+	const Byte* bus = cpu.getBus();
+
+	if (m_count == 0)
+		m_memory.assign(bus, bus + 0x10000);
+	else
+	{
+		Checkpoint& newest = m_ring[m_newest];
+		const std::bitset<256>& dirty = cpu.getDirtyPages();
+		for (size_t page = 0; page < 256; ++page)
+		{
+			if (!dirty.test(page)) continue;
+			Byte* saved = m_memory.data() + page * PAGE_SIZE;
+			if (std::memcmp(saved, bus + page * PAGE_SIZE, PAGE_SIZE) == 0) continue;
+
+			newest.pages.push_back(static_cast<Byte>(page));
+			newest.contents.insert(newest.contents.end(), saved, saved + PAGE_SIZE);
+			std::memcpy(saved, bus + page * PAGE_SIZE, PAGE_SIZE);
+			m_saved += PAGE_SIZE;
+			++m_stats.pages;
+		}
+		m_stats.cycles += cycle - newest.cycle;
+		if (m_count == m_ring.size()) dropOldest();					// the slot the new one goes in, dropped while it's still the oldest
+		m_newest = (m_newest + 1) % m_ring.size();
+	}
+
+	Checkpoint& next = m_ring[m_newest];
+	next.machine = machine;
+	next.cycle = cycle;
+	next.pages.clear();
+	next.contents.clear();
+	++m_count;
+	while (m_saved > m_budget and m_count > 1) dropOldest();
+
+	cpu.clearDirtyPages();
+	++m_stats.captures;
+	m_stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Memory goes back to the newest checkpoint first, those are the pages dirty since it, and then a checkpoint at a time from there
+bool Rewind::restore(emu6502& cpu, size_t back, Snapshot::Machine& machine)
+{
+	if (back >= m_count) return false;
+	Byte* bus = cpu.getBus();
+
+	std::bitset<256> touched = cpu.getDirtyPages();
+	for (size_t page = 0; page < 256; ++page)
+		if (touched.test(page))
+			std::memcpy(bus + page * PAGE_SIZE, m_memory.data() + page * PAGE_SIZE, PAGE_SIZE);
+
+	for (size_t i = 1; i <= back; ++i)
+	{
+		const Checkpoint& checkpoint = at(i);
+		for (size_t j = 0; j < checkpoint.pages.size(); ++j)
+		{
+			const Byte page = checkpoint.pages[j];
+			const Byte* contents = checkpoint.contents.data() + j * PAGE_SIZE;
+			std::memcpy(bus + page * PAGE_SIZE, contents, PAGE_SIZE);
+			std::memcpy(m_memory.data() + page * PAGE_SIZE, contents, PAGE_SIZE);
+			touched.set(page);
+		}
+	}
+
+	for (size_t i = 0; i < back; ++i)
+	{
+		Checkpoint& newest = m_ring[m_newest];
+		m_saved -= newest.contents.size();
+		newest.pages.clear();
+		newest.contents.clear();
+		m_newest = (m_newest + m_ring.size() - 1) % m_ring.size();
+		--m_count;
+	}
+	Checkpoint& target = m_ring[m_newest];
+	m_saved -= target.contents.size();								// what changed after it is about to happen again, or not
+	target.pages.clear();
+	target.contents.clear();
+
+	machine = target.machine;
+	cpu.setCPU(machine.cpu);
+	for (size_t page = 0; page < 256; ++page)
+		if (touched.test(page)) cpu.invalidateBlocks(static_cast<Word>(page * PAGE_SIZE), static_cast<Word>(page * PAGE_SIZE + PAGE_SIZE - 1));
+	cpu.clearDirtyPages();											// memory is the copy again
+	return true;
+}
+
+size_t Rewind::size() const
+{
+	return m_count;
+}
+
+QWord Rewind::getCycle(size_t back) const
+{
+	return back < m_count ? m_ring[(m_newest + m_ring.size() - back) % m_ring.size()].cycle : 0;
+}
+
+const Rewind::Stats& Rewind::getStats()
+{
+	m_stats.checkpoints = m_count;
+	m_stats.bytes = m_saved + m_memory.size();
+	m_stats.span = m_count == 0 ? 0 : at(0).cycle - at(m_count - 1).cycle;
+	return m_stats;
+}
+
+Rewind::Checkpoint& Rewind::at(size_t back)
+{
+	return m_ring[(m_newest + m_ring.size() - back) % m_ring.size()];
+}
+
+// The oldest checkpoint's pages are what memory held at it, nothing older needs them
+void Rewind::dropOldest()
+{
+	Checkpoint& oldest = at(m_count - 1);
+	m_saved -= oldest.contents.size();
+	oldest.pages.clear();
+	oldest.contents.clear();
+	--m_count;
+}
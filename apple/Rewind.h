@@ -0,0 +1,83 @@
+#pragma once
+#include <vector>
+#include "Bit.h"
+#include "Snapshot.h"
+
+#define REWIND_INTERVAL_MS	100					// emulated time between checkpoints
+#define REWIND_CHECKPOINTS	600					// a minute of them
+#define REWIND_BYTES		(16 << 20)			// most the saved pages can take up, the oldest checkpoints go first to stay under it
+
+namespace Emu
+{
+
+class emu6502;
+
+/*
+	A ring of checkpoints to step back through. Each one is the cpu and device state when it was taken, and memory is kept as the pages
+	that changed in between, found with the cpu's dirty pages:
+
+		rewind.capture(cpu, machine, cycles);			every REWIND_INTERVAL_MS of emulated time, between slices
+		rewind.restore(cpu, 10, machine);				back ten checkpoints, then put the devices back from machine
+
+	It keeps a copy of memory as it was at the newest checkpoint. A capture saves what that copy held for each page that's dirty, which is
+	what the page was before it changed, and then brings the copy up to date. Restoring goes back from the newest checkpoint putting those
+	pages back in turn, so it costs the pages that changed since the checkpoint and nothing for the ones that didn't. The checkpoints after
+	the one restored are dropped, the run carries on from there.
+
+	Rewind owns the cpu's dirty pages, it clears them at every checkpoint. The capture is a copy of the few pages a program writes in a
+	tenth of a second and is done on the cpu thread between slices, getStats() says what it costs.
+*/
+class Rewind
+{
+public:
+	struct Stats
+	{
+		size_t	checkpoints		= 0;
+		size_t	bytes			= 0;			// the saved pages and the copy of memory
+		QWord	span			= 0;			// cycles from the oldest checkpoint to the newest
+		QWord	captures		= 0;
+		QWord	pages			= 0;			// pages saved by all the captures
+		double	seconds			= 0.0;			// host time spent capturing
+		QWord	cycles			= 0;			// emulated cycles the captures covered, seconds / (cycles / APPLE1_CLOCK_HZ) is the cost a second
+	};
+
+						 Rewind				(size_t capacity = REWIND_CHECKPOINTS,
+											 size_t budget = REWIND_BYTES);
+
+		void			 capture			(emu6502& cpu,										// The first capture copies all of memory
+											 const Snapshot::Machine& machine,
+											 QWord cycle);										// a running count of the cycles the cpu has run
+
+		bool			 restore			(emu6502& cpu,										// back 0 is the newest checkpoint. Puts the registers and memory back,
+											 size_t back,										// the rest of the machine comes back in machine for the caller.
+											 Snapshot::Machine& machine);						// False if there aren't that many
+
+		size_t			 size				()										 const;
+
+		QWord			 getCycle			(size_t back)							 const;		// When a checkpoint was taken
+
+		const Stats&	 getStats			();
+
+private:
+	struct Checkpoint
+	{
+		Snapshot::Machine	machine;
+		QWord				cycle = 0;
+		std::vector<Byte>	pages;						// the pages that changed between this checkpoint and the next
+		std::vector<Byte>	contents;					// what they held at this one, 256 bytes each
+	};
+
+		Checkpoint&		 at					(size_t back);
+
+		void			 dropOldest			();
+
+	std::vector<Checkpoint>	m_ring;
+	size_t					m_newest;					// index in m_ring
+	size_t					m_count;
+	size_t					m_budget;
+	size_t					m_saved;					// bytes of page contents in the ring
+	std::vector<Byte>		m_memory;					// memory at the newest checkpoint
+	Stats					m_stats;
+};
+
+}
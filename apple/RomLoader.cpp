@@ -0,0 +1,219 @@
+#include "RomLoader.h"
+#include "MappedFile.h"
+#include <array>
+#include <algorithm>
+#include <cstring>
+
+using namespace Emu;
+
+namespace
+{
+	const size_t BUS_SIZE	= 0x10000;
+	const Byte	 SEPARATOR	= 16;					// character classes after the sixteen hex digits
+	const Byte	 COLON		= 17;
+	const Byte	 OTHER		= 18;
+	const Byte	 BINARY		= 19;					// nothing a text file would have
+	const size_t SNIFF_SIZE	= 512;					// how much of a file AUTO looks at
+
+	// One lookup per character, a digit's value or its class
+	const std::array<Byte, 256> CLASSES = []
+	{
+		std::array<Byte, 256> classes;
+		classes.fill(BINARY);
+		for (int c = 0x20; c < 0x7F; ++c) classes[c] = OTHER;
+		for (int c = 0; c < 10; ++c) classes['0' + c] = static_cast<Byte>(c);
+		for (int c = 0; c < 6; ++c) classes['A' + c] = classes['a' + c] = static_cast<Byte>(10 + c);
+		classes[' '] = classes['\t'] = classes['\r'] = classes['\n'] = classes[','] = SEPARATOR;
+		classes[':'] = COLON;
+		return classes;
+	}();
+
+	// A run that carries straight on from the last one is added to it
+	void addSpan(std::vector<RomLoader::Span>& spans, size_t start, size_t length)
+	{
+		if (length == 0) return;
+		if (!spans.empty() and spans.back().start + spans.back().length == start)
+			spans.back().length += length;
+		else
+			spans.push_back({ static_cast<Word>(start), length });
+	}
+
+	RomLoader::Format detect(const Byte* data, size_t size)
+	{
+		const Byte* first = nullptr;
+		for (size_t i = 0; i < std::min(size, SNIFF_SIZE); ++i)
+		{
+			if (CLASSES[data[i]] == BINARY) return RomLoader::Format::BINARY;
+			if (first == nullptr and CLASSES[data[i]] != SEPARATOR) first = data + i;
+		}
+		return first != nullptr and *first == ':' ? RomLoader::Format::INTEL_HEX : RomLoader::Format::TEXT;
+	}
+
+	RomLoader::Result parseBinary(const Byte* data, size_t size, Word addr, Byte* bus, std::vector<RomLoader::Span>& spans)
+	{
+		const size_t fits = std::min(size, BUS_SIZE - addr);
+		std::memcpy(bus + addr, data, fits);
+		addSpan(spans, addr, fits);
+		return fits == size ? RomLoader::Result::OK : RomLoader::Result::PAST_END_OF_BUS;
+	}
+
+	// Each token is a run of hex digits, the character after it says what it was. Bytes go straight into the bus as they're read. Nearly
+	// every token is two digits and a space, those are taken three characters at a time without looking any further
+	RomLoader::Result parseText(const Byte* data, size_t size, Word addr, Byte* bus, std::vector<RomLoader::Span>& spans)
+	{
+		const Byte* in = data;
+		const Byte* end = data + size;
+		size_t at = addr, runStart = addr;
+		RomLoader::Result result = RomLoader::Result::OK;
+
+		while (in != end)
+		{
+			if (end - in >= 3 and at != BUS_SIZE)
+			{
+				const Byte high = CLASSES[in[0]], low = CLASSES[in[1]];
+				if ((high | low) < 16 and CLASSES[in[2]] == SEPARATOR)
+				{
+					bus[at++] = static_cast<Byte>((high << 4) | low);
+					in += 3;
+					continue;
+				}
+			}
+			if (CLASSES[*in] == SEPARATOR)
+			{
+				++in;
+				continue;
+			}
+			if (end - in > 2 and in[0] == '0' and (in[1] | 0x20) == 'x' and CLASSES[in[2]] < 16) in += 2;
+
+			DWord value = 0;
+			const Byte* digits = in;
+			for (Byte digit; in != end and (digit = CLASSES[*in]) < 16 and in - digits < 5; ++in)
+				value = (value << 4) | digit;
+			const size_t count = in - digits;
+			const Byte next = in == end ? SEPARATOR : CLASSES[*in];
+
+			if (next == COLON and count != 0 and count <= 4)								// an address
+			{
+				++in;
+				addSpan(spans, runStart, at - runStart);
+				at = runStart = value;
+				continue;
+			}
+			if (next != SEPARATOR or count == 0 or count > 2)
+			{
+				result = RomLoader::Result::BAD_TEXT;
+				break;
+			}
+			if (at == BUS_SIZE)
+			{
+				result = RomLoader::Result::PAST_END_OF_BUS;
+				break;
+			}
+			bus[at++] = static_cast<Byte>(value);
+		}
+		addSpan(spans, runStart, at - runStart);
+		return result;
+	}
+
+	// Two hex digits, or -1
+	int hexByte(const Byte* in)
+	{
+		const Byte high = CLASSES[in[0]], low = CLASSES[in[1]];
+		return high < 16 and low < 16 ? (high << 4) | low : -1;
+	}
+
+	RomLoader::Result parseIntelHex(const Byte* data, size_t size, Byte* bus, std::vector<RomLoader::Span>& spans)
+	{
+		const Byte* in = data;
+		const Byte* end = data + size;
+		size_t base = 0;
+		Byte record[5 + 255];											// count, address, type, the data and the checksum
+
+		while (in != end)
+		{
+			if (CLASSES[*in] == SEPARATOR)
+			{
+				++in;
+				continue;
+			}
+			if (*in != ':' or end - in < 11) return RomLoader::Result::BAD_RECORD;
+			++in;
+
+			int count = hexByte(in);
+			if (count < 0 or end - in < 2 * (count + 5)) return RomLoader::Result::BAD_RECORD;
+			Byte sum = 0;
+			for (int i = 0; i < count + 5; ++i, in += 2)
+			{
+				int val = hexByte(in);
+				if (val < 0) return RomLoader::Result::BAD_RECORD;
+				record[i] = static_cast<Byte>(val);
+				sum += record[i];
+			}
+			if (sum != 0) return RomLoader::Result::BAD_RECORD;
+
+			const size_t address = (record[1] << 8) | record[2];
+			const size_t value = (record[4] << 8) | record[5];
+			switch (record[3])
+			{
+			case 0x00:
+			{
+				const size_t start = base + address;
+				const size_t fits = start >= BUS_SIZE ? 0 : std::min<size_t>(count, BUS_SIZE - start);
+				if (fits != 0) std::memcpy(bus + start, record + 4, fits);
+				addSpan(spans, start, fits);
+				if (fits != static_cast<size_t>(count)) return RomLoader::Result::PAST_END_OF_BUS;
+				break;
+			}
+			case 0x01:
+				return RomLoader::Result::OK;
+			case 0x02:
+				if (count != 2) return RomLoader::Result::BAD_RECORD;
+				base = value << 4;
+				break;
+			case 0x04:
+				if (count != 2) return RomLoader::Result::BAD_RECORD;
+				base = value << 16;
+				break;
+			case 0x03: case 0x05:
+				break;
+			default:
+				return RomLoader::Result::BAD_RECORD;
+			}
+		}
+		return RomLoader::Result::OK;
+	}
+}
+
+RomLoader::Result RomLoader::load(const char* fname, Word addr, Byte* bus, std::vector<Span>& spans, Format format)
+{
+	spans.clear();
+	MappedFile file(fname);
+	if (file.data() == nullptr) return Result::NO_FILE;
+	return parse(file.data(), file.size(), addr, bus, spans, format);
+}
+
+RomLoader::Result RomLoader::parse(const Byte* data, size_t size, Word addr, Byte* bus, std::vector<Span>& spans, Format format)
+{
+	spans.clear();
+	if (format == Format::AUTO) format = detect(data, size);
+
+	switch (format)
+	{
+	case Format::INTEL_HEX: return parseIntelHex(data, size, bus, spans);
+	case Format::BINARY:	return parseBinary(data, size, addr, bus, spans);
+	default:				return parseText(data, size, addr, bus, spans);
+	}
+}
+
+const char* RomLoader::describe(Result result)
+{
+	switch (result)
+	{
+	case Result::OK:				return "loaded";
+	case Result::NO_FILE:			return "couldn't open the file";
+	case Result::BAD_TEXT:			return "should be hex bytes, with an address and a colon in front of a line if it isn't at the start, e.g. E000: A2 00 ...";
+	case Result::BAD_RECORD:		return "an Intel HEX record is malformed or fails its checksum";
+	case Result::PAST_END_OF_BUS:	return "runs past the end of memory at $FFFF";
+	default:						return "unknown";
+	}
+}
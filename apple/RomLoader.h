@@ -0,0 +1,63 @@
+#pragma once
+#include <vector>
+#include "Bit.h"
+
+namespace Emu
+{
+
+/*
+	Loads a rom straight out of the mapped file into an image of the bus, no streams and no strings. Three formats:
+
+		text		hex bytes separated by spaces, commas or new lines, with or without "0x". A hex address with a colon after it, the way
+					the wozmon prints memory (FF00: D8 58 A0), carries on at that address. Bytes before the first one go at addr
+		Intel HEX	":" records. Data, end of file, and the extended segment and linear addresses, which only work out to 0 in 64K.
+					The start address records are skipped. Every record's checksum is checked before any of it is written
+		binary		the file as it is, at addr
+
+	Nothing goes past $FFFF, the load stops there and says so. What was written before a load stopped stays written, spans says where it
+	all went so the caller can drop cached code over it.
+*/
+class RomLoader
+{
+public:
+	enum class Format
+	{
+		AUTO,							// binary if there's anything in it text wouldn't have, Intel HEX if it starts with a colon, text otherwise
+		TEXT,
+		INTEL_HEX,
+		BINARY
+	};
+
+	enum class Result
+	{
+		OK,
+		NO_FILE,
+		BAD_TEXT,						// something that isn't a hex byte or an address, or a byte with more than two digits
+		BAD_RECORD,						// an Intel HEX record that's short, isn't hex or fails its checksum
+		PAST_END_OF_BUS
+	};
+
+	// Where a run of bytes went
+	struct Span
+	{
+		Word	start;
+		size_t	length;
+	};
+
+	static	Result			 load				(const char* fname,												// bus is the whole 64K, spans is cleared first
+												 Word addr,
+												 Byte* bus,
+												 std::vector<Span>& spans,
+												 Format format = Format::AUTO);
+
+	static	Result			 parse				(const Byte* data,												// The same from a file that's already in memory
+												 size_t size,
+												 Word addr,
+												 Byte* bus,
+												 std::vector<Span>& spans,
+												 Format format = Format::AUTO);
+
+	static	const char*		 describe			(Result result);
+};
+
+}
@@ -0,0 +1,124 @@
+#include "RomSet.h"
+#include "MappedFile.h"
+#include "EmbeddedRoms.h"
+#include "emu6502.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace Emu;
+
+#ifndef EMU_EMBEDDED_ROMS
+const EmbeddedRom* Emu::findEmbeddedRom(const char*)			// built without them, every rom comes off the disk
+{
+	return nullptr;
+}
+#endif
+
+RomSet::RomSet()
+	: m_image(new Image)														// only ever read where the spans say, so it isn't cleared
+{
+}
+
+bool RomSet::add(const char* fname, Word addr, RomLoader::Format format)
+{
+	MappedFile file(fname);
+	if (file.data() == nullptr) return false;
+	return add(file.data(), file.size(), addr, format);
+}
+
+// Parsed somewhere else first, a rom that stops part way leaves the set as it was
+bool RomSet::add(const Byte* data, size_t size, Word addr, RomLoader::Format format)
+{
+	std::unique_ptr<Image> scratch(new Image);
+	std::vector<RomLoader::Span> spans;
+	if (RomLoader::parse(data, size, addr, scratch->bytes, spans, format) != RomLoader::Result::OK) return false;
+
+	for (const RomLoader::Span& span : spans)
+		std::memcpy(m_image->bytes + span.start, scratch->bytes + span.start, span.length);
+	join(spans);
+	return true;
+}
+
+// Already parsed, the runs only have to be checked they fit before they're copied in
+bool RomSet::addEmbedded(const char* fname, Word addr)
+{
+	const EmbeddedRom* rom = findEmbeddedRom(fname);
+	if (rom == nullptr) return false;
+
+	std::vector<RomLoader::Span> spans;
+	for (size_t i = 0; i < rom->count; ++i)
+	{
+		const EmbeddedRun& run = rom->runs[i];
+		const size_t start = run.addr + (run.relative ? addr : 0);
+		if (start + run.size > sizeof(m_image->bytes)) return false;
+		spans.push_back({ static_cast<Word>(start), run.size });
+	}
+	for (size_t i = 0; i < rom->count; ++i)
+		std::memcpy(m_image->bytes + spans[i].start, rom->runs[i].data, rom->runs[i].size);
+	join(spans);
+	return true;
+}
+
+void RomSet::apply(emu6502& cpu) const
+{
+	Byte* bus = cpu.getBus();
+	for (const RomLoader::Span& span : m_spans)
+	{
+		std::memcpy(bus + span.start, m_image->bytes + span.start, span.length);
+		cpu.invalidateBlocks(span.start, static_cast<Word>(span.start + span.length - 1));
+	}
+}
+
+size_t RomSet::bytes() const
+{
+	size_t total = 0;
+	for (const RomLoader::Span& span : m_spans) total += span.length;
+	return total;
+}
+
+const std::vector<RomLoader::Span>& RomSet::getSpans() const
+{
+	return m_spans;
+}
+
+const Byte* RomSet::getImage() const
+{
+	return m_image->bytes;
+}
+
+// The new spans go in with the old ones, then any that overlap or touch are joined so apply copies each byte once
+void RomSet::join(const std::vector<RomLoader::Span>& spans)
+{
+	m_spans.insert(m_spans.end(), spans.begin(), spans.end());
+	std::sort(m_spans.begin(), m_spans.end(), [](const RomLoader::Span& lhs, const RomLoader::Span& rhs) { return lhs.start < rhs.start; });
+
+	std::vector<RomLoader::Span> joined;
+	for (const RomLoader::Span& span : m_spans)
+	{
+		if (!joined.empty() and joined.back().start + joined.back().length >= span.start)
+			joined.back().length = std::max<size_t>(joined.back().length, span.start + span.length - joined.back().start);
+		else
+			joined.push_back(span);
+	}
+	m_spans.swap(joined);
+}
+
+RomSet& RomSets::define(const std::string& name)
+{
+	m_sets.erase(name);
+	return m_sets[name];
+}
+
+const RomSet* RomSets::find(const std::string& name) const
+{
+	auto set = m_sets.find(name);
+	return set == m_sets.end() ? nullptr : &set->second;
+}
+
+bool RomSets::apply(const std::string& name, emu6502& cpu) const
+{
+	const RomSet* set = find(name);
+	if (set == nullptr) return false;
+	set->apply(cpu);
+	return true;
+}
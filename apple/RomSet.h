@@ -0,0 +1,76 @@
+#pragma once
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Bit.h"
+#include "RomLoader.h"
+
+namespace Emu
+{
+
+class emu6502;
+
+/*
+	Roms parsed once, kept in an image of the bus where they go, and put back with a memcpy for each run of bytes. A set is whatever a key
+	puts in memory together:
+
+		sets.define("reset").add(WOZMON_ROM, WOZMON_ENTRY) ...		at start up, the only parsing (and none for a rom that's built in)
+		sets.apply("reset", cpu);									every F2 after that, a few microseconds
+
+	The image is page aligned and laid out like the bus, so a run is copied from the same offset it goes to. A set isn't changed once
+	it's been built, applying it only reads it. Later adds go over earlier ones where they overlap, like loading the files in that order
+*/
+class RomSet
+{
+public:
+						 RomSet				();
+
+		bool			 add				(const char* fname,												// False if the file isn't there or doesn't all parse, then none of it is added
+											 Word addr,
+											 RomLoader::Format format = RomLoader::Format::AUTO);
+
+		bool			 addEmbedded		(const char* fname,												// The rom built in under that name, see EmbeddedRoms.h. False if
+											 Word addr);													// there isn't one or it doesn't fit at addr
+
+		bool			 add				(const Byte* data,												// The same from a rom that's already in memory
+											 size_t size,
+											 Word addr,
+											 RomLoader::Format format = RomLoader::Format::AUTO);
+
+		void			 apply				(emu6502& cpu)										 const;		// Copies the roms into memory and drops any cached code over them
+
+		size_t			 bytes				()													 const;
+
+		const std::vector<RomLoader::Span>& getSpans()										 const;
+
+		const Byte*		 getImage			()													 const;		// Laid out like the bus, only what the spans cover is set
+
+private:
+		void			 join				(const std::vector<RomLoader::Span>& spans);					// Adds spans that are already in the image
+
+	struct alignas(0x1000) Image
+	{
+		Byte bytes[0x10000];
+	};
+
+	std::unique_ptr<Image>			m_image;
+	std::vector<RomLoader::Span>	m_spans;		// kept in order and without overlaps
+};
+
+// The sets by name
+class RomSets
+{
+public:
+		RomSet&			 define				(const std::string& name);										// A new empty set, replacing any by that name
+
+		const RomSet*	 find				(const std::string& name)							 const;
+
+		bool			 apply				(const std::string& name,										// False if there's no set by that name
+											 emu6502& cpu)										 const;
+
+private:
+	std::map<std::string, RomSet>	m_sets;
+};
+
+}
@@ -0,0 +1,133 @@
+#include "Screen.h"
+#include <cstring>
+
+using namespace Emu;
+
+namespace
+{
+	const char   CURSOR_CHAR  = '@';
+	const Byte   CARRIAGE_RET = 0x0D;
+	const size_t RUN_GAP	  = 6;				// unchanged cells worth sending again rather than starting a new run with a cursor move
+}
+
+Screen::Screen()
+	: m_cursorX(0), m_cursorY(0), m_cursorVisible(false), m_dirty(true)
+{
+	std::memset(m_cells, ' ', sizeof(m_cells));
+	std::memset(m_shown, 0, sizeof(m_shown));
+}
+
+void Screen::put(const Byte& c)
+{
+	if (c == CARRIAGE_RET)
+		newLine();
+	else if (c >= 32 and c <= 126)
+	{
+		m_cells[m_cursorY][m_cursorX] = static_cast<char>(c);
+		if (++m_cursorX == SCREEN_CHAR_WIDTH) newLine();
+	}
+	m_dirty = true;
+}
+
+void Screen::fill(const char& c, const Byte& x, const Byte& y)
+{
+	m_cells[y][x] = c;
+	m_dirty = true;
+}
+
+void Screen::clear()
+{
+	std::memset(m_cells, ' ', sizeof(m_cells));
+	m_dirty = true;
+}
+
+void Screen::home()
+{
+	m_cursorX = m_cursorY = 0;
+	m_dirty = true;
+}
+
+void Screen::setCursor(const Byte& x, const Byte& y)
+{
+	m_cursorX = x < SCREEN_CHAR_WIDTH ? x : SCREEN_CHAR_WIDTH - 1;
+	m_cursorY = y < SCREEN_CHAR_HEIGHT ? y : SCREEN_CHAR_HEIGHT - 1;
+	m_dirty = true;
+}
+
+Byte Screen::getCursorX() const
+{
+	return m_cursorX;
+}
+
+Byte Screen::getCursorY() const
+{
+	return m_cursorY;
+}
+
+void Screen::setCursorVisible(bool visible)
+{
+	m_cursorVisible = visible;
+	m_dirty = true;
+}
+
+bool Screen::getCursorVisible() const
+{
+	return m_cursorVisible;
+}
+
+// A changed cell starts a run at a cursor move, which carries on until RUN_GAP cells in a row haven't changed
+bool Screen::render(std::string& out)
+{
+	if (!m_dirty) return false;
+	m_dirty = false;
+
+	size_t start = out.size();
+	for (Byte y = 0; y < SCREEN_CHAR_HEIGHT; ++y)
+	{
+		Byte x = 0;
+		while (x < SCREEN_CHAR_WIDTH)
+		{
+			if (cell(x, y) == m_shown[y][x])
+			{
+				++x;
+				continue;
+			}
+
+			Byte end = x + 1;
+			for (Byte i = end; i < SCREEN_CHAR_WIDTH and static_cast<size_t>(i - end) < RUN_GAP; ++i)
+				if (cell(i, y) != m_shown[y][i]) end = i + 1;
+
+			out += "\033[" + std::to_string(y + 1) + ';' + std::to_string(x + 1) + 'H';
+			for (; x < end; ++x)
+			{
+				char c = cell(x, y);
+				out += c;
+				m_shown[y][x] = c;
+			}
+		}
+	}
+	return out.size() != start;
+}
+
+void Screen::invalidate()
+{
+	std::memset(m_shown, 0, sizeof(m_shown));
+	m_dirty = true;
+}
+
+char Screen::cell(const Byte& x, const Byte& y) const
+{
+	if (m_cursorVisible and x == m_cursorX and y == m_cursorY) return CURSOR_CHAR;
+	return m_cells[y][x];
+}
+
+// Off the bottom everything moves up a line and the last one starts out blank
+void Screen::newLine()
+{
+	m_cursorX = 0;
+	if (++m_cursorY < SCREEN_CHAR_HEIGHT) return;
+
+	std::memmove(m_cells[0], m_cells[1], sizeof(m_cells) - sizeof(m_cells[0]));
+	std::memset(m_cells[SCREEN_CHAR_HEIGHT - 1], ' ', sizeof(m_cells[0]));
+	m_cursorY = SCREEN_CHAR_HEIGHT - 1;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <string>
+#include "Bit.h"
+
+#define SCREEN_CHAR_WIDTH  40
+#define SCREEN_CHAR_HEIGHT 24
+
+namespace Emu
+{
+
+/*
+	The Apple 1's 40x24 text display. Characters go in at the cursor, which moves to the next line at the end of one and after a return,
+	and when it moves off the bottom the whole screen scrolls up a line like the real terminal does. The blinking @ is an attribute of the
+	cursor cell rather than something written to the console.
+
+	render() works out what changed since the last frame it rendered and appends only that, as ANSI cursor moves and runs of characters,
+	so the caller can get a whole frame onto the console with one write.
+*/
+class Screen
+{
+public:
+						 Screen				();
+
+		void			 put				(const Byte& c);											// A character from the display, bit 7 already cleared
+
+		void			 fill				(const char& c,												// Sets a cell without moving the cursor
+											 const Byte& x,
+											 const Byte& y);
+
+		void			 clear				();															// Blanks the screen, the cursor stays where it is
+
+		void			 home				();															// Cursor to the top left
+
+		void			 setCursor			(const Byte& x,												// Off the screen is pulled back onto the last row or column
+											 const Byte& y);
+
+		Byte			 getCursorX			()											 const;
+
+		Byte			 getCursorY			()											 const;
+
+		void			 setCursorVisible	(bool visible);												// The @ blinks by flipping this
+
+		bool			 getCursorVisible	()											 const;
+
+		bool			 render				(std::string& out);											// Appends the changes since the last frame, false if there are none
+
+		void			 invalidate			();															// The console was written behind our back, the next frame redraws everything
+
+private:
+		char			 cell				(const Byte& x,												// What the cell shows, the @ over the character under the cursor
+											 const Byte& y)								 const;
+
+		void			 newLine			();
+
+	char	m_cells[SCREEN_CHAR_HEIGHT][SCREEN_CHAR_WIDTH];
+	char	m_shown[SCREEN_CHAR_HEIGHT][SCREEN_CHAR_WIDTH];			// what the console has, 0 for unknown
+	Byte	m_cursorX;
+	Byte	m_cursorY;
+	bool	m_cursorVisible;
+	bool	m_dirty;												// anything changed since the last frame
+};
+
+}
@@ -0,0 +1,250 @@
+#include "Snapshot.h"
+#include "MappedFile.h"
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <array>
+#include <fstream>
+#ifdef _WIN32
+	#include <Windows.h>
+#elif defined(__linux__)
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/uio.h>
+#endif
+
+using namespace Emu;
+
+namespace
+{
+	const char	 MAGIC[8]		= { 'A', '1', 'S', 'N', 'A', 'P', '\r', '\n' };
+	const size_t HEADER_SIZE	= 16;
+	const size_t SECTION_HEADER = 8;
+	const size_t CPU_SIZE		= 8;
+	const size_t DEVICE_SIZE	= 13;
+	const size_t MEMORY_SIZE	= 0x10000;
+	const size_t TRAILER_SIZE	= 4;
+	const size_t PREFIX_SIZE	= HEADER_SIZE + SECTION_HEADER + CPU_SIZE + SECTION_HEADER + DEVICE_SIZE + SECTION_HEADER;	// everything before the bus
+
+	const DWord	 TAG_CPU		= 0x20555043;		// "CPU "
+	const DWord	 TAG_DEVICE		= 0x20564544;		// "DEV "
+	const DWord	 TAG_MEMORY		= 0x204D454D;		// "MEM "
+
+	const Byte	 ASSEMBLER_BIT	= 0x01;
+	const Byte	 JIT_BIT		= 0x02;
+
+	void putWord(Byte*& out, Word val)				{ *out++ = val & 0xFF; *out++ = val >> 8; }
+	void putDWord(Byte*& out, DWord val)			{ putWord(out, val & 0xFFFF); putWord(out, val >> 16); }
+	Word getWord(const Byte* in)					{ return static_cast<Word>(in[0] | (in[1] << 8)); }
+	DWord getDWord(const Byte* in)					{ return getWord(in) | (static_cast<DWord>(getWord(in + 2)) << 16); }
+
+	void putSection(Byte*& out, DWord tag, size_t size)
+	{
+		putDWord(out, tag);
+		putDWord(out, static_cast<DWord>(size));
+	}
+
+	// One write for the lot, the bus straight from where it is
+	bool writeFile(const char* fname, const Byte* prefix, const Byte* memory, const Byte* trailer)
+	{
+	#ifdef __linux__
+		int fd = open(fname, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0) return false;
+
+		struct iovec parts[3] =
+		{
+			{ const_cast<Byte*>(prefix),	PREFIX_SIZE },
+			{ const_cast<Byte*>(memory),	MEMORY_SIZE },
+			{ const_cast<Byte*>(trailer),	TRAILER_SIZE }
+		};
+		size_t left = PREFIX_SIZE + MEMORY_SIZE + TRAILER_SIZE;
+		struct iovec* part = parts;
+		int count = 3;
+		while (left != 0)
+		{
+			ssize_t written = writev(fd, part, count);
+			if (written <= 0)
+			{
+				close(fd);
+				return false;
+			}
+			left -= written;
+			for (; count != 0 and static_cast<size_t>(written) >= part->iov_len; --count)		// a short write carries on from where it stopped
+				written -= (part++)->iov_len;
+			if (count != 0)
+			{
+				part->iov_base = static_cast<Byte*>(part->iov_base) + written;
+				part->iov_len -= written;
+			}
+		}
+		return close(fd) == 0;
+	#else
+		std::ofstream file(fname, std::ios::binary | std::ios::trunc);
+		if (file.fail()) return false;
+		file.write(reinterpret_cast<const char*>(prefix), PREFIX_SIZE);
+		file.write(reinterpret_cast<const char*>(memory), MEMORY_SIZE);
+		file.write(reinterpret_cast<const char*>(trailer), TRAILER_SIZE);
+		return file.good();
+	#endif
+	}
+
+	bool replaceFile(const char* from, const char* to)
+	{
+	#ifdef _WIN32
+		return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) != 0;
+	#else
+		return std::rename(from, to) == 0;
+	#endif
+	}
+}
+
+Snapshot::Result Snapshot::save(const char* fname, const Machine& machine, const Byte* memory)
+{
+	Byte prefix[PREFIX_SIZE];
+	Byte* out = prefix;
+
+	std::memcpy(out, MAGIC, sizeof(MAGIC));
+	out += sizeof(MAGIC);
+	putWord(out, SNAPSHOT_VERSION);
+	putWord(out, 3);
+	putDWord(out, static_cast<DWord>(PREFIX_SIZE - HEADER_SIZE + MEMORY_SIZE));
+
+	putSection(out, TAG_CPU, CPU_SIZE);
+	*out++ = machine.cpu.a.getCopy();
+	*out++ = machine.cpu.x.getCopy();
+	*out++ = machine.cpu.y.getCopy();
+	*out++ = machine.cpu.flags.getCopy();
+	putWord(out, machine.cpu.p.getCopy());
+	putWord(out, machine.cpu.s.getCopy());
+
+	putSection(out, TAG_DEVICE, DEVICE_SIZE);
+	*out++ = machine.pia.key;
+	*out++ = machine.pia.keyControl;
+	*out++ = machine.pia.display;
+	*out++ = machine.pia.displayControl;
+	*out++ = machine.pia.strobe ? 1 : 0;
+	*out++ = machine.pia.displayBusy ? 1 : 0;
+	*out++ = machine.cursorX;
+	*out++ = machine.cursorY;
+	putWord(out, machine.speed);
+	*out++ = (machine.assembler ? ASSEMBLER_BIT : 0) | (machine.jit ? JIT_BIT : 0);
+	putWord(out, 0);														// spare
+
+	putSection(out, TAG_MEMORY, MEMORY_SIZE);
+
+	Byte trailer[TRAILER_SIZE];
+	out = trailer;
+	putDWord(out, checksum(memory, MEMORY_SIZE, checksum(prefix, PREFIX_SIZE)));
+
+	const std::string temporary = std::string(fname) + ".tmp";
+	if (!writeFile(temporary.c_str(), prefix, memory, trailer) or !replaceFile(temporary.c_str(), fname))
+	{
+		std::remove(temporary.c_str());
+		return Result::WRITE_FAILED;
+	}
+	return Result::OK;
+}
+
+// Everything is checked and read into a copy of the machine first, memory is only written once the file is known to be good
+Snapshot::Result Snapshot::load(const char* fname, Machine& machine, Byte* memory)
+{
+	MappedFile file(fname);
+	const Byte* data = file.data();
+	const size_t size = file.size();
+	if (data == nullptr) return Result::NO_FILE;
+
+	if (size < HEADER_SIZE or std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0)
+	{
+		if (size != MEMORY_SIZE and size != MEMORY_SIZE - 1) return Result::NOT_A_SNAPSHOT;
+		std::memcpy(memory, data, size);
+		return Result::MEMORY_ONLY;
+	}
+
+	if (getWord(data + 8) > SNAPSHOT_VERSION) return Result::NEWER_VERSION;
+	const Word sections = getWord(data + 10);
+	const size_t length = getDWord(data + 12);
+	if (length > size - HEADER_SIZE or size - HEADER_SIZE - length < TRAILER_SIZE
+		or checksum(data, HEADER_SIZE + length) != getDWord(data + HEADER_SIZE + length))
+		return Result::CORRUPT;
+
+	Machine loaded = machine;
+	const Byte* bus = nullptr;
+	bool cpu = false;
+	const Byte* in = data + HEADER_SIZE;
+	const Byte* end = in + length;
+	for (Word i = 0; i < sections; ++i)
+	{
+		if (end - in < static_cast<std::ptrdiff_t>(SECTION_HEADER)) return Result::CORRUPT;
+		const DWord tag = getDWord(in);
+		const size_t bodySize = getDWord(in + 4);
+		const Byte* body = in + SECTION_HEADER;
+		if (static_cast<size_t>(end - body) < bodySize) return Result::CORRUPT;
+		in = body + bodySize;
+
+		if (tag == TAG_CPU and bodySize >= CPU_SIZE)
+		{
+			loaded.cpu.a = body[0];
+			loaded.cpu.x = body[1];
+			loaded.cpu.y = body[2];
+			loaded.cpu.flags = body[3];
+			loaded.cpu.p = getWord(body + 4);
+			loaded.cpu.s = getWord(body + 6);
+			cpu = true;
+		}
+		else if (tag == TAG_DEVICE and bodySize >= DEVICE_SIZE)
+		{
+			loaded.pia.key = body[0];
+			loaded.pia.keyControl = body[1];
+			loaded.pia.display = body[2];
+			loaded.pia.displayControl = body[3];
+			loaded.pia.strobe = body[4] != 0;
+			loaded.pia.displayBusy = body[5] != 0;
+			loaded.cursorX = body[6];
+			loaded.cursorY = body[7];
+			loaded.speed = getWord(body + 8);
+			loaded.assembler = (body[10] & ASSEMBLER_BIT) != 0;
+			loaded.jit = (body[10] & JIT_BIT) != 0;
+		}
+		else if (tag == TAG_MEMORY and bodySize == MEMORY_SIZE)
+			bus = body;
+	}
+	if (!cpu or bus == nullptr) return Result::CORRUPT;
+
+	machine = loaded;
+	std::memcpy(memory, bus, MEMORY_SIZE);
+	return Result::OK;
+}
+
+// Slicing by 8, eight table lookups for every eight bytes instead of one for every byte. The whole bus takes a few tens of microseconds
+DWord Snapshot::checksum(const Byte* data, size_t size, DWord crc)
+{
+	static const auto TABLES = []
+	{
+		std::vector<std::array<DWord, 256>> tables(8);
+		for (DWord i = 0; i < 256; ++i)
+		{
+			DWord c = i;
+			for (int bit = 0; bit < 8; ++bit)
+				c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+			tables[0][i] = c;
+		}
+		for (DWord i = 0; i < 256; ++i)
+			for (size_t t = 1; t < 8; ++t)
+				tables[t][i] = (tables[t - 1][i] >> 8) ^ tables[0][tables[t - 1][i] & 0xFF];
+		return tables;
+	}();
+	const auto& t = TABLES;
+
+	crc = ~crc;
+	for (; size >= 8; size -= 8, data += 8)
+	{
+		DWord low = crc ^ getDWord(data);
+		DWord high = getDWord(data + 4);
+		crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24]
+			^ t[3][high & 0xFF] ^ t[2][(high >> 8) & 0xFF] ^ t[1][(high >> 16) & 0xFF] ^ t[0][high >> 24];
+	}
+	for (; size != 0; --size)
+		crc = t[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "Bit.h"
+#include "Pia.h"
+#include "emu6502.h"
+
+#define SNAPSHOT_VERSION 1						// bumped when a section changes, a loader takes its own version and older
+
+namespace Emu
+{
+
+/*
+	The whole machine in one file, so loading it carries on from the instruction it was saved at. All of it is little endian:
+
+		header		"A1SNAP\r\n", the version (2), how many sections (2), the length of the sections (4)
+		sections	a tag (4) and the length of the body (4), then the body. A loader skips tags it doesn't know
+			"CPU "	A X Y P, PC (2), S (2)
+			"DEV "	the pia's KBD KBDCR DSP DSPCR, the strobe and the busy display, the screen's cursor x and y, the speed (2),
+					and 1 for the assembler at E000 and 2 for the JIT
+			"MEM "	the 64K bus
+		trailer		CRC-32 of everything before it
+
+	save() writes to a temporary file and renames it over the old one, so a failed save leaves the last snapshot alone. Before the header
+	there was only the bus, a file of 64K (or 64K less a byte) without one still loads as memory.
+*/
+class Snapshot
+{
+public:
+	enum class Result
+	{
+		OK,
+		MEMORY_ONLY,					// an old save of just the bus, the machine wasn't in it
+		NO_FILE,
+		WRITE_FAILED,
+		NOT_A_SNAPSHOT,
+		NEWER_VERSION,
+		CORRUPT							// the checksum is wrong or a section is short
+	};
+
+	// What goes in the snapshot besides memory
+	struct Machine
+	{
+		CPU			cpu;
+		Pia::State	pia;
+		Byte		cursorX		= 0;
+		Byte		cursorY		= 0;
+		Word		speed		= 1;
+		bool		assembler	= false;			// the assembler is at E000 instead of basic
+		bool		jit			= false;
+	};
+
+	static	Result			 save				(const char* fname,												// memory is the whole 64K bus
+												 const Machine& machine,
+												 const Byte* memory);
+
+	static	Result			 load				(const char* fname,												// Nothing is changed unless the whole file checks out
+												 Machine& machine,
+												 Byte* memory);
+
+	static	DWord			 checksum			(const Byte* data,												// CRC-32, pass the last one back in to carry on
+												 size_t size,
+												 DWord crc = 0);
+};
+
+}
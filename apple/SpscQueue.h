@@ -0,0 +1,101 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include "Bit.h"
+
+namespace Emu
+{
+
+/*
+	A fixed size ring buffer between exactly one producer thread and one consumer thread. Neither side ever waits on the other: push
+	fails when the ring is full and pop fails when it's empty, each in a few atomic loads and a store. The head and tail only ever count
+	up and wrap with the size, so the depth is always tail - head.
+
+	The producer counts what it couldn't push and the deepest the queue has been, so the other side falling behind shows up.
+*/
+template<typename T, size_t Size>
+class SpscQueue
+{
+	static_assert(Size != 0 and (Size & (Size - 1)) == 0, "the size has to be a power of two");
+
+public:
+						 SpscQueue			()
+		: m_head(0), m_tail(0), m_dropped(0), m_maxDepth(0)
+	{
+	}
+
+						 SpscQueue			(const SpscQueue&) = delete;
+
+		bool			 push				(const T& item)												// Producer only. False if it's full, the item is dropped and counted
+	{
+		size_t tail = m_tail.load(std::memory_order_relaxed);
+		size_t depth = tail - m_head.load(std::memory_order_acquire);
+		if (depth == Size)
+		{
+			m_dropped.store(m_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			return false;
+		}
+
+		m_items[tail & (Size - 1)] = item;
+		m_tail.store(tail + 1, std::memory_order_release);
+		if (depth + 1 > m_maxDepth.load(std::memory_order_relaxed)) m_maxDepth.store(depth + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+		bool			 pop				(T& item)													// Consumer only. False if it's empty
+	{
+		size_t head = m_head.load(std::memory_order_relaxed);
+		if (head == m_tail.load(std::memory_order_acquire)) return false;
+
+		item = m_items[head & (Size - 1)];
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+		size_t			 pop				(T* items,													// Consumer only. Up to count of them in one go, returns
+											 size_t count)												// how many. Only one acquire and one release for the lot
+	{
+		size_t head = m_head.load(std::memory_order_relaxed);
+		size_t available = m_tail.load(std::memory_order_acquire) - head;
+		if (available > count) available = count;
+
+		for (size_t i = 0; i < available; ++i) items[i] = m_items[(head + i) & (Size - 1)];
+		m_head.store(head + available, std::memory_order_release);
+		return available;
+	}
+
+		size_t			 getDepth			()											 const			// Either side, it's only a snapshot from the other one
+	{
+		size_t head = m_head.load(std::memory_order_acquire);
+		return m_tail.load(std::memory_order_acquire) - head;
+	}
+
+		bool			 full				()											 const
+	{
+		return getDepth() >= Size;
+	}
+
+		QWord			 getDropped			()											 const
+	{
+		return m_dropped.load(std::memory_order_relaxed);
+	}
+
+		size_t			 getMaxDepth		()											 const
+	{
+		return m_maxDepth.load(std::memory_order_relaxed);
+	}
+
+static	constexpr size_t capacity			()
+	{
+		return Size;
+	}
+
+private:
+	alignas(64) std::atomic<size_t>	m_head;				// the consumer's, on its own cache line so the two sides don't fight over it
+	alignas(64) std::atomic<size_t>	m_tail;				// the producer's
+	std::atomic<QWord>				m_dropped;
+	std::atomic<size_t>				m_maxDepth;
+	alignas(64) T					m_items[Size];
+};
+
+}
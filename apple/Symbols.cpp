@@ -0,0 +1,98 @@
+#include "Symbols.h"
+#include "MappedFile.h"
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+
+using namespace Emu;
+
+namespace
+{
+	const DWord		BUS_SIZE		= 0x10000;
+
+	// Up to and past the spaces and tabs at text
+	const Byte* skipBlanks(const Byte* text, const Byte* end)
+	{
+		while (text != end and (*text == ' ' or *text == '\t' or *text == '\r')) ++text;
+		return text;
+	}
+}
+
+bool Symbols::load(const char* fname)
+{
+	MappedFile file(fname);
+	if (file.data() == nullptr) return false;
+
+	const Byte* text = file.data();
+	const Byte* end = text + file.size();
+	while (text != end)
+	{
+		const Byte* lineEnd = static_cast<const Byte*>(std::memchr(text, '\n', end - text));
+		if (lineEnd == nullptr) lineEnd = end;
+		const Byte* comment = static_cast<const Byte*>(std::memchr(text, ';', lineEnd - text));
+		const Byte* stop = comment == nullptr ? lineEnd : comment;
+
+		text = skipBlanks(text, stop);
+		if (text != stop)
+		{
+			if (*text == '$') ++text;
+			DWord addr = 0;
+			const Byte* digits = text;
+			for (; text != stop and std::isxdigit(*text) and addr < BUS_SIZE; ++text)
+				addr = addr * 16 + (std::isdigit(*text) ? *text - '0' : (std::toupper(*text) - 'A' + 10));
+
+			const Byte* name = skipBlanks(text, stop);
+			const Byte* nameEnd = name;
+			while (nameEnd != stop and !std::isspace(*nameEnd)) ++nameEnd;
+			if (text == digits or text - digits > 4 or name == text or name == nameEnd or skipBlanks(nameEnd, stop) != stop) return false;
+			add(static_cast<Word>(addr), std::string(name, nameEnd));
+		}
+		text = lineEnd == end ? end : lineEnd + 1;
+	}
+	return true;
+}
+
+void Symbols::add(Word addr, const std::string& name)
+{
+	m_names[addr] = name;
+}
+
+const std::string* Symbols::find(Word addr) const
+{
+	auto name = m_names.find(addr);
+	return name == m_names.end() ? nullptr : &name->second;
+}
+
+// Symbols only reach as far as the next one, and a name that would need an offset of more than a page is too far off to mean anything
+std::string Symbols::describe(Word addr) const
+{
+	char text[8];
+	auto symbol = m_names.upper_bound(addr);
+	if (symbol != m_names.begin())
+	{
+		--symbol;
+		if (symbol->first == addr) return symbol->second;
+		if (addr - symbol->first < 0x100)
+		{
+			std::snprintf(text, sizeof(text), "+%u", static_cast<unsigned>(addr - symbol->first));
+			return symbol->second + text;
+		}
+	}
+	std::snprintf(text, sizeof(text), "$%04X", addr);
+	return text;
+}
+
+bool Symbols::empty() const
+{
+	return m_names.empty();
+}
+
+Symbols::Iterator Symbols::begin() const
+{
+	return m_names.begin();
+}
+
+Symbols::Iterator Symbols::end() const
+{
+	return m_names.end();
+}
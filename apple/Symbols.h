@@ -0,0 +1,41 @@
+#pragma once
+#include <map>
+#include <string>
+#include "Bit.h"
+
+namespace Emu
+{
+
+/*
+	Names for addresses, for the profiler's and the call graph's reports. A symbol file has a hex address and a name a line, ; starts a
+	comment:
+
+		FFEF	ECHO		; prints A
+
+	roms/ has them for the wozmon, basic and the assembler. Loading another file adds to what's there, a name given twice keeps the last
+*/
+class Symbols
+{
+public:
+	typedef std::map<Word, std::string>::const_iterator Iterator;
+
+		bool			 load				(const char* fname);						// False if it can't be read or a line isn't an address and a name
+
+		void			 add				(Word addr,
+											 const std::string& name);
+
+		const std::string* find				(Word addr)							 const;		// The name right at addr, nullptr if there isn't one
+
+		std::string		 describe			(Word addr)							 const;		// The symbol, the symbol before it plus how far on, or $ADDR
+
+		bool			 empty				()									 const;
+
+		Iterator		 begin				()									 const;		// In address order
+
+		Iterator		 end				()									 const;
+
+private:
+	std::map<Word, std::string>	m_names;
+};
+
+}
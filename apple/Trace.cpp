@@ -0,0 +1,325 @@
+#include "Trace.h"
+#include "Opcodes.h"
+#include "Disassembler.h"
+#include "MappedFile.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+using namespace Emu;
+
+namespace
+{
+	const char		MAGIC[8]		= { 'A', '1', 'T', 'R', 'A', 'C', 'E', '\n' };
+	const size_t	HEADER_SIZE		= 12;
+	const size_t	FLUSH_BYTES		= 1 << 16;				// coded records are written out in lumps of about this
+	const size_t	DRAIN_BATCH		= 256;
+	const size_t	MAX_CODED		= 32;					// the most a record can code to
+	const auto		IDLE_WAIT		= std::chrono::microseconds(500);
+
+	// What a record has that the one before it doesn't say
+	const Byte		PC_CHANGED		= 0x01;
+	const Byte		A_CHANGED		= 0x02;
+	const Byte		X_CHANGED		= 0x04;
+	const Byte		Y_CHANGED		= 0x08;
+	const Byte		P_CHANGED		= 0x10;
+	const Byte		S_CHANGED		= 0x20;
+	const Byte		ADDRESS_CHANGED	= 0x40;
+	const Byte		CYCLE_CHANGED	= 0x80;
+
+	// operandBytes for every opcode, looked up twice for each record
+	const struct OperandTable
+	{
+		Byte counts[256];
+
+		constexpr OperandTable() : counts()
+		{
+			for (int i = 0; i < 256; ++i) counts[i] = operandBytes(OPCODES[i].mode);
+		}
+
+		constexpr Byte operator[](Byte opcode) const { return counts[opcode]; }
+	} OPERANDS;
+
+	// Where the record after previous would be if nothing jumped
+	Word nextPC(const TraceRecord& previous)
+	{
+		return static_cast<Word>(previous.pc + 1 + OPERANDS[previous.opcode]);
+	}
+
+	// The effective address is the operand itself unless it was indexed or indirect, and an implied instruction leaves it alone
+	Word expectedAddress(const TraceRecord& record, const TraceRecord& previous)
+	{
+		switch (OPERANDS[record.opcode])
+		{
+		case 0:		return previous.address;
+		case 1:		return record.operand[0];
+		default:	return static_cast<Word>(record.operand[0] | (record.operand[1] << 8));
+		}
+	}
+
+	bool computedAddress(Address_Mode mode)
+	{
+		switch (mode)
+		{
+		case Address_Mode::ZPX: case Address_Mode::ZPY: case Address_Mode::ABX: case Address_Mode::ABY:
+		case Address_Mode::IND: case Address_Mode::IZX: case Address_Mode::IZY:
+			return true;
+		default:
+			return false;
+		}
+	}
+}
+
+Trace::Trace()
+	: m_ring(new SpscQueue<TraceRecord, TRACE_RING_RECORDS>()), m_file(nullptr), m_draining(false), m_background(false), m_buffer(FLUSH_BYTES + DRAIN_BATCH * MAX_CODED), m_used(0), m_records(0), m_bytes(0), m_stalls(0)
+{
+}
+
+Trace::~Trace()
+{
+	stop();
+}
+
+bool Trace::start(const char* fname, bool background)
+{
+	stop();
+	m_file = std::fopen(fname, "wb");
+	if (m_file == nullptr) return false;
+
+	Byte header[HEADER_SIZE] = {};
+	std::memcpy(header, MAGIC, sizeof(MAGIC));
+	header[8] = TRACE_VERSION & 0xFF;
+	header[9] = TRACE_VERSION >> 8;
+	std::fwrite(header, 1, HEADER_SIZE, m_file);
+
+	m_previous = TraceRecord();
+	m_records = 0;
+	m_bytes = HEADER_SIZE;
+	m_stalls = 0;
+	m_background = background;
+	if (background)
+	{
+		m_draining = true;
+		m_thread = std::thread(&Trace::background, this);
+	}
+	return true;
+}
+
+void Trace::stop()
+{
+	if (m_file == nullptr) return;
+	if (m_thread.joinable())
+	{
+		m_draining = false;
+		m_thread.join();
+	}
+	drain();
+	flush();
+	std::fclose(m_file);
+	m_file = nullptr;
+	m_background = false;
+}
+
+bool Trace::active() const
+{
+	return m_file != nullptr;
+}
+
+// Taken off the ring a batch at a time and coded straight into the buffer, which always has room for a whole batch
+size_t Trace::drain()
+{
+	size_t count = 0;
+	TraceRecord batch[DRAIN_BATCH];
+	for (size_t popped; (popped = m_ring->pop(batch, DRAIN_BATCH)) != 0; count += popped)
+	{
+		for (size_t i = 0; i < popped; ++i)
+		{
+			m_used += encode(batch[i], m_previous, m_buffer.data() + m_used);
+			m_previous = batch[i];
+		}
+		if (m_used >= FLUSH_BYTES) flush();
+	}
+	m_records += count;
+	return count;
+}
+
+Trace::Stats Trace::getStats() const
+{
+	Stats stats;
+	stats.records = m_records;
+	stats.bytes = m_bytes;
+	stats.stalls = m_stalls;
+	return stats;
+}
+
+void Trace::background()
+{
+	while (m_draining)
+		if (drain() == 0) std::this_thread::sleep_for(IDLE_WAIT);
+}
+
+void Trace::flush()
+{
+	if (m_used == 0) return;
+	std::fwrite(m_buffer.data(), 1, m_used, m_file);
+	m_bytes += m_used;
+	m_used = 0;
+}
+
+size_t Trace::encode(const TraceRecord& record, const TraceRecord& previous, Byte* out)
+{
+	Byte* start = out++;
+	Byte flags = 0;
+
+	*out++ = record.opcode;
+	const Byte operands = OPERANDS[record.opcode];
+	for (Byte i = 0; i < operands; ++i) *out++ = record.operand[i];
+	*out++ = record.cycles;
+
+	if (record.pc != nextPC(previous))
+	{
+		flags |= PC_CHANGED;
+		*out++ = record.pc & 0xFF;
+		*out++ = record.pc >> 8;
+	}
+	if (record.a != previous.a) { flags |= A_CHANGED; *out++ = record.a; }
+	if (record.x != previous.x) { flags |= X_CHANGED; *out++ = record.x; }
+	if (record.y != previous.y) { flags |= Y_CHANGED; *out++ = record.y; }
+	if (record.p != previous.p) { flags |= P_CHANGED; *out++ = record.p; }
+	if (record.s != previous.s) { flags |= S_CHANGED; *out++ = record.s; }
+	if (record.address != expectedAddress(record, previous))
+	{
+		flags |= ADDRESS_CHANGED;
+		*out++ = record.address & 0xFF;
+		*out++ = record.address >> 8;
+	}
+	if (record.cycle != previous.cycle + previous.cycles)			// seven bits at a time, the top bit says there's more
+	{
+		flags |= CYCLE_CHANGED;
+		QWord cycle = record.cycle;
+		for (; cycle >= 0x80; cycle >>= 7) *out++ = static_cast<Byte>(cycle | 0x80);
+		*out++ = static_cast<Byte>(cycle);
+	}
+	*start = flags;
+	return out - start;
+}
+
+size_t Trace::decode(const Byte* in, size_t size, const TraceRecord& previous, TraceRecord& record)
+{
+	const Byte* start = in;
+	const Byte* end = in + size;
+	if (size < 3) return 0;
+
+	record = TraceRecord();
+	const Byte flags = *in++;
+	record.opcode = *in++;
+	const Byte operands = OPERANDS[record.opcode];
+	if (end - in < operands + 1) return 0;
+	for (Byte i = 0; i < operands; ++i) record.operand[i] = *in++;
+	record.cycles = *in++;
+
+	auto byte = [&](Byte changed, Byte last, Byte& val)
+	{
+		if ((flags & changed) == 0) val = last;
+		else if (in == end) return false;
+		else val = *in++;
+		return true;
+	};
+	auto word = [&](Byte changed, Word expected, Word& val)
+	{
+		if ((flags & changed) == 0) val = expected;
+		else if (end - in < 2) return false;
+		else
+		{
+			val = static_cast<Word>(in[0] | (in[1] << 8));
+			in += 2;
+		}
+		return true;
+	};
+
+	if (!word(PC_CHANGED, nextPC(previous), record.pc)
+		or !byte(A_CHANGED, previous.a, record.a) or !byte(X_CHANGED, previous.x, record.x) or !byte(Y_CHANGED, previous.y, record.y)
+		or !byte(P_CHANGED, previous.p, record.p) or !byte(S_CHANGED, previous.s, record.s)
+		or !word(ADDRESS_CHANGED, expectedAddress(record, previous), record.address))
+		return 0;
+
+	record.cycle = previous.cycle + previous.cycles;
+	if (flags & CYCLE_CHANGED)
+	{
+		record.cycle = 0;
+		for (unsigned shift = 0; ; shift += 7)
+		{
+			if (in == end or shift > 63) return 0;
+			const Byte part = *in++;
+			record.cycle |= static_cast<QWord>(part & 0x7F) << shift;
+			if ((part & 0x80) == 0) break;
+		}
+	}
+	return in - start;
+}
+
+// The registers are what the instruction started with. A computed address, indexed or indirect, is shown after them
+bool Trace::print(const char* fname, std::FILE* out)
+{
+	MappedFile file(fname);
+	const Byte* data = file.data();
+	if (data == nullptr or file.size() < HEADER_SIZE or std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0
+		or (data[8] | (data[9] << 8)) > TRACE_VERSION)
+		return false;
+
+	TraceRecord previous, record;
+	size_t pos = HEADER_SIZE;
+	while (pos < file.size())
+	{
+		const size_t used = decode(data + pos, file.size() - pos, previous, record);
+		if (used == 0) return false;
+		pos += used;
+
+		const Byte bytes[3] = { record.opcode, record.operand[0], record.operand[1] };
+		const Address_Mode mode = OPCODES[record.opcode].mode;
+		char hex[10], text[24];
+		*Disassembler::format(text, record.pc, bytes) = '\0';
+		if (operandBytes(mode) == 2) std::snprintf(hex, sizeof(hex), "%02X %02X %02X", bytes[0], bytes[1], bytes[2]);
+		else if (operandBytes(mode) == 1) std::snprintf(hex, sizeof(hex), "%02X %02X", bytes[0], bytes[1]);
+		else std::snprintf(hex, sizeof(hex), "%02X", bytes[0]);
+
+		std::fprintf(out, "%12llu  %04X  %-8s  %-12s  A=%02X X=%02X Y=%02X P=%02X S=%02X  %u", static_cast<unsigned long long>(record.cycle),
+					 record.pc, hex, text, record.a, record.x, record.y, record.p, record.s, record.cycles);
+		if (computedAddress(mode)) std::fprintf(out, "  @%04X", record.address);
+		std::fputc('\n', out);
+		previous = record;
+	}
+	return true;
+}
+
+int Trace::run(int argc, char* argv[])
+{
+	if (argc < 1)
+	{
+		std::cerr << "Apple1 --trace FILE [--out FILE], see Trace.h\n";
+		return 1;
+	}
+	std::string outFile;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "--out" and i + 1 < argc) outFile = argv[++i];
+		else
+		{
+			std::cerr << "Unknown option " << arg << ", see Trace.h\n";
+			return 1;
+		}
+	}
+
+	std::FILE* out = outFile.empty() ? stdout : std::fopen(outFile.c_str(), "wb");
+	if (out == nullptr)
+	{
+		std::cerr << "Couldn't open " << outFile << '\n';
+		return 1;
+	}
+	const bool ok = print(argv[0], out);
+	if (out != stdout) std::fclose(out);
+	if (!ok) std::cerr << argv[0] << " isn't a trace or is cut short\n";
+	return ok ? 0 : 1;
+}
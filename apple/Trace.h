@@ -0,0 +1,124 @@
+#pragma once
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "Bit.h"
+#include "SpscQueue.h"
+
+#define TRACE_RING_RECORDS	(1 << 16)			// records on their way from the cpu to the file, 1.5 MiB of them
+#define TRACE_FILE			"trace.a1t"			// where F11 traces to
+#define TRACE_VERSION		1
+
+namespace Emu
+{
+
+// One instruction and the cpu as it was before it ran. 24 bytes, the file holds them compressed
+struct TraceRecord
+{
+	QWord	cycle		= 0;					// cycles run since the trace started, up to this instruction
+	Word	pc			= 0;
+	Word	address		= 0;					// the effective address it worked out, the operand for IMM and REL, and still the one before's for IMP
+	Byte	opcode		= 0;
+	Byte	operand[2]	= { 0, 0 };				// as many as the addressing mode has, the rest are 0
+	Byte	a			= 0;
+	Byte	x			= 0;
+	Byte	y			= 0;
+	Byte	p			= 0;
+	Byte	s			= 0;
+	Byte	cycles		= 0;					// what it took, page crossings and branches included
+	Byte	spare[3]	= { 0, 0, 0 };
+};
+
+/*
+	An instruction trace that costs next to nothing when it's off. The cpu hands it a record for every instruction run_cycles and
+	run_until run (see emu6502::setTrace) and they go through a lock-free ring to whoever writes them out:
+
+		trace.start("run.a1t");					a thread drains the ring into the file in the background
+		cpu.setTrace(&trace);					from the next slice on
+		...
+		cpu.setTrace(nullptr);
+		trace.stop();							drains what's left and closes the file
+
+	Started without the thread the cpu drains the ring itself whenever it fills. With the thread a full ring makes the cpu wait for it
+	rather than lose records, getStats() counts how often that happened.
+
+	The file is "A1TRACE\n", the version (TRACE_VERSION) and two spare bytes, then the records. Each one is coded against the one before it: a byte of
+	flags for what didn't follow on, the opcode, its operand bytes and its cycles, then only what the flags say changed. The program counter
+	is only there after a jump, and the registers only when the instruction changed them, so most records come to 4 or 5 bytes.
+
+	Apple1 --trace FILE [--out FILE]		prints a trace, one instruction a line with its disassembly and the registers before it ran
+*/
+class Trace
+{
+public:
+	struct Stats
+	{
+		QWord	records		= 0;				// written to the file
+		QWord	bytes		= 0;				// what's been written of the file so far
+		QWord	stalls		= 0;				// records the cpu found the ring full for, since the trace started
+	};
+
+						 Trace				();
+
+						 Trace				(const Trace&) = delete;
+
+						 ~Trace				();											// Stops it
+
+		bool			 start				(const char* fname,							// False if the file can't be made
+											 bool background = true);
+
+		void			 stop				();
+
+		bool			 active				()									 const;
+
+		void			 record				(const TraceRecord& record)						// The cpu thread only
+	{
+		if (m_ring->push(record)) return;
+		m_stalls.store(m_stalls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		do
+		{
+			if (m_background) std::this_thread::yield();
+			else drain();
+		}
+		while (!m_ring->push(record));
+	}
+
+		size_t			 drain				();											// Writes out what's in the ring. Only ever one thread at a time
+
+		Stats			 getStats			()									 const;
+
+static	size_t			 encode				(const TraceRecord& record,					// Codes record into out, at most 32 bytes, and returns how many
+											 const TraceRecord& previous,
+											 Byte* out);
+
+static	size_t			 decode				(const Byte* in,							// The other way, 0 if the record is cut short
+											 size_t size,
+											 const TraceRecord& previous,
+											 TraceRecord& record);
+
+static	bool			 print				(const char* fname,							// One line for each record, false if the file isn't a trace
+											 std::FILE* out);
+
+static	int				 run				(int argc, char* argv[]);					// The command line entry
+
+private:
+		void			 background			();											// The drain thread
+
+		void			 flush				();
+
+	std::unique_ptr<SpscQueue<TraceRecord, TRACE_RING_RECORDS>> m_ring;	// on the heap, it's far too big for a stack
+	std::FILE*				m_file;
+	std::thread				m_thread;
+	std::atomic<bool>		m_draining;					// the thread keeps going until this is cleared
+	bool					m_background;
+	TraceRecord				m_previous;					// the last one coded, the draining side's
+	std::vector<Byte>		m_buffer;					// coded records waiting to be written
+	size_t					m_used;
+	std::atomic<QWord>		m_records;
+	std::atomic<QWord>		m_bytes;
+	std::atomic<QWord>		m_stalls;					// records that found the ring full, once each however long they waited
+};
+
+}
@@ -1,56 +1,78 @@
 #include "emu6502.h"
+#include "Jit.h"
+#include "Disassembler.h"
+#include "Trace.h"
+#include "Profiler.h"
+#include "CallGraph.h"
 #include <exception>
 #include <map>
 #include <fstream>
 #include <iostream>
 #include <exception>
 #include <iomanip>
+#include <algorithm>
 
 
 using namespace Emu;
 
 emu6502::emu6502()
-	: m_cpu(), m_addrVal(0x00), m_addrRel(0x00)
+	: m_cpu(), m_addrVal(0x00), m_addrRel(0x00), m_lastAddressMode(Address_Mode::IMP), m_opcode(0x00), m_cycles(0),
+	  m_lazyFlags(false), m_flagN(0x00), m_flagZ(0x01), m_flagC(0x00), m_flagV(0x00), m_pageWatch(), m_mmioWritten(false), m_breakpointCount(0), m_block(nullptr), m_decoded(nullptr), m_decodedEnd(nullptr),
+	  m_jitEnabled(false), m_jitThreshold(JIT_THRESHOLD), m_blockEntry(true), m_dirtyGeneration(0), m_pageGenerations(), m_skipLoops(true),
+	  m_trace(nullptr), m_traceCycles(0), m_profiler(nullptr), m_callGraph(nullptr)
 {
-	m_bus[RESET_VECTOR] = 0X00;
-	m_bus[RESET_VECTOR + 1] = 0X10;
+	m_dirtyPages.set();
+	m_dirtyList.reserve(256);
+	for (size_t page = 0; page < 256; ++page) m_dirtyList.push_back(static_cast<Byte>(page));
 
-	Byte hi = m_bus[RESET_VECTOR + 1];
-	Byte lo = m_bus[RESET_VECTOR];
+	Byte* bus = m_memory.getBus();
+	bus[RESET_VECTOR] = 0X00;
+	bus[RESET_VECTOR + 1] = 0X10;
+
+	Byte hi = bus[RESET_VECTOR + 1];
+	Byte lo = bus[RESET_VECTOR];
 	m_cpu.p = Word((hi << 8) | lo);
 
-	// initialize the lookup table of opcodes
+	// initialize the lookup table of opcodes from the opcode table. The instruction and addressing mode functions are in the same order
+	// as the Operation and Address_Mode enums
 	using a = emu6502;
-	m_lookup =
+	using Function = Byte(emu6502::*)();
+	static const Function EXEC[] =
+	{
+		&a::ADC, &a::AND, &a::ASL, &a::BCC, &a::BCS, &a::BEQ, &a::BIT, &a::BMI,
+		&a::BNE, &a::BPL, &a::BRK, &a::BVC, &a::BVS, &a::CLC, &a::CLD, &a::CLI,
+		&a::CLV, &a::CMP, &a::CPX, &a::CPY, &a::DEC, &a::DEX, &a::DEY, &a::EOR,
+		&a::INC, &a::INX, &a::INY, &a::JMP, &a::JSR, &a::LDA, &a::LDX, &a::LDY,
+		&a::LSR, &a::NOP, &a::ORA, &a::PHA, &a::PHP, &a::PLA, &a::PLP, &a::ROL,
+		&a::ROR, &a::RTI, &a::RTS, &a::SBC, &a::SEC, &a::SED, &a::SEI, &a::STA,
+		&a::STX, &a::STY, &a::TAX, &a::TAY, &a::TSX, &a::TXA, &a::TXS, &a::TYA,
+		&a::XXX
+	};
+	static const Function ADDR[] =
 	{
-		{ "BRK", &a::BRK, &a::IMM, 7 },{ "ORA", &a::ORA, &a::IZX, 6 },{ "???", &a::XXX, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 8 },{ "???", &a::NOP, &a::IMP, 3 },{ "ORA", &a::ORA, &a::ZP0, 3 },{ "ASL", &a::ASL, &a::ZP0, 5 },{ "???", &a::XXX, &a::IMP, 5 },{ "PHP", &a::PHP, &a::IMP, 3 },{ "ORA", &a::ORA, &a::IMM, 2 },{ "ASL", &a::ASL, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 2 },{ "???", &a::NOP, &a::IMP, 4 },{ "ORA", &a::ORA, &a::ABS, 4 },{ "ASL", &a::ASL, &a::ABS, 6 },{ "???", &a::XXX, &a::IMP, 6 },
-		{ "BPL", &a::BPL, &a::REL, 2 },{ "ORA", &a::ORA, &a::IZY, 5 },{ "???", &a::XXX, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 8 },{ "???", &a::NOP, &a::IMP, 4 },{ "ORA", &a::ORA, &a::ZPX, 4 },{ "ASL", &a::ASL, &a::ZPX, 6 },{ "???", &a::XXX, &a::IMP, 6 },{ "CLC", &a::CLC, &a::IMP, 2 },{ "ORA", &a::ORA, &a::ABY, 4 },{ "???", &a::NOP, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 7 },{ "???", &a::NOP, &a::IMP, 4 },{ "ORA", &a::ORA, &a::ABX, 4 },{ "ASL", &a::ASL, &a::ABX, 7 },{ "???", &a::XXX, &a::IMP, 7 },
-		{ "JSR", &a::JSR, &a::ABS, 6 },{ "AND", &a::AND, &a::IZX, 6 },{ "???", &a::XXX, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 8 },{ "BIT", &a::BIT, &a::ZP0, 3 },{ "AND", &a::AND, &a::ZP0, 3 },{ "ROL", &a::ROL, &a::ZP0, 5 },{ "???", &a::XXX, &a::IMP, 5 },{ "PLP", &a::PLP, &a::IMP, 4 },{ "AND", &a::AND, &a::IMM, 2 },{ "ROL", &a::ROL, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 2 },{ "BIT", &a::BIT, &a::ABS, 4 },{ "AND", &a::AND, &a::ABS, 4 },{ "ROL", &a::ROL, &a::ABS, 6 },{ "???", &a::XXX, &a::IMP, 6 },
-		{ "BMI", &a::BMI, &a::REL, 2 },{ "AND", &a::AND, &a::IZY, 5 },{ "???", &a::XXX, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 8 },{ "???", &a::NOP, &a::IMP, 4 },{ "AND", &a::AND, &a::ZPX, 4 },{ "ROL", &a::ROL, &a::ZPX, 6 },{ "???", &a::XXX, &a::IMP, 6 },{ "SEC", &a::SEC, &a::IMP, 2 },{ "AND", &a::AND, &a::ABY, 4 },{ "???", &a::NOP, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 7 },{ "???", &a::NOP, &a::IMP, 4 },{ "AND", &a::AND, &a::ABX, 4 },{ "ROL", &a::ROL, &a::ABX, 7 },{ "???", &a::XXX, &a::IMP, 7 },
-		{ "RTI", &a::RTI, &a::IMP, 6 },{ "EOR", &a::EOR, &a::IZX, 6 },{ "???", &a::XXX, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 8 },{ "???", &a::NOP, &a::IMP, 3 },{ "EOR", &a::EOR, &a::ZP0, 3 },{ "LSR", &a::LSR, &a::ZP0, 5 },{ "???", &a::XXX, &a::IMP, 5 },{ "PHA", &a::PHA, &a::IMP, 3 },{ "EOR", &a::EOR, &a::IMM, 2 },{ "LSR", &a::LSR, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 2 },{ "JMP", &a::JMP, &a::ABS, 3 },{ "EOR", &a::EOR, &a::ABS, 4 },{ "LSR", &a::LSR, &a::ABS, 6 },{ "???", &a::XXX, &a::IMP, 6 },
-		{ "BVC", &a::BVC, &a::REL, 2 },{ "EOR", &a::EOR, &a::IZY, 5 },{ "???", &a::XXX, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 8 },{ "???", &a::NOP, &a::IMP, 4 },{ "EOR", &a::EOR, &a::ZPX, 4 },{ "LSR", &a::LSR, &a::ZPX, 6 },{ "???", &a::XXX, &a::IMP, 6 },{ "CLI", &a::CLI, &a::IMP, 2 },{ "EOR", &a::EOR, &a::ABY, 4 },{ "???", &a::NOP, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 7 },{ "???", &a::NOP, &a::IMP, 4 },{ "EOR", &a::EOR, &a::ABX, 4 },{ "LSR", &a::LSR, &a::ABX, 7 },{ "???", &a::XXX, &a::IMP, 7 },
-		{ "RTS", &a::RTS, &a::IMP, 6 },{ "ADC", &a::ADC, &a::IZX, 6 },{ "???", &a::XXX, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 8 },{ "???", &a::NOP, &a::IMP, 3 },{ "ADC", &a::ADC, &a::ZP0, 3 },{ "ROR", &a::ROR, &a::ZP0, 5 },{ "???", &a::XXX, &a::IMP, 5 },{ "PLA", &a::PLA, &a::IMP, 4 },{ "ADC", &a::ADC, &a::IMM, 2 },{ "ROR", &a::ROR, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 2 },{ "JMP", &a::JMP, &a::IND, 5 },{ "ADC", &a::ADC, &a::ABS, 4 },{ "ROR", &a::ROR, &a::ABS, 6 },{ "???", &a::XXX, &a::IMP, 6 },
-		{ "BVS", &a::BVS, &a::REL, 2 },{ "ADC", &a::ADC, &a::IZY, 5 },{ "???", &a::XXX, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 8 },{ "???", &a::NOP, &a::IMP, 4 },{ "ADC", &a::ADC, &a::ZPX, 4 },{ "ROR", &a::ROR, &a::ZPX, 6 },{ "???", &a::XXX, &a::IMP, 6 },{ "SEI", &a::SEI, &a::IMP, 2 },{ "ADC", &a::ADC, &a::ABY, 4 },{ "???", &a::NOP, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 7 },{ "???", &a::NOP, &a::IMP, 4 },{ "ADC", &a::ADC, &a::ABX, 4 },{ "ROR", &a::ROR, &a::ABX, 7 },{ "???", &a::XXX, &a::IMP, 7 },
-		{ "???", &a::NOP, &a::IMP, 2 },{ "STA", &a::STA, &a::IZX, 6 },{ "???", &a::NOP, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 6 },{ "STY", &a::STY, &a::ZP0, 3 },{ "STA", &a::STA, &a::ZP0, 3 },{ "STX", &a::STX, &a::ZP0, 3 },{ "???", &a::XXX, &a::IMP, 3 },{ "DEY", &a::DEY, &a::IMP, 2 },{ "???", &a::NOP, &a::IMP, 2 },{ "TXA", &a::TXA, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 2 },{ "STY", &a::STY, &a::ABS, 4 },{ "STA", &a::STA, &a::ABS, 4 },{ "STX", &a::STX, &a::ABS, 4 },{ "???", &a::XXX, &a::IMP, 4 },
-		{ "BCC", &a::BCC, &a::REL, 2 },{ "STA", &a::STA, &a::IZY, 6 },{ "???", &a::XXX, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 6 },{ "STY", &a::STY, &a::ZPX, 4 },{ "STA", &a::STA, &a::ZPX, 4 },{ "STX", &a::STX, &a::ZPY, 4 },{ "???", &a::XXX, &a::IMP, 4 },{ "TYA", &a::TYA, &a::IMP, 2 },{ "STA", &a::STA, &a::ABY, 5 },{ "TXS", &a::TXS, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 5 },{ "???", &a::NOP, &a::IMP, 5 },{ "STA", &a::STA, &a::ABX, 5 },{ "???", &a::XXX, &a::IMP, 5 },{ "???", &a::XXX, &a::IMP, 5 },
-		{ "LDY", &a::LDY, &a::IMM, 2 },{ "LDA", &a::LDA, &a::IZX, 6 },{ "LDX", &a::LDX, &a::IMM, 2 },{ "???", &a::XXX, &a::IMP, 6 },{ "LDY", &a::LDY, &a::ZP0, 3 },{ "LDA", &a::LDA, &a::ZP0, 3 },{ "LDX", &a::LDX, &a::ZP0, 3 },{ "???", &a::XXX, &a::IMP, 3 },{ "TAY", &a::TAY, &a::IMP, 2 },{ "LDA", &a::LDA, &a::IMM, 2 },{ "TAX", &a::TAX, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 2 },{ "LDY", &a::LDY, &a::ABS, 4 },{ "LDA", &a::LDA, &a::ABS, 4 },{ "LDX", &a::LDX, &a::ABS, 4 },{ "???", &a::XXX, &a::IMP, 4 },
-		{ "BCS", &a::BCS, &a::REL, 2 },{ "LDA", &a::LDA, &a::IZY, 5 },{ "???", &a::XXX, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 5 },{ "LDY", &a::LDY, &a::ZPX, 4 },{ "LDA", &a::LDA, &a::ZPX, 4 },{ "LDX", &a::LDX, &a::ZPY, 4 },{ "???", &a::XXX, &a::IMP, 4 },{ "CLV", &a::CLV, &a::IMP, 2 },{ "LDA", &a::LDA, &a::ABY, 4 },{ "TSX", &a::TSX, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 4 },{ "LDY", &a::LDY, &a::ABX, 4 },{ "LDA", &a::LDA, &a::ABX, 4 },{ "LDX", &a::LDX, &a::ABY, 4 },{ "???", &a::XXX, &a::IMP, 4 },
-		{ "CPY", &a::CPY, &a::IMM, 2 },{ "CMP", &a::CMP, &a::IZX, 6 },{ "???", &a::NOP, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 8 },{ "CPY", &a::CPY, &a::ZP0, 3 },{ "CMP", &a::CMP, &a::ZP0, 3 },{ "DEC", &a::DEC, &a::ZP0, 5 },{ "???", &a::XXX, &a::IMP, 5 },{ "INY", &a::INY, &a::IMP, 2 },{ "CMP", &a::CMP, &a::IMM, 2 },{ "DEX", &a::DEX, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 2 },{ "CPY", &a::CPY, &a::ABS, 4 },{ "CMP", &a::CMP, &a::ABS, 4 },{ "DEC", &a::DEC, &a::ABS, 6 },{ "???", &a::XXX, &a::IMP, 6 },
-		{ "BNE", &a::BNE, &a::REL, 2 },{ "CMP", &a::CMP, &a::IZY, 5 },{ "???", &a::XXX, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 8 },{ "???", &a::NOP, &a::IMP, 4 },{ "CMP", &a::CMP, &a::ZPX, 4 },{ "DEC", &a::DEC, &a::ZPX, 6 },{ "???", &a::XXX, &a::IMP, 6 },{ "CLD", &a::CLD, &a::IMP, 2 },{ "CMP", &a::CMP, &a::ABY, 4 },{ "NOP", &a::NOP, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 7 },{ "???", &a::NOP, &a::IMP, 4 },{ "CMP", &a::CMP, &a::ABX, 4 },{ "DEC", &a::DEC, &a::ABX, 7 },{ "???", &a::XXX, &a::IMP, 7 },
-		{ "CPX", &a::CPX, &a::IMM, 2 },{ "SBC", &a::SBC, &a::IZX, 6 },{ "???", &a::NOP, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 8 },{ "CPX", &a::CPX, &a::ZP0, 3 },{ "SBC", &a::SBC, &a::ZP0, 3 },{ "INC", &a::INC, &a::ZP0, 5 },{ "???", &a::XXX, &a::IMP, 5 },{ "INX", &a::INX, &a::IMP, 2 },{ "SBC", &a::SBC, &a::IMM, 2 },{ "NOP", &a::NOP, &a::IMP, 2 },{ "???", &a::SBC, &a::IMP, 2 },{ "CPX", &a::CPX, &a::ABS, 4 },{ "SBC", &a::SBC, &a::ABS, 4 },{ "INC", &a::INC, &a::ABS, 6 },{ "???", &a::XXX, &a::IMP, 6 },
-		{ "BEQ", &a::BEQ, &a::REL, 2 },{ "SBC", &a::SBC, &a::IZY, 5 },{ "???", &a::XXX, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 8 },{ "???", &a::NOP, &a::IMP, 4 },{ "SBC", &a::SBC, &a::ZPX, 4 },{ "INC", &a::INC, &a::ZPX, 6 },{ "???", &a::XXX, &a::IMP, 6 },{ "SED", &a::SED, &a::IMP, 2 },{ "SBC", &a::SBC, &a::ABY, 4 },{ "NOP", &a::NOP, &a::IMP, 2 },{ "???", &a::XXX, &a::IMP, 7 },{ "???", &a::NOP, &a::IMP, 4 },{ "SBC", &a::SBC, &a::ABX, 4 },{ "INC", &a::INC, &a::ABX, 7 },{ "???", &a::XXX, &a::IMP, 7 }
+		&a::IMP, &a::IMM, &a::REL, &a::ZP0, &a::ZPX, &a::ZPY, &a::ABS, &a::ABX, &a::ABY, &a::IND, &a::IZX, &a::IZY
 	};
+
+	m_lookup.reserve(256);
+	for (const OpcodeInfo& info : OPCODES)
+		m_lookup.push_back({ info.mnemonic, EXEC[static_cast<size_t>(info.operation)], ADDR[info.mode], info.cycles });
+}
+
+// Out of line so the unique_ptr can see the whole Jit
+emu6502::~emu6502()
+{
 }
 
 /** Getter functions */
 const CPU& emu6502::getCPU() const
 {
+	syncFlags();
 	return m_cpu;
 }
 
 Byte* emu6502::getBus() 
 {
-	return m_bus;
+	return m_memory.getBus();
 }
 
 int emu6502::getAddressRelative() const
@@ -60,7 +82,7 @@ int emu6502::getAddressRelative() const
 
 std::string_view emu6502::getInstructionName() const
 {
-	return m_instruction.mnemonic;
+	return m_lookup[m_opcode].mnemonic;
 }
 
 int emu6502::getAddressValue() const
@@ -70,7 +92,29 @@ int emu6502::getAddressValue() const
 
 Byte emu6502::getCycles() const
 {
-	return m_instruction.cycles;
+	return m_cycles;
+}
+
+Word emu6502::getProgramCounter() const
+{
+	return m_cpu.p.getCopy();
+}
+
+// The wozmon waits for a key with LDA $D011 / BPL back to it, AD 11 D0 10 FB, and basic and the assembler wait the same way. The load can
+// be LDA, LDX, LDY or BIT and the program counter can be on either instruction. Nothing else happens in the loop so while bit 7 stays clear
+// it only burns cycles
+bool emu6502::isPolling(const Word& addr) const
+{
+	const Word pc = getProgramCounter();
+	for (Word load : { pc, static_cast<Word>(pc - 3) })
+	{
+		Byte op = m_memory.fetch(load);
+		if ((op == 0xAD or op == 0xAE or op == 0xAC or op == 0x2C)
+			and m_memory.fetch(load + 1) == (addr & 0xFF) and m_memory.fetch(load + 2) == (addr >> 8)
+			and m_memory.fetch(load + 3) == 0x10 and m_memory.fetch(load + 4) == 0xFB)
+			return true;
+	}
+	return false;
 }
 
 /** Operational functions **/
@@ -79,30 +123,33 @@ void emu6502::clock()
 	DEBUG_OUT("Clock");
 	if (m_instruction.cycles == 0)
 	{
-		Byte opcode = m_bus[m_cpu.p++];
+		flushFlags();
+		m_opcode = m_memory.fetch(m_cpu.p++);
 
-		m_instruction = m_lookup[opcode];
+		m_instruction = m_lookup[m_opcode];
 		(this->*m_instruction.addr)();
 		(this->*m_instruction.exec)();
 		//DEBUG_OUT(*this);
 	}
-	--m_instruction.cycles;
+	m_cycles = --m_instruction.cycles;
 }
 
 void emu6502::reset()
 {
-	Byte hi = m_bus[RESET_VECTOR + 1];
-	Byte lo = m_bus[RESET_VECTOR];
+	Byte hi = m_memory.read(RESET_VECTOR + 1);
+	Byte lo = m_memory.read(RESET_VECTOR);
 	m_cpu.p = Word((hi << 8) | lo);
 	m_cpu.a = 0x00;
 	m_cpu.x = 0x00;
 	m_cpu.y = 0x00;
 	m_cpu.s = STACK_TOP;
+	leaveBlock();
 }
 
 void emu6502::irq()
 {
 	DEBUG_OUT("IRQ");
+	flushFlags();
 	busWrite(m_cpu.s--, m_cpu.p.getCopy() >> 8);			// hi byte of stack pointer
 	busWrite(m_cpu.s--, m_cpu.p.getCopy() & 0XFF);			// lo byte of stack pointer
 	m_cpu.flags.SetBit(Flags::BREAK);						// set break flag
@@ -110,116 +157,332 @@ void emu6502::irq()
 
 	m_cpu.flags.SetBit(Flags::INTERRUPT_DISABLE);
 
-	Byte hi = m_bus[IRQ_VECTOR + 1];
-	Byte lo = m_bus[IRQ_VECTOR];
+	Byte hi = m_memory.read(IRQ_VECTOR + 1);
+	Byte lo = m_memory.read(IRQ_VECTOR);
 	m_cpu.p = Word((hi << 8) | lo);
+	leaveBlock();
+	if (m_callGraph != nullptr) m_callGraph->interrupt(m_cpu.p.getCopy(), m_cpu.s.getCopy());
 }
 
 void emu6502::nmi()
 {
 	DEBUG_OUT("NMI");
-	m_bus[m_cpu.s--] = m_cpu.p.getCopy() >> 8;				// hi byte of stack pointer
-	m_bus[m_cpu.s--] = m_cpu.p.getCopy() & 0XFF;			// lo byte of stack pointer
+	flushFlags();
+	busWrite(m_cpu.s--, m_cpu.p.getCopy() >> 8);				// hi byte of stack pointer
+	busWrite(m_cpu.s--, m_cpu.p.getCopy() & 0XFF);			// lo byte of stack pointer
 	m_cpu.flags.ClearBit(Flags::BREAK);						// clear break flag
-	m_bus[m_cpu.s--] = m_cpu.flags.getCopy();				// push flags with disable bit set
+	busWrite(m_cpu.s--, m_cpu.flags.getCopy());				// push flags with disable bit set
 		
 	m_cpu.flags.SetBit(Flags::INTERRUPT_DISABLE);
 
-	Byte hi = m_bus[NMI_VECTOR + 1];
-	Byte lo = m_bus[NMI_VECTOR];
+	Byte hi = m_memory.read(NMI_VECTOR + 1);
+	Byte lo = m_memory.read(NMI_VECTOR);
 	m_cpu.p = Word((hi << 8) | lo);
+	leaveBlock();
+	if (m_callGraph != nullptr) m_callGraph->interrupt(m_cpu.p.getCopy(), m_cpu.s.getCopy());
 }
 
 Byte emu6502::fetch()
 {
-	Byte byte = m_bus[m_cpu.p++];
+	Byte byte = m_memory.fetch(m_cpu.p++);
 	return byte;
 }
 
 size_t emu6502::fetch_and_execute()
 {
-	Byte opcode = m_bus[m_cpu.p++];
+#if defined(EMU_BLOCK_CACHE)
+	return executeCached();
+#elif defined(EMU_SWITCH_CORE)
+	return executeSwitch();
+#else
+	return executeLookup();
+#endif
+}
 
-	m_instruction = m_lookup[opcode];
+// The original core. Copies the instruction out of the lookup table and calls the addressing mode and instruction through their member function pointers
+size_t emu6502::executeLookup()
+{
+	flushFlags();
+	m_opcode = m_memory.fetch(m_cpu.p++);
+
+	m_instruction = m_lookup[m_opcode];
 	(this->*m_instruction.addr)();
 	(this->*m_instruction.exec)();
-	return 0;
+	m_cycles = m_instruction.cycles;
+	return m_cycles;
+}
+
+// The loop the frontend runs a slice of time through, so it only has to look at its I/O between slices instead of after every instruction.
+// Translated blocks are run whole when the JIT is on and nothing needs checking between instructions, and so are cached blocks in a build
+// that runs from the block cache, otherwise it's the core selected at build time. Either way the cycles and instructions come back exact,
+// the budget can be overrun by the last instruction or block. The trace, the profiler and the call graph are looked at once here so with
+// them off the only cost is a branch on a register that never changes for the whole slice
+template<bool CONDITION>
+RunResult emu6502::run(QWord budget, const std::function<bool(const emu6502&)>* condition)
+{
+	RunResult result;
+	const bool observed = m_trace != nullptr or m_profiler != nullptr or m_callGraph != nullptr;
+#if defined(EMU_BLOCK_CACHE)
+	const bool blocks = !CONDITION and m_breakpointCount == 0 and !observed;
+#else
+	const bool blocks = !CONDITION and m_jitEnabled and m_breakpointCount == 0 and !observed;
+#endif
+	m_mmioWritten = false;
+
+	while (result.cycles < budget)
+	{
+		if (m_breakpointCount != 0 and result.instructions != 0 and m_breakpoints[m_cpu.p.getCopy()])
+		{
+			result.stop = Stop::BREAKPOINT;
+			break;
+		}
+
+		if (blocks)
+		{
+			RunResult step = m_jitEnabled ? executeBlock(budget - result.cycles) : executeCachedBlocks(budget - result.cycles);
+			result.cycles += step.cycles;
+			result.instructions += step.instructions;
+		}
+		else if (!observed)
+		{
+			result.cycles += fetch_and_execute();
+			++result.instructions;
+		}
+		else
+		{
+			result.cycles += observeInstruction();
+			++result.instructions;
+		}
+
+		// The JIT never translates a BRK or a store to the registers, so in a block only the last instruction can be one
+		if (m_mmioWritten)
+		{
+			result.stop = Stop::MMIO;
+			break;
+		}
+		if (m_opcode == 0x00)
+		{
+			result.stop = Stop::INTERRUPT;
+			break;
+		}
+		if constexpr (CONDITION)
+			if ((*condition)(*this))
+			{
+				result.stop = Stop::CONDITION;
+				break;
+			}
+
+		// A delay loop only gets back to its start through a BNE, so that's the only time to look for one
+		if constexpr (!CONDITION)
+			if (m_opcode == 0xD0 and m_skipLoops and m_breakpointCount == 0 and !observed) skipLoop(result, budget);
+	}
+	return result;
 }
 
-// Sipmly reads a text file of byte sized hexadecimal values
-int emu6502::loadProgram(const char* fname, const Word& addr)
+// The loops programs count down in to waste time, and what one iteration of each costs. Everything but the count is fixed by the code:
+//
+//		DEX / DEY / INX / INY			BNE -3				2 + 3 cycles an iteration
+//		LDX #n  DEX  BNE -3  DEY  BNE -8					an inner loop of n for every count of Y, or LDY and Y inside X
+//
+// All the iterations but the last are jumped over at once with the counter moved on to where they'd have left it. They leave nothing
+// else behind, the flags and whatever the last instruction left are set again by the instructions after them. The last iteration, the one
+// that falls out of the loop, is left to run for real, and so is whatever doesn't fit in the budget, so a slice ends on the same cycle and
+// in the same state as it would have stepping through. Nothing is skipped with a breakpoint set or in run_until, whose condition has to
+// see every instruction
+void emu6502::skipLoop(RunResult& result, QWord budget)
 {
-	size_t counter = addr;
-	std::ifstream ifs(fname, std::ios::binary);
-	std::string hex;
+	if (result.cycles >= budget) return;
+
+	const Word pc = m_cpu.p.getCopy();
+	const Byte op = m_memory.fetch(pc);
+	if (op != 0xCA and op != 0x88 and op != 0xE8 and op != 0xC8 and op != 0xA2 and op != 0xA0) return;
 
-	if (ifs.fail()) return PROGRAM_LOAD_FAILURE;
+	Bits<Byte>* counter = nullptr;
+	QWord count = 0, cycles = 0, instructions = 0;
+	bool up = false;
 
-	try
+	if (m_memory.fetch(pc + 1) == 0xD0 and m_memory.fetch(pc + 2) == 0xFD)
 	{
-		while (ifs >> hex)
-			m_bus[counter++] = std::stoi(hex, nullptr, 16);
+		if (op == 0xCA or op == 0xE8) counter = &m_cpu.x;
+		else if (op == 0x88 or op == 0xC8) counter = &m_cpu.y;
+		else return;
+
+		up = op == 0xE8 or op == 0xC8;
+		cycles = 5;
+		instructions = 2;
 	}
-	catch (std::exception& e)
+	else if ((op == 0xA2 or op == 0xA0) and m_memory.fetch(pc + 3) == 0xD0 and m_memory.fetch(pc + 4) == 0xFD
+		and m_memory.fetch(pc + 6) == 0xD0 and m_memory.fetch(pc + 7) == 0xF8)
 	{
-		std::cerr << e.what();
-		std::cerr << "\n\tShould be a text file containing the machine code in hex e.g. A2 00 ...";
-		return PROGRAM_LOAD_FAILURE;
+		const Byte inner = m_memory.fetch(pc + 2), outer = m_memory.fetch(pc + 5);
+		if (op == 0xA2 and inner == 0xCA and outer == 0x88) counter = &m_cpu.y;
+		else if (op == 0xA0 and inner == 0x88 and outer == 0xCA) counter = &m_cpu.x;
+		else return;
+
+		const QWord n = m_memory.fetch(pc + 1) == 0 ? 256 : m_memory.fetch(pc + 1);
+		cycles = 2 + n * 5 - 1 + 2 + 3;
+		instructions = 1 + n * 2 + 2;
 	}
-	ifs.close();
-	return PROGRAM_LOAD_SUCCESSFULL;
+	else
+		return;
+
+	const Byte value = counter->getCopy();
+	count = up ? 256 - value : (value == 0 ? 256 : value);			// iterations left, counting the one running out
+	count = std::min(count - 1, (budget - result.cycles - 1) / cycles);
+	if (count == 0) return;
+
+	*counter = static_cast<Byte>(up ? value + count : value - count);
+	if (counter == &m_cpu.y and op == 0xA2) m_cpu.x = 0x00;			// the inner loop ran down as well
+	if (counter == &m_cpu.x and op == 0xA0) m_cpu.y = 0x00;
+
+	result.cycles += count * cycles;
+	result.instructions += count * instructions;
+
+	LoopSkipStats& stats = m_loopSkips[pc];
+	++stats.hits;
+	stats.iterations += count;
+	stats.cycles += count * cycles;
+	stats.instructions += count * instructions;
 }
 
-// Same as loadProgram but if the line starts with a memory address it is ignored e.g. FF00: a9 4c......
-int Emu::emu6502::loadProgram2(const char* fname, const Word& addr)
+void emu6502::setLoopSkipping(bool enabled)
 {
-	size_t counter = addr;
-	std::ifstream ifs(fname, std::ios::in);
-	std::string value;
+	m_skipLoops = enabled;
+}
 
-	if (ifs.fail()) return PROGRAM_LOAD_FAILURE;
+bool emu6502::getLoopSkipping() const
+{
+	return m_skipLoops;
+}
 
-	try 
-	{
-		while (ifs >> value)
-		{
-			if (value.size() == 2)
-			{
-				m_bus[counter++] = std::stoi(value, nullptr, 16);
-			}
-		}
-	
-	}
-	catch (std::exception& e)
-	{
-		std::cerr << e.what();
-		return PROGRAM_LOAD_FAILURE;
-	}
+// Kept out of line so the plain loop doesn't carry it. The profiler gets the same cycles getCycles would, and the call graph the stack
+// pointer and program counter the instruction left
+size_t emu6502::observeInstruction()
+{
+	const Word pc = m_cpu.p.getCopy();
+	const size_t cycles = m_trace == nullptr ? fetch_and_execute() : traceInstruction();
+	if (m_profiler != nullptr) m_profiler->count(pc, m_cycles);
+	if (m_callGraph != nullptr) m_callGraph->step(m_opcode, m_cycles, m_cpu.s.getCopy(), m_cpu.p.getCopy());
+	return cycles;
+}
+
+// The registers are taken before the instruction runs and the effective address after, from m_addrVal, which every core leaves the same
+size_t emu6502::traceInstruction()
+{
+	const Word pc = m_cpu.p.getCopy();
+	TraceRecord record;
+	record.cycle = m_traceCycles;
+	record.pc = pc;
+	record.opcode = m_memory.fetch(pc);
+	const Byte operands = operandBytes(OPCODES[record.opcode].mode);
+	if (operands > 0) record.operand[0] = m_memory.fetch(static_cast<Word>(pc + 1));
+	if (operands > 1) record.operand[1] = m_memory.fetch(static_cast<Word>(pc + 2));
+	record.a = m_cpu.a.getCopy();
+	record.x = m_cpu.x.getCopy();
+	record.y = m_cpu.y.getCopy();
+	record.p = packFlags();
+	record.s = static_cast<Byte>(m_cpu.s.getCopy());
 
-	return PROGRAM_LOAD_SUCCESSFULL;
+	const size_t cycles = fetch_and_execute();
+	record.address = static_cast<Word>(m_addrVal.getCopy());
+	record.cycles = static_cast<Byte>(cycles);
+	m_traceCycles += cycles;
+	m_trace->record(record);
+	return cycles;
 }
 
-// loads a binary rom
-int emu6502::loadProgramHex(const char* fname, const Word& addr)
+void emu6502::setTrace(Trace* trace)
 {
-	std::ifstream ifs(fname, std::ios::binary | std::ios::ate); // Open at end to get size
-	if (!ifs) return PROGRAM_LOAD_FAILURE; // Check if file opened successfully
+	m_trace = trace;
+	m_traceCycles = 0;
+}
 
-	std::streamsize size = ifs.tellg(); // Get file size
-	ifs.seekg(0, std::ios::beg); // Reset to beginning
+Trace* emu6502::getTrace() const
+{
+	return m_trace;
+}
 
-	try
-	{
-		ifs.read(reinterpret_cast<char*>(&m_bus[addr]), size); // Load file in one read operation
-	}
-	catch (const std::exception& e)
-	{
-		std::cerr << "Exception: " << e.what() << std::endl;
-		std::cerr << "Error while reading binary file." << std::endl;
-		return PROGRAM_LOAD_FAILURE;
-	}
+void emu6502::setProfiler(Profiler* profiler)
+{
+	m_profiler = profiler;
+}
+
+Profiler* emu6502::getProfiler() const
+{
+	return m_profiler;
+}
+
+void emu6502::setCallGraph(CallGraph* callGraph)
+{
+	m_callGraph = callGraph;
+}
+
+CallGraph* emu6502::getCallGraph() const
+{
+	return m_callGraph;
+}
+
+const std::map<Word, LoopSkipStats>& emu6502::getLoopSkipStats() const
+{
+	return m_loopSkips;
+}
+
+void emu6502::clearLoopSkipStats()
+{
+	m_loopSkips.clear();
+}
+
+RunResult emu6502::run_cycles(QWord budget)
+{
+	return run<false>(budget, nullptr);
+}
+
+RunResult emu6502::run_until(const std::function<bool(const emu6502&)>& condition, QWord budget)
+{
+	return run<true>(budget, &condition);
+}
+
+void emu6502::setBreakpoint(const Word& addr, bool set)
+{
+	if (m_breakpoints.empty()) m_breakpoints.resize(0x10000, false);
+	if (m_breakpoints[addr] != set)
+		set ? ++m_breakpointCount : --m_breakpointCount;
+	m_breakpoints[addr] = set;
+}
+
+void emu6502::clearBreakpoints()
+{
+	m_breakpoints.clear();
+	m_breakpointCount = 0;
+}
+
+// Whatever was written goes out of the block cache, even when the load stops part way. A missing file isn't worth a message, the roms
+// that are optional just aren't there
+int emu6502::loadRom(const char* fname, const Word& addr, RomLoader::Format format)
+{
+	std::vector<RomLoader::Span> spans;
+	RomLoader::Result result = RomLoader::load(fname, addr, m_memory.getBus(), spans, format);
+	for (const RomLoader::Span& span : spans)
+		invalidateBlocks(span.start, static_cast<Word>(span.start + span.length - 1));
+
+	if (result == RomLoader::Result::OK) return PROGRAM_LOAD_SUCCESSFULL;
+	if (result != RomLoader::Result::NO_FILE) std::cerr << fname << ": " << RomLoader::describe(result) << '\n';
+	return PROGRAM_LOAD_FAILURE;
+}
+
+int emu6502::loadProgram(const char* fname, const Word& addr)
+{
+	return loadRom(fname, addr, RomLoader::Format::TEXT);
+}
+
+int Emu::emu6502::loadProgram2(const char* fname, const Word& addr)
+{
+	return loadRom(fname, addr, RomLoader::Format::TEXT);
+}
 
-	return PROGRAM_LOAD_SUCCESSFULL;
+int emu6502::loadProgramHex(const char* fname, const Word& addr)
+{
+	return loadRom(fname, addr, RomLoader::Format::BINARY);
 }
 
 
@@ -247,20 +510,104 @@ int Emu::emu6502::denatureHexText(const char* fname, const char* fname_new)
 	return 0;
 }
 
+// Every store the lookup core makes comes through here, so a write over cached code throws the blocks away
 void emu6502::busWrite(const Word& addr, const Byte& val)
 {
 	DEBUG_OUT("Writing " << static_cast<int>(val) << " to: " << std::hex << static_cast<int>(addr));
-	m_bus[addr] = val;
+	if (m_pageWatch[addr >> 8]) watchWrite(addr, val);
+	else m_memory.getBus()[addr] = val;
+}
+
+// A write to a page that isn't plain ram without cached code. Rom ignores it and a device gets it through the bus
+void emu6502::watchWrite(const Word& addr, const Byte& val)
+{
+	Byte watch = m_pageWatch[addr >> 8];
+	if (!m_memory.write(addr, val)) return;
+	if (watch & WATCH_CODE) invalidateWrite(addr);
+	if (watch & WATCH_IO) m_mmioWritten = true;
+	else if (watch & WATCH_CLEAN) markDirty(addr >> 8);
+}
+
+/*			START
+* dirty pages */
+
+// Pages are watched for their first write only, after that a store to a plain ram page is the same check of m_pageWatch and store as it
+// was without the tracking, in the cores and in the JIT's code. What it costs is one trip through watchWrite for each page written after
+// a clear. Device pages are never dirty, what they hold isn't in memory
+
+void emu6502::markDirty(const Byte& page)
+{
+	if (!m_dirtyPages.test(page)) m_dirtyList.push_back(page);
+	m_dirtyPages.set(page);
+	m_pageGenerations[page] = m_dirtyGeneration;
+	m_pageWatch[page] &= ~WATCH_CLEAN;
+}
+
+const std::bitset<256>& emu6502::getDirtyPages() const
+{
+	return m_dirtyPages;
+}
+
+bool emu6502::isPageDirty(const Byte& page) const
+{
+	return m_dirtyPages.test(page);
+}
+
+QWord emu6502::clearDirtyPages()
+{
+	for (Byte page : m_dirtyList)
+		if (!(m_pageWatch[page] & WATCH_IO)) m_pageWatch[page] |= WATCH_CLEAN;
+	m_dirtyList.clear();
+	m_dirtyPages.reset();
+	return ++m_dirtyGeneration;
+}
+
+QWord emu6502::getDirtyGeneration() const
+{
+	return m_dirtyGeneration;
+}
+
+QWord emu6502::getPageGeneration(const Byte& page) const
+{
+	return m_pageGenerations[page];
 }
+
+/*			END
+* dirty pages */
 Byte emu6502::busRead(const Word& addr)
 {
-	DEBUG_OUT("Reading " << static_cast<int>(m_bus[addr]) << " from: " << std::hex << static_cast<int>(addr));
-	return m_bus[addr];
+	DEBUG_OUT("Reading from: " << std::hex << static_cast<int>(addr));
+	return m_memory.read(addr);
+}
+
+// Translations and the watched pages depend on the map, so everything is decoded again
+bool emu6502::map(const Word& start, const Word& end, const Memory::Page& type, Device* device)
+{
+	if (!m_memory.map(start, end, type, device)) return false;
+
+	for (size_t page = start >> 8; page <= static_cast<size_t>(end >> 8); ++page)
+	{
+		m_pageWatch[page] &= WATCH_CODE | WATCH_CLEAN;
+		if (type == Memory::Page::ROM) m_pageWatch[page] |= WATCH_ROM;
+		if (type == Memory::Page::DEVICE) m_pageWatch[page] = (m_pageWatch[page] & ~WATCH_CLEAN) | WATCH_IO;
+	}
+	invalidateBlocks();
+	return true;
 }
 
 void emu6502::setProgramCounter(const Word& p)
 {
 	m_cpu.p = static_cast<Word>(p);
+	leaveBlock();
+}
+
+// The flags go in whole, the lazy ones are picked up from them by the next instruction the switch core runs
+void emu6502::setCPU(const CPU& cpu)
+{
+	m_cpu = cpu;
+	m_lazyFlags = false;
+	m_instruction.cycles = 0;
+	leaveBlock();
 }
 
 /*			START
@@ -289,7 +636,6 @@ Byte emu6502::ZP0()
 	DEBUG_OUT("Zero page");
 	m_addrVal = fetch();
 	DEBUG_OUT("\tAddrVal: " << m_addrVal.getCopy());
-	DEBUG_OUT("\t\tValue at address: " << static_cast<int>(m_bus[static_cast<Word>(m_addrVal.getCopy())]));
 	return static_cast<Byte>(Address_Mode::ZP0);
 }
 
@@ -378,11 +724,11 @@ Byte emu6502::IND()  // Indirection is only used by JMP
 	// Page boundary hardware bug
 	if (ptr_lo == 0xFF)
 	{
-		m_addrVal = static_cast<Word>((m_bus[ptr & 0xFF00] << 8) | m_bus[ptr]);
+		m_addrVal = static_cast<Word>((busRead(ptr & 0xFF00) << 8) | busRead(ptr));
 	}
 	else
 	{
-		m_addrVal = static_cast<Word>((m_bus[ptr + 1] << 8) | m_bus[ptr]);
+		m_addrVal = static_cast<Word>((busRead(ptr + 1) << 8) | busRead(ptr));
 	}
 
 	DEBUG_OUT("\tJump Address: " << std::hex << m_addrVal.getCopy());
@@ -532,7 +878,7 @@ Byte emu6502::CPY()
 {
 	DEBUG_OUT("CPY");
 	// First check if it was immediate addressing, then m_addrVal has value, otherwise value is at m_bus[m_addrVal]
-	if (m_instruction.addr != &emu6502::IMM) m_addrVal = m_bus[static_cast<Word>(m_addrVal.getCopy())];
+	if (m_instruction.addr != &emu6502::IMM) m_addrVal = busRead(static_cast<Word>(m_addrVal.getCopy()));
 	Byte result = m_cpu.y.getCopy() - m_addrVal.getCopy();
 
 	DEBUG_OUT("\tResult: " << (int)result);
@@ -706,12 +1052,12 @@ Byte emu6502::BVS()
 Byte emu6502::BRK()
 {
 	DEBUG_OUT("BRK");
-	m_bus[m_cpu.s--] = static_cast<Byte>(m_cpu.p.getCopy() >> 8);			// hi byte of stack pointer
-	m_bus[m_cpu.s--] = static_cast<Byte>(m_cpu.p.getCopy() & 0XFF);			// lo byte of stack pointer
+	busWrite(m_cpu.s--, static_cast<Byte>(m_cpu.p.getCopy() >> 8));			// hi byte of stack pointer
+	busWrite(m_cpu.s--, static_cast<Byte>(m_cpu.p.getCopy() & 0XFF));			// lo byte of stack pointer
 	m_cpu.flags.SetBit(Flags::BREAK);										// set break flag
-	m_bus[m_cpu.s--] = m_cpu.flags.getCopy();								// push flags
+	busWrite(m_cpu.s--, m_cpu.flags.getCopy());								// push flags
 	m_cpu.flags.ClearBit(Flags::BREAK);										// clear break flag
-	m_cpu.p = Word(m_bus[IRQ_VECTOR + 1] | m_bus[IRQ_VECTOR]);				// load address at irq vector
+	m_cpu.p = Word(busRead(IRQ_VECTOR + 1) | busRead(IRQ_VECTOR));			// load address at irq vector
 
 	return 0x00;
 }
@@ -783,7 +1129,8 @@ Byte emu6502::SEI()
 Byte emu6502::DEC()
 {
 	DEBUG_OUT("DEC");
-	Byte value = --(m_bus[(Word)m_addrVal.get()]);
+	Byte value = busRead((Word)m_addrVal.get()) - 1;
+	busWrite((Word)m_addrVal.get(), value);
 	checkFlag(value == 0, Flags::ZERO);
 	checkFlag(Bits<Byte>::CheckBit(value, LastBit<Byte>), Flags::NEGATIVE);
 	
@@ -794,7 +1141,8 @@ Byte emu6502::DEC()
 Byte emu6502::INC()
 {
 	DEBUG_OUT("INC");
-	Byte value = ++(m_bus[(Word)m_addrVal.get()]);
+	Byte value = busRead((Word)m_addrVal.get()) + 1;
+	busWrite((Word)m_addrVal.get(), value);
 	checkFlag(value == 0, Flags::ZERO);
 	checkFlag(Bits<Byte>::CheckBit(value, LastBit<Byte>), Flags::NEGATIVE);
 	return 0x00;
@@ -853,8 +1201,8 @@ Byte emu6502::JMP()
 Byte emu6502::JSR()
 {
 	DEBUG_OUT("JSR");
-	m_bus[m_cpu.s--] = Byte(m_cpu.p.getCopy() >> 8);			// hi byte of program counter
-	m_bus[m_cpu.s--] = Byte(m_cpu.p.getCopy() & 0XFF);			// lo byte of program counter
+	busWrite(m_cpu.s--, Byte(m_cpu.p.getCopy() >> 8));			// hi byte of program counter
+	busWrite(m_cpu.s--, Byte(m_cpu.p.getCopy() & 0XFF));			// lo byte of program counter
 	m_cpu.p = static_cast<Word>(m_addrVal.getCopy());
 	return 0x00;
 }
@@ -919,9 +1267,11 @@ Byte emu6502::ASL()
 	else
 	{
 		Word address = static_cast<Word>(m_addrVal.getCopy());					 // We're operating on m_bus[m_addrVal] which has to be cast to a Word. Make using it easier and clearer
-		checkFlag(Bits<Byte>::CheckBit(m_bus[address], LastBit<Byte>), Flags::CARRY);
-		Bits<Byte>::Las(m_bus[address]);
-		result = m_bus[address];
+		Byte value = busRead(address);
+		checkFlag(Bits<Byte>::CheckBit(value, LastBit<Byte>), Flags::CARRY);
+		Bits<Byte>::Las(value);
+		result = value;
+		busWrite(address, result.getCopy());
 	}
 
 	checkFlag(result.CheckBit(LastBit<Byte>), Flags::NEGATIVE);
@@ -948,9 +1298,11 @@ Byte emu6502::LSR()
 	else
 	{
 		Word address = static_cast<Word>(m_addrVal.getCopy());		 // We're operating on m_bus[m_addrVal] which has to be cast to a Word. Make using it easier and clearer
-		checkFlag(Bits<Byte>::CheckBit(m_bus[address], 1), Flags::CARRY);
-		Bits<Byte>::Ras(m_bus[address]);
-		result = m_bus[address];
+		Byte value = busRead(address);
+		checkFlag(Bits<Byte>::CheckBit(value, 1), Flags::CARRY);
+		Bits<Byte>::Ras(value);
+		result = value;
+		busWrite(address, result.getCopy());
 	}
 	// Check Zero and Negitve now on result since it could be accumulator or memory
 	checkFlag(result.getCopy() == 0, Flags::ZERO);
@@ -984,16 +1336,18 @@ Byte emu6502::ROL()
 	else
 	{
 		Word address = static_cast<Word>(m_addrVal.getCopy());					 // We're operating on m_bus[m_addrVal] which has to be cast to a Word. Make using it easier and clearer
+		Byte value = busRead(address);
 		//std::cout << "Addr: " << std::hex << static_cast<int>(address) << std::endl;
-		willCarry = Bits<Byte>::CheckBit(m_bus[address], LastBit<Byte>); // If the last bit is set, then a shift left results in a carry. Check it before we shift
+		willCarry = Bits<Byte>::CheckBit(value, LastBit<Byte>); // If the last bit is set, then a shift left results in a carry. Check it before we shift
 
-		Bits<Byte>::Las(m_bus[address]);
+		Bits<Byte>::Las(value);
 		if (oldCarry)
 		{
-			Bits<Byte>::SetBit(m_bus[address], 1);
+			Bits<Byte>::SetBit(value, 1);
 		}
 		// If the first bit was set, then a shift right results in a carry
-		result = m_bus[address];
+		result = value;
+		busWrite(address, result.getCopy());
 	}
 	checkFlag(willCarry, Flags::CARRY);
 	//m_addrVal = result.get();
@@ -1024,11 +1378,13 @@ Byte emu6502::ROR()
 	else
 	{
 		Word address = static_cast<Word>(m_addrVal.getCopy());		 // We're operating on m_bus[m_addrVal] which has to be cast to a Word. Make using it easier and clearer
-		willCarry = Bits<Byte>::CheckBit(m_bus[address], 1); // If the first bit is set, then a shift right results in a carry. Check it before we shift
+		Byte value = busRead(address);
+		willCarry = Bits<Byte>::CheckBit(value, 1); // If the first bit is set, then a shift right results in a carry. Check it before we shift
 
-		Bits<Byte>::Ras(m_bus[address]);
-		if (oldCarry) Bits<Byte>::SetBit(m_bus[address], LastBit<Byte>);
-		result = m_bus[address];
+		Bits<Byte>::Ras(value);
+		if (oldCarry) Bits<Byte>::SetBit(value, LastBit<Byte>);
+		result = value;
+		busWrite(address, result.getCopy());
 	}
 	checkFlag(willCarry, Flags::CARRY);
 	// Check Zero and Negitve now on result since it could be accumulator or memory
@@ -1041,7 +1397,7 @@ Byte emu6502::ROR()
 Byte emu6502::PHA()
 {
 	DEBUG_OUT("PHA");
-	m_bus[m_cpu.s--] = m_cpu.a.getCopy();
+	busWrite(m_cpu.s--, m_cpu.a.getCopy());
 	return 0x00;
 }
 
@@ -1049,7 +1405,7 @@ Byte emu6502::PHA()
 Byte emu6502::PHP()
 {
 	DEBUG_OUT("PHP");
-	m_bus[m_cpu.s--] = m_cpu.flags.getCopy();
+	busWrite(m_cpu.s--, m_cpu.flags.getCopy());
 	return 0x00;
 }
 
@@ -1057,7 +1413,7 @@ Byte emu6502::PHP()
 Byte emu6502::PLA()
 {
 	DEBUG_OUT("PLA");
-	m_cpu.a = m_bus[++m_cpu.s];
+	m_cpu.a = busRead(++m_cpu.s);
 	return 0x00;
 }
 
@@ -1065,7 +1421,7 @@ Byte emu6502::PLA()
 Byte emu6502::PLP()
 {
 	DEBUG_OUT("PLP");
-	m_cpu.flags = m_bus[++m_cpu.s];
+	m_cpu.flags = busRead(++m_cpu.s);
 	return 0x00;
 }
 
@@ -1125,7 +1481,7 @@ Byte emu6502::STX()
 Byte emu6502::TSX()
 {
 	DEBUG_OUT("TSX");
-	m_cpu.x = m_bus[++m_cpu.s];
+	m_cpu.x = busRead(++m_cpu.s);
 
 	checkFlag(m_cpu.x.getCopy() == 0, Flags::ZERO);
 	checkFlag(m_cpu.x.CheckBit(LastBit<Byte>), Flags::NEGATIVE);
@@ -1137,7 +1493,7 @@ Byte emu6502::TSX()
 Byte emu6502::TXS()
 {
 	DEBUG_OUT("TXS");
-	m_bus[m_cpu.s--] = m_cpu.x.getCopy();
+	busWrite(m_cpu.s--, m_cpu.x.getCopy());
 
 	return 0x00;
 }
@@ -1221,279 +1577,20 @@ void emu6502::printMemoryRange(const size_t& start, const size_t& end) const
 	size_t count = 1;
 	for (size_t i = start; i <= end; ++i)
 	{
-		std::cout << std::setw(2) << static_cast<int>(m_bus[i]) << ' ';
+		std::cout << std::setw(2) << static_cast<int>(m_memory.fetch(static_cast<Word>(i))) << ' ';
 		if (count > 1 && count % 32 == 0) std::cout << '\n';
 		++count;
 	}
 }
 
-/*@Todo: 
-	Fix this
-*/
-void emu6502::disassembleText(const char* fname)
+// Only the file is read, into the disassembler's own image, so memory and the registers are left as they are
+bool emu6502::disassembleText(const char* fname, const char* out, const Word& addr) const
 {
-	struct AsmLine
-	{
-		size_t byte = 0;
-		std::string line;
-	};
-	std::vector<AsmLine> lines;
-	std::map<size_t, std::string> labels; // Store labels separately
-	size_t currentByte = 0;
-	size_t labelCount = 0;
-	std::stringstream ss;
-	bool branch = false;
-
-	size_t counter = USER_PROGRAM;
-	std::ofstream ofs;
-	Instruction instr;
-	Word oldPC = m_cpu.p.getCopy();
-
-	Byte opcode = 0x00;
-	Word value = 0x0000;
-	size_t lineNumber = 0;
-
-	m_cpu.p = USER_PROGRAM;
-
-	do
-	{
-		opcode = fetch();
-		currentByte = 1;
-		value = 0;
-		instr = m_lookup[opcode];
-
-		if (instr.addr != &emu6502::IMP)
-		{
-			if (instr.addr == &emu6502::ABS || instr.addr == &emu6502::ABX || instr.addr == &emu6502::ABY ||
-				instr.addr == &emu6502::IND || instr.addr == &emu6502::IZX || instr.addr == &emu6502::IZY)
-			{
-				Byte lo = fetch();
-				Byte hi = fetch();
-				value = (hi << 8) | lo;
-				currentByte = 3;
-			}
-			else
-			{
-				value = fetch();
-				currentByte = 2;
-			}
-		}
-
-		if (instr.exec == &emu6502::BNE || instr.exec == &emu6502::BEQ || instr.exec == &emu6502::BCC || instr.exec == &emu6502::BMI ||
-			instr.exec == &emu6502::BCS || instr.exec == &emu6502::BPL || instr.exec == &emu6502::BVC || instr.exec == &emu6502::BVS)
-		{
-			int offset = static_cast<int>(S_Byte(value));
-			size_t targetAddress = counter + offset + currentByte;
-			labels[targetAddress] = "\t\t   l" + std::to_string(labelCount) + ":\n";
-			branch = true;
-		}
-
-		ss << std::setbase(10) << std::setfill('0') << std::setw(6) << lineNumber << '\t'
-			<< std::setw(2) << std::setbase(16) << static_cast<int>(opcode) << '\t'
-			<< std::setw(4) << std::setfill('0') << value << '\t'
-			<< instr.mnemonic << std::setfill(' ');
-
-		if (instr.addr != &emu6502::IMP)
-		{
-			ss << '\t';
-			if (instr.addr == &emu6502::IMM)
-				ss << "#$" << std::setw(2) << std::setfill('0');
-			else if (!branch)
-				ss << "$";
-
-			if (instr.addr == &emu6502::IND || instr.addr == &emu6502::IZX || instr.addr == &emu6502::IZY)
-				ss << "(";
-
-			if (branch)
-			{
-				ss << "l" << labelCount++;
-			}
-			else
-			{
-				ss << value;
-			}
-
-			if (instr.addr == &emu6502::ABX || instr.addr == &emu6502::ABY || instr.addr == &emu6502::ZPX || instr.addr == &emu6502::ZPY)
-			{
-				ss << ((instr.addr == &emu6502::ZPX || instr.addr == &emu6502::ABX) ? ",X" : ",Y");
-			}
-
-			if (instr.addr == &emu6502::IND || instr.addr == &emu6502::IZX || instr.addr == &emu6502::IZY)
-				ss << ")";
-		}
-		ss << std::endl;
-
-		lines.push_back({ currentByte, ss.str() });
-		++lineNumber;
-		ss.str("");
-		currentByte = 0;
-		branch = false;
-
-	} while (instr.mnemonic != "BRK");
-
-	ofs.open("asm.asm", std::ios::out);
-	ofs << std::setw(6) << "Line #\t" << std::setw(2) << "Op\t" << std::setw(4) << "Value\t" << "Mnemonic\t" << std::endl;
-	ofs << "---------------------------------------------\n";
-
-	size_t currentAddress = USER_PROGRAM;
-	for (const auto& line : lines)
-	{
-		if (labels.count(currentAddress))
-		{
-			ofs << labels[currentAddress];
-		}
-		ofs << line.line;
-		currentAddress += line.byte;
-	}
-
-	ofs.close();
-	m_cpu.p = oldPC;
+	Disassembler dis;
+	if (dis.load(fname, addr, RomLoader::Format::TEXT) != RomLoader::Result::OK) return false;
+	dis.addEntry(addr);
+	dis.addVectors();
+	dis.trace();
+	return dis.write(out);
 }
-	/*
-	struct AsmLine
-	{
-		size_t byte = 0;
-		std::string line;
-	};
-	std::vector<AsmLine> lines(0xFFFF);
-	size_t currentByte = 0;
-	size_t labelCount = 0;
-	std::string str;
-	bool branch = false;
-
-	size_t counter = USER_PROGRAM;
-	std::ofstream ofs;
-	std::stringstream ss;
-	std::string hex;
-	Instruction instr;
-	Word oldPC = m_cpu.p.get();
-
-	Byte opcode = 0x00;
-	Word value = 0x0000;
-	size_t lineNumber = 0;
-
-	m_cpu.p = USER_PROGRAM;
-
-
-	do
-	{
-		opcode = fetch();
-		currentByte = 1;
-		value = 0;
-		instr = m_lookup[opcode];
-
-		// Read the instruction and the necessary bytes of the addressing mode
-		if (instr.addr != &emu6502::IMP)
-		{
-			if (instr.addr == &emu6502::ABS || instr.addr == &emu6502::ABX || instr.addr == &emu6502::ABY ||
-				instr.addr == &emu6502::IND || instr.addr == &emu6502::IZX || instr.addr == &emu6502::IZY)
-			{
-				Byte lo = fetch();
-				Byte hi = fetch();
-				value = (hi << 8) | lo;
-				currentByte = 3;
-			}
-			else
-			{
-				value = fetch();
-				currentByte = 2;
-			}
-		}
-
-		// If the instruction is a branch instruction we need to insert a label at the line specified by the offset
-		if (instr.exec == &emu6502::BNE || instr.exec == &emu6502::BEQ || instr.exec == &emu6502::BCC || instr.exec == &emu6502::BMI ||
-			instr.exec == &emu6502::BCS || instr.exec == &emu6502::BPL || instr.exec == &emu6502::BVC || instr.exec == &emu6502::BVS)
-		{
-			size_t totalBytesMoved = currentByte;
-			branch = true;
-			int offset = static_cast<int>(S_Byte(value));			// this is how many BYTES back to put it
-			ss << "\t\t   l" << labelCount << ":\n";					// generate the label
-			// starting at end of vector, 
-			// while we haven't moved back to the offset position in vector determined by bytes of each line, 
-			// decrement the iterator and add to total bytes moved
-			//auto i = lines.end();
-			//while (totalBytesMoved < std::abs(offset) - 1)
-			//{
-			//	totalBytesMoved += i->byte;
-			//	if (offset < 0)
-			//		i.operator--();
-			//	else
-			//		++i;
-			//}
-			if (offset > 0)
-			{
-				lines.insert(lines.begin() + currentByte + offset, AsmLine { 0, ss.str() });
-			}
-			else
-			{
-				lines.insert(lines.begin() + currentByte - offset, AsmLine{ 0, ss.str() });
-			}
-			//lines.insert(offset > 0 ? lines.begin() + currentByte + offset : lines.begin() + currentByte - offset, {0, ss.str()});
-			// Don't update labelCount yet because we use it again
-			ss.str("");
-		}
-
-		// Populate all the information for the line the be output to the file
-		ss << std::setbase(10) << std::setfill('0') << std::setw(6) << lineNumber << '\t'	// line number
-			<< std::setw(2) << std::setbase(16) << static_cast<int>(opcode) << '\t'			// opcode
-			<< std::setw(4) << std::setfill('0') << value << '\t' 							// value
-			<< instr.mnemonic << std::setfill(' ');											// mnemonic
-
-		// Check if it requires #, $, (), ,X or ,Y and print value
-		if (instr.addr != &emu6502::IMP)													// If it's implied then there's nothing left
-		{
-			ss << '\t';
-			if (instr.addr == &emu6502::IMM)
-				ss << "#$" << std::setw(2) << std::setfill('0');
-			else
-				if (!branch)			// If it's a branch we don't a $ because we're printing a label
-					ss << "$";
-			// If it's an indirect addressing mode we need parenthesis 
-			if (instr.addr == &emu6502::IND || instr.addr == &emu6502::IZX || instr.addr == &emu6502::IZY)
-				ss << "(";
-
-			// If the instruction was a branch then print the label to branch to, otherwise print the value
-			if (branch)
-			{
-				ss << "l" << labelCount;
-				++labelCount;
-			}
-			else
-			{
-				ss << value;
-			}
-
-			// If it's an addressing mode that uses an X or Y register offset then it needs to print ,(X)(Y)
-			if (instr.addr == &emu6502::ABX || instr.addr == &emu6502::ABY || instr.addr == &emu6502::ZPX || instr.addr == &emu6502::ZPY)
-			{
-				if (instr.addr == &emu6502::ZPX || instr.addr == &emu6502::ABX)
-					ss << ",X";
-				else
-					ss << ",Y";
-			}
-
-			// Then again if it was an indirect addressing mode add the ending parenth
-			if (instr.addr == &emu6502::IND || instr.addr == &emu6502::IZX || instr.addr == &emu6502::IZY)
-				ss << ")";
-		}
-		ss << std::endl;
-
-		// Add the line to the lines vector, increase lineNumber, 0 currentByte and clear the string stream
-		lines.push_back({ currentByte, ss.str() });
-		++lineNumber;
-		ss.str("");
-		currentByte = 0;
-		branch = false;
-
-	} while (instr.mnemonic != "BRK");
-
-	// Open the file, print the header, and then print each line in the vector
-	ofs.open("asm.asm", std::ios::out);
-	ofs << std::setw(6) << "Line #\t" << std::setw(2) << "Op\t" << std::setw(4) << "Value\t" << "Mnemonic\t" << std::endl;
-	ofs << "---------------------------------------------\n";
-	for (const auto& line : lines)
-		ofs << line.line;
-	ofs.close();
-	// Restore the program counter
-	m_cpu.p = oldPC;*/
 //}
\ No newline at end of file
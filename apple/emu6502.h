@@ -9,8 +9,16 @@ to make my own 6502 emulator, using his opcode table as the template. Superficia
 #pragma once
 #include <vector>
 #include <string>
+#include <unordered_map>
+#include <map>
+#include <bitset>
+#include <memory>
+#include <functional>
 #include "Debug.h"
 #include "Bit.h"
+#include "Opcodes.h"
+#include "Memory.h"
+#include "RomLoader.h"
 
 // Define reserved regions in memory
 #define STACK_TOP    0x01FF	// storing using the post decrement operator, retreiving uses the pre incremenet operator
@@ -20,18 +28,31 @@ to make my own 6502 emulator, using his opcode table as the template. Superficia
 #define NMI_VECTOR   0XFFFA // FFFA and FFFB
 #define USER_PROGRAM 0XFF00
 
+// Select the interpreter core at build time. The switch core dispatches on the opcode byte with the addressing mode inlined into each case,
+// the lookup core is the original table of member function pointers. Define EMU_LOOKUP_CORE (or configure with -DAPPLE1_SWITCH_CORE=OFF) to use it
+#ifndef EMU_LOOKUP_CORE
+	#define EMU_SWITCH_CORE
+#endif
+
+// Define EMU_BLOCK_CACHE (or configure with -DAPPLE1_BLOCK_CACHE=ON) to have fetch_and_execute run from the block cache instead. It decodes
+// straight line runs of code once and keeps them until something writes over them
+
+// The switch core keeps N, Z, C and V lazily, as the last result and the carry/overflow inputs, and only packs them into CPU::flags when
+// something needs the whole byte (PHP, BRK, an interrupt, getCPU). Define EMU_EAGER_FLAGS (or configure with -DAPPLE1_LAZY_FLAGS=OFF) to
+// have it update CPU::flags on every instruction like the lookup core does
+
+// On x86-64 hot blocks from the block cache can be translated into native code, see Jit.h. It's off until setJit(true) turns it on, then
+// executeBlock runs translated blocks whole, chaining from one into the next, and everything else one instruction at a time with the switch
+// core. It needs the lazy flags
+
 // Declare everything in a namespace
 namespace Emu {
 
 	const int PROGRAM_LOAD_SUCCESSFULL = 0;
 	const int PROGRAM_LOAD_FAILURE = 1;
 
-	// Make it easy to determine which addressing mode we used. Now the addressing mode function can return which address mode it was
-	// with an Address_Mode enum that matches it's index in the ADDRESS_STRINGS array
-	enum Address_Mode
-	{
-		IMP, IMM, REL, ZP0, ZPX, ZPY, ABS, ABX, ABY, IND, IZX, IZY
-	};
+	const size_t BLOCK_MAX_INSTRUCTIONS = 32;		// a block is cut off after this many instructions if nothing ends it sooner
+	const QWord  JIT_THRESHOLD = 16;				// times a block is entered before the JIT translates it
 
 	// enumerate flags 1-8 to be used with the bit class that expects an index to the bit starting at 1. (First bit, second bit, etc)
 	enum Flags
@@ -67,12 +88,55 @@ namespace Emu {
 		}
 	};
 
+	// Counters for the block cache. A hit is a block entered without decoding it, a miss is one that had to be decoded (again)
+	struct BlockCacheStats
+	{
+		QWord hits			= 0;
+		QWord misses		= 0;
+		QWord invalidations	= 0;			// blocks thrown away because something was written over their code
+		QWord compiled		= 0;			// blocks translated by the JIT
+	};
+
+	// What fast forwarding one delay loop has saved, kept for each loop by the address it's entered at
+	struct LoopSkipStats
+	{
+		QWord hits			= 0;			// times the loop was fast forwarded
+		QWord iterations	= 0;			// iterations jumped over
+		QWord cycles		= 0;			// cycles and instructions they would have taken to run
+		QWord instructions	= 0;
+	};
+
+	// Why run_cycles or run_until came back
+	enum class Stop
+	{
+		BUDGET,						// used up the cycles it was given
+		MMIO,						// the last instruction wrote to a device, the Apple 1's display for one
+		BREAKPOINT,					// the program counter is on a breakpoint, the instruction there hasn't run yet
+		INTERRUPT,					// the last instruction was a BRK and the cpu is at the irq handler
+		CONDITION					// run_until's condition came true after the last instruction
+	};
+
+	// What a call that can run more than one instruction got through
+	struct RunResult
+	{
+		QWord cycles		= 0;
+		QWord instructions	= 0;
+		Stop  stop			= Stop::BUDGET;
+	};
+
+	class Jit;
+	class Trace;
+	class Profiler;
+	class CallGraph;
+
 	/* Class declaration */
 	class emu6502
 	{
 	public:
 										emu6502					();																	// Initialization
 
+										~emu6502				();
+
 // The main functionality
 					void					reset					();																	// Reset the state of the processor (set program counter to address at RESET_VECTOR
 
@@ -82,17 +146,66 @@ namespace Emu {
 
 					void					nmi					();																	// Non maskable interrupt
 
-					size_t					fetch_and_execute			();																	// Fetch the opcode and memory mode value and execute it
+					size_t					fetch_and_execute			();																	// Fetch the opcode and memory mode value and execute it with the core selected at build time. Returns the cycles used
+
+					size_t					executeLookup				();																	// Execute one instruction through the member function pointer table
+
+					size_t					executeSwitch				();																	// Execute one instruction through the opcode switch
+
+					size_t					executeCached				();																	// Execute one instruction from the block cache, decoding the block it's in if it isn't cached yet. The switch core's handlers, given the decoded operand
+
+					RunResult				executeCachedBlocks			(QWord budget);														// Run blocks from the block cache back to back until budget cycles have gone by, or something run has to see happens
+
+					RunResult				executeBlock				(QWord budget = 0);														// Run the translated block at the program counter and the translated blocks after it until budget cycles have gone by, otherwise one instruction on the switch core
+
+					bool					setJit					(bool enabled,															// Turn the JIT on or off at any time. Returns false if it can't be turned on in this build
+															 QWord threshold = JIT_THRESHOLD);
+
+					bool					getJit					()										const;
+
+					void					setLoopSkipping				(bool enabled);															// Fast forward delay loops (DEX/BNE, DEY/BNE and an LDX/LDY loop around one) in run_cycles. On by default
+
+					bool					getLoopSkipping				()										const;
+
+					void					setTrace				(Trace* trace);															// run_cycles and run_until record every instruction into trace from their next call
+																																	// on, nullptr to stop. The JIT and loop skipping stand aside while it's on, see Trace.h
+					Trace*					getTrace				()										const;
+
+					void					setProfiler				(Profiler* profiler);														// The same for counting every instruction by its address, see Profiler.h
+
+					Profiler*				getProfiler				()										const;
+
+					void					setCallGraph				(CallGraph* callGraph);														// And for following JSR, BRK and the interrupts into a call tree, see CallGraph.h
 
-					void					busWrite				(const Word& addr, 
+					CallGraph*				getCallGraph				()										const;
+
+					RunResult				run_cycles				(QWord budget);															// Runs until at least budget cycles have gone by, or sooner if one of the things in Stop happens
+
+					RunResult				run_until				(const std::function<bool(const emu6502&)>& condition,					// run_cycles that also stops after the first instruction the condition is true for.
+															 QWord budget = ~QWord(0));										// Goes one instruction at a time, without the JIT
+
+					void					setBreakpoint				(const Word& addr,													// run_cycles and run_until stop before running the instruction at addr, unless it's the
+															 bool set = true);												// first one they run so they can carry on from a breakpoint
+
+					void					clearBreakpoints			();
+
+					void					invalidateBlocks			(const Word& start = 0x0000,											// Throw away cached blocks with code in start-end and mark its pages dirty. Anything that writes memory through getBus() has to call this
+															 const Word& end = 0xFFFF);
+
+					void					busWrite				(const Word& addr, 												// A write the way an instruction makes it, rom ignores it
 															 const Byte& val);
 
 					Byte					busRead					(const Word& addr);
 
+					bool					map					(const Word& start,													// Maps whole pages of the bus as ram, rom or a device and throws
+															 const Word& end,														// away every cached block. False for a device page without a device
+															 const Memory::Page& type,
+															 Device* device = nullptr);
+
 
 
 // Mostly for the menu output
-					Byte*					getBus					();
+					Byte*					getBus					();																	// The memory behind the bus, see Memory::getBus
 
 		const			CPU&					getCPU					()										const;						// Get a constant reference to the cpu
 
@@ -104,26 +217,55 @@ namespace Emu {
 
 					Byte					getCycles				()										const;						// Gets the number of cycles for that instruction and addressing mode  plus branches and pages boundary crossings
 
+					Word					getProgramCounter			()										const;						// Just the program counter, unlike getCPU() it doesn't have to pack the lazy flags
+
+					bool					isPolling				(const Word& addr)							const;						// The program counter is in a two instruction loop that reads addr until bit 7 is set, like the wozmon's key wait
+
+		const			BlockCacheStats&			getBlockCacheStats			()										const;						// Hits, misses and invalidations of the block cache, and blocks the JIT translated
+
+		const			std::bitset<256>&			getDirtyPages				()										const;						// Pages of memory written since clearDirtyPages, by a store or a load through getBus
+
+					bool					isPageDirty				(const Byte& page)							const;
+
+					QWord					clearDirtyPages				();																	// Starts watching for the first write to each page again. Returns the new generation
+
+					QWord					getDirtyGeneration			()										const;						// Goes up by one with every clearDirtyPages
+
+					QWord					getPageGeneration			(const Byte& page)							const;						// The generation the page was last written in, so it changed since clearDirtyPages
+																																	// returned g if this is g or more. Every page starts out dirty in generation 0
+
+		const			std::map<Word, LoopSkipStats>&		getLoopSkipStats			()										const;						// What fast forwarding saved at each delay loop
+
+					void					clearLoopSkipStats			();
+
 
 
 // More so just for debugging right now
-					Byte					fetch					();																	// Used for disassembly. Fetches a single byte from m_bus[m_cpu.p++]
+					Byte					fetch					();																	// Fetches a single byte from m_bus[m_cpu.p++]
 
 					void					setProgramCounter			(const Word& p = USER_PROGRAM);												// explictly sets the program counter
 
+					void					setCPU					(const CPU& cpu);														// Puts every register back, for loading a snapshot
+
+					int					loadRom					(const char* fname,													// Loads text, Intel HEX or binary with RomLoader, see RomLoader.h. A line starting
+															 const Word& addr = USER_PROGRAM,									// with an address (E000: AA 58 E0) goes there, the rest goes at addr
+															 RomLoader::Format format = RomLoader::Format::AUTO);
+
 					int					loadProgram				(const char* fname,													// Loads a text file of hexadecimal machine code
 															 const Word& addr = USER_PROGRAM);
 
-					int					loadProgram2				(const char* fname,													// loads a text file of hexadecimal predicated the address is should be at e.g. E000: AA 58 E0 etc....
+					int					loadProgram2				(const char* fname,													// The same as loadProgram, from when only this one skipped the addresses
 															const Word& addr = USER_PROGRAM);
 
-					int					loadProgramHex				(const char* fname,
+					int					loadProgramHex				(const char* fname,													// Loads a binary rom
 															 const Word& addr = USER_PROGRAM);
 
 					int					denatureHexText				(const char* fname, 
 															 const char* fname_new);											// Takes a text file containing hexadecimal instructions and removing any addresses that may start the line, as well as delimiters and "0x" e.g. E0000: 0xA2, 0x08, 0x5D, ....
 
-					void					disassembleText				(const char* fname);												// Disassembles a text file of machine code in assembly. Saved in a file asm.asm
+					bool					disassembleText				(const char* fname,													// Disassembles a text file of machine code loaded at addr into out, tracing
+															 const char* out = "asm.asm",										// the code from addr and the vectors, see Disassembler.h. False if the file
+															 const Word& addr = USER_PROGRAM)					const;						// doesn't load or out can't be written
 
 	// Output operations
 					void					printMemoryRange			(const size_t& start, 
@@ -138,22 +280,144 @@ namespace Emu {
 			Byte(emu6502::* addr)() = nullptr;				// function pointer to the address mode
 			Byte cycles = 0;						// the amount of the cycles
 		};
+
+		friend class Jit;
+
+		using NativeBlock = QWord(*)(emu6502* cpu, DWord budget);		// translated block, returns the instructions it and the blocks it chained into ran in the low half and their cycles in the high half
+
+		// An instruction decoded by the block cache, with its operand already read out of the instruction stream
+		struct DecodedInstruction
+		{
+			Word pc = 0;							// address of the instruction
+			Word next = 0;							// address of the instruction after it
+			Word operand = 0;						// the operand byte, or both bytes as an address
+			Byte opcode = 0;
+			Byte cycles = 0;						// base cycles
+		};
+
+		// A straight line run of instructions ending at the first one that can change the program counter
+		struct Block
+		{
+			Word entry = 0;
+			Word end = 0;							// address after the last instruction
+			QWord cycles = 0;						// base cycles of the whole block
+			bool valid = false;
+			Block* links[2] = { nullptr, nullptr };				// the blocks this one was last seen to continue into, checked before the hash lookup
+			std::vector<DecodedInstruction> instructions;
+			QWord entries = 0;						// times the block was entered from its start, the JIT only translates the hot ones
+			NativeBlock native = nullptr;				// the JIT's translation, dropped along with the block when its code is written over
+			bool jitTried = false;						// so a block the JIT can't translate isn't tried again on every entry
+			Byte rewrites = 0;						// times the code was written over, kept when it's decoded again. Blocks that keep changing stay interpreted
+		};
 //
 //
 /* Member variables to emu6502 */
 	private:
 		std::vector<Instruction> m_lookup;					// Table of opcodes correctly indexed to their hex value
-		CPU                      m_cpu;						// CPU
+		mutable CPU              m_cpu;						// CPU. Mutable so getCPU() can pack the lazy flags into it
 		Instruction              m_instruction;					// keep track of the current instruction, mostly for the cycles variable but also to check addressing mode for m_addrVal
 		Bits<DWord>		 m_addrVal;					// Used to get the value for the instruction. It is the next byte if it's IMM otherwise it's an address
 		Bits<Byte>		 m_addrRel;					// Used for relative offsets
-		Byte			 m_bus[0xFFFF];					// Memory of size 0xFFFF
+		Memory			 m_memory;					// The 64K bus
 		Address_Mode		 m_lastAddressMode; 				// Keep track of the last address mode used for debugging purposes
+		Byte			 m_opcode;					// The opcode of the last instruction executed, indexes m_lookup for the mnemonic
+		Byte			 m_cycles;					// Cycles used by the last instruction executed, including page crossings and branches
+		bool			 m_lazyFlags;					// When set N, Z, C and V are held in the four bytes below and those bits of m_cpu.flags are stale
+		Byte			 m_flagN;					// Bit 7 is N
+		Byte			 m_flagZ;					// Z is set when this is 0
+		Byte			 m_flagC;					// 0 or 1
+		Byte			 m_flagV;					// Bit 7 is V
+		std::unordered_map<Word, Block> m_blocks;				// Block cache keyed by entry address. Blocks are never erased so pointers to them stay good
+		std::vector<Block*>	 m_codePages[256];				// The cached blocks with code in each page
+		Byte			 m_pageWatch[256];				// WATCH_ bits for each page, a write to an unwatched page is a plain store after checking this
+		bool			 m_mmioWritten;					// Set by a write to a WATCH_IO page, run_cycles and run_until clear it when they start
+		std::vector<bool>	 m_breakpoints;					// Indexed by address, empty until the first breakpoint is set
+		size_t			 m_breakpointCount;
+		Block*			 m_block;					// The block executeCached or the JIT is running
+		const DecodedInstruction* m_decoded;				// The instruction in m_block being executed, or the next one to execute
+		const DecodedInstruction* m_decodedEnd;				// Past m_block's last instruction. The same as m_decoded when a block has to be entered
+		BlockCacheStats		 m_blockStats;
+		std::unique_ptr<Jit>	 m_jit;						// Created the first time the JIT is turned on
+		bool			 m_jitEnabled;
+		QWord			 m_jitThreshold;
+		std::vector<Block*>	 m_blockTable;					// m_blocks by entry address, sized the first time a block is looked up
+		bool			 m_blockEntry;					// The last instruction moved the program counter somewhere else, so a block can start here
+		std::bitset<256>	 m_dirtyPages;
+		std::vector<Byte>	 m_dirtyList;					// the same pages in the order they were dirtied, so a clear only has to visit them
+		QWord			 m_dirtyGeneration;
+		QWord			 m_pageGenerations[256];
+		bool			 m_skipLoops;
+		std::map<Word, LoopSkipStats> m_loopSkips;				// keyed by the address of the loop
+		Trace*			 m_trace;					// recording instructions when it isn't null
+		QWord			 m_traceCycles;					// cycles run since the trace was set
+		Profiler*		 m_profiler;					// counting instructions when it isn't null
+		CallGraph*		 m_callGraph;					// following calls when it isn't null
 
 /* Private helper functions to check the status of flags and clear or set them accordingly */
 	private:
 		void checkFlag(bool condition, const Flags& flag);
 
+/* Batched running, defined in emu6502.cpp */
+	private:
+		static constexpr Byte WATCH_CODE = 0x01;				// m_codePages has blocks for the page
+		static constexpr Byte WATCH_IO	 = 0x02;				// a device page. The JIT leaves every access to it to the interpreter
+		static constexpr Byte WATCH_ROM	 = 0x04;
+		static constexpr Byte WATCH_CLEAN = 0x08;				// not written since clearDirtyPages. The first write marks it dirty and takes this off, the rest are plain stores again
+
+		template<bool CONDITION> RunResult run(QWord budget, const std::function<bool(const emu6502&)>* condition);
+		void skipLoop(RunResult& result, QWord budget);				// Fast forward the delay loop at the program counter, if there's one there
+		size_t observeInstruction();						// fetch_and_execute with the trace, the profiler and the call graph told about it
+		size_t traceInstruction();						// fetch_and_execute recorded into the trace
+		void watchWrite(const Word& addr, const Byte& val);			// The write slow path, for any write to a page in m_pageWatch
+		void markDirty(const Byte& page);
+
+/* Block cache, defined in emu6502Blocks.cpp */
+	private:
+		void decodeBlock(Block& block, const Word& entry);			// Decodes the instructions starting at entry into block
+		void enterBlock();							// Points m_block and m_decoded at the block for the program counter, through the last block's links if it can
+		Block& lookupBlock(const Word& entry);					// The block starting at entry, made but not decoded the first time
+		void leaveBlock();							// The program counter was moved from outside the cores, look the block up again before the next instruction
+		void invalidateBlock(Block& block);
+		void invalidateWrite(const Word& addr);				// A byte was written to a page with cached code, throw away the blocks containing it
+
+/* Lazy flags, defined in emu6502Core.cpp */
+	private:
+		Byte packFlags() const;						// The status register as it would be if the flags were kept eagerly
+		void syncFlags() const;						// Packs the lazy flags into m_cpu.flags, they stay lazy
+		void flushFlags();						// Packs the lazy flags into m_cpu.flags and goes back to eager flags, for code that changes m_cpu.flags directly
+		void loadFlags();						// Unpacks m_cpu.flags into the lazy flags
+
+/* Switch core helpers, defined in emu6502Core.cpp */
+// The addressing helpers return the effective address but leave m_addrVal exactly as the addressing mode functions would
+	private:
+		template<bool DECODED> Byte operandByte();
+		template<bool DECODED> Word operandWord();
+		Byte fetchImmediate(Byte val);
+		Word fetchZeroPage(Byte zp);
+		Word fetchZeroPageIndexed(Byte zp, Byte index);
+		Word fetchAbsolute(Word addr);
+		Word fetchAbsoluteIndexed(Word base, Byte index);
+		Word fetchIndirect(Word ptr);
+		Word fetchIndirectX(Byte ptr);
+		Word fetchIndirectY(Byte ptr);
+		Byte readOperand(Word addr);
+		void write(Word addr, Byte val);
+		void push(Byte val);
+		Byte pull();
+		void setNZ(Byte val);
+		void setCarry(bool condition);
+		void setOverflow(Byte val);
+		Byte carry() const;
+		template<Byte Mask> bool flag() const;
+		void branch(bool condition, Byte rel);
+		void adc(Byte val);
+		void sbc(Byte val);
+		void compare(Byte reg, Byte val);
+		template<Address_Mode Mode, bool DECODED> Word effectiveAddress();
+		template<Address_Mode Mode, bool DECODED> Byte operand();
+		template<Operation Op, Address_Mode Mode> void modify(Byte& val);
+		template<Operation Op, Address_Mode Mode, Access ACCESS, bool DECODED = false> void handler();
+
 /* CPU Addressing modes */
 // Addressing functions will load m_addrVal (or m_addrRel for branches) with the correct value for processing for the instruction
 	private:
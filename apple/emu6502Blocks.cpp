@@ -0,0 +1,279 @@
+#include "emu6502.h"
+#include "Jit.h"
+#include <algorithm>
+
+using namespace Emu;
+
+/*			START
+* block cache */
+
+// The block cache decodes a straight line run of instructions the first time the program counter lands on it and keeps the opcode,
+// operand and cycles of each one, so running it again skips reading and decoding the instruction stream. A block ends at the first
+// instruction that can move the program counter somewhere else. When a block finishes, the block it continued into is remembered in its
+// links so the next time round it can be entered without looking it up.
+// executeCached (in emu6502Core.cpp) runs them through the switch core's handlers, reading the operand from the decoded instruction
+// instead, so the cached core behaves exactly like the other two. The JIT translates the same blocks. Anything that writes over cached
+// code throws the blocks away and they get decoded again when they next run.
+
+namespace
+{
+	const Byte JIT_REWRITE_LIMIT = 4;
+
+	constexpr bool endsBlock(Operation op)
+	{
+		switch (op)
+		{
+		case Operation::BCC: case Operation::BCS: case Operation::BEQ: case Operation::BMI:
+		case Operation::BNE: case Operation::BPL: case Operation::BVC: case Operation::BVS:
+		case Operation::JMP: case Operation::JSR: case Operation::RTS: case Operation::RTI:
+		case Operation::BRK:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// endsBlock for every opcode, looked up after each instruction the JIT leaves to the interpreter
+	const struct TransferTable
+	{
+		bool ends[256];
+
+		constexpr TransferTable() : ends()
+		{
+			for (int i = 0; i < 256; ++i) ends[i] = endsBlock(OPCODES[i].operation);
+		}
+
+		constexpr bool operator[](Byte opcode) const { return ends[opcode]; }
+	} TRANSFERS;
+
+	// The block holds the bytes from its entry up to but not including its end, which can wrap around the top of memory
+	inline bool blockContains(const Word& entry, const Word& end, const Word& addr)
+	{
+		return Word(addr - entry) < Word(end - entry);
+	}
+}
+
+// Blocks only start where the program counter was moved somewhere else, so that's the only time one is looked up. A translated block goes
+// straight on into the next translated one until budget cycles have gone by, so a loop that stays in translated code is only called into
+// once. Code the JIT hasn't translated, which includes every store to a device like the display, runs one instruction at a time on the
+// switch core for the caller to see, and all it pays for the JIT being on is a look at whether the instruction could have moved the
+// program counter
+RunResult emu6502::executeBlock(QWord budget)
+{
+#ifndef EMU_EAGER_FLAGS
+	if (m_jitEnabled and m_blockEntry)
+	{
+		if (!m_lazyFlags) loadFlags();
+
+		const Word entry = m_cpu.p.getCopy();
+		Block& block = lookupBlock(entry);
+		if (block.native == nullptr and block.rewrites < JIT_REWRITE_LIMIT and ++block.entries >= m_jitThreshold)
+		{
+			if (!block.valid) decodeBlock(block, entry);
+			if (!block.jitTried and m_jit->compile(*this, block)) ++m_blockStats.compiled;
+		}
+
+		// The translation stops short of the first instruction it can't do and can back out before any instruction that turns out to
+		// touch a device, the rest of the block carries on in the interpreter up to the next jump
+		if (block.native != nullptr)
+		{
+			m_block = &block;
+			QWord result = block.native(this, static_cast<DWord>(std::min<QWord>(budget, 0xFFFFFFFF)));
+			QWord instructions = result & 0xFFFFFFFF;
+			if (instructions != 0)							// the translated code has set m_blockEntry
+			{
+				m_decoded = m_decodedEnd = nullptr;
+				return { result >> 32, instructions };
+			}
+		}
+	}
+	const size_t cycles = executeSwitch();
+	m_decoded = m_decodedEnd = nullptr;
+	m_blockEntry = TRANSFERS[m_opcode];
+	return { cycles, 1 };
+#else
+	return { executeCached(), 1 };
+#endif
+}
+
+bool emu6502::setJit(bool enabled, QWord threshold)
+{
+	m_jitThreshold = threshold;
+	m_jitEnabled = false;
+	leaveBlock();													// the interpreters don't keep m_blockEntry up to date
+#ifndef EMU_EAGER_FLAGS
+	if (enabled)
+	{
+		if (!m_jit) m_jit.reset(new Jit());
+		m_jitEnabled = m_jit->ready();
+	}
+#endif
+	return m_jitEnabled == enabled;
+}
+
+bool emu6502::getJit() const
+{
+	return m_jitEnabled;
+}
+
+// Only a block that ran to its end gets linked to the one it continued into. A link is only a guess at where the block goes, it's taken
+// when the block it points at starts at the program counter
+void emu6502::enterBlock()
+{
+	const Word pc = m_cpu.p.getCopy();
+	Block* from = m_decodedEnd != nullptr and m_decoded == m_decodedEnd ? m_block : nullptr;
+	Block* next = nullptr;
+
+	if (from != nullptr)
+		for (Block* link : from->links)
+			if (link != nullptr and link->entry == pc)
+			{
+				next = link;
+				break;
+			}
+
+	if (next == nullptr)
+	{
+		next = &lookupBlock(pc);
+		if (from != nullptr) from->links[pc == from->end ? 0 : 1] = next;
+	}
+
+	if (next->valid)
+		++m_blockStats.hits;
+	else
+		decodeBlock(*next, pc);
+
+	++next->entries;
+	m_block = next;
+	m_decoded = next->instructions.data();
+	m_decodedEnd = m_decoded + next->instructions.size();
+}
+
+// The table is only made once it's needed, most machines never run the cached core or the JIT
+emu6502::Block& emu6502::lookupBlock(const Word& entry)
+{
+	if (m_blockTable.empty()) m_blockTable.resize(0x10000, nullptr);
+	Block*& block = m_blockTable[entry];
+	if (block == nullptr)
+	{
+		block = &m_blocks[entry];
+		block->entry = entry;
+	}
+	return *block;
+}
+
+void emu6502::leaveBlock()
+{
+	m_blockEntry = true;
+	m_decoded = m_decodedEnd = nullptr;
+}
+
+void emu6502::decodeBlock(Block& block, const Word& entry)
+{
+	++m_blockStats.misses;
+	if (&block == m_block) m_decoded = m_decodedEnd = nullptr;		// the instructions are about to move
+
+	block.entry = entry;
+	block.cycles = 0;
+	block.instructions.clear();
+	block.entries = 0;
+	block.native = nullptr;
+	block.jitTried = false;
+	Word pc = entry;
+
+	for (size_t i = 0; i < BLOCK_MAX_INSTRUCTIONS; ++i)
+	{
+		DecodedInstruction instruction;
+		instruction.pc = pc;
+		instruction.opcode = m_memory.fetch(pc);
+		const OpcodeInfo& info = OPCODES[instruction.opcode];
+
+		instruction.cycles = info.cycles;
+		switch (operandBytes(info.mode))
+		{
+		case 1: instruction.operand = m_memory.fetch(Word(pc + 1)); break;
+		case 2: instruction.operand = Word(m_memory.fetch(Word(pc + 1)) | (m_memory.fetch(Word(pc + 2)) << 8)); break;
+		}
+		pc = Word(pc + 1 + operandBytes(info.mode));
+		instruction.next = pc;
+
+		block.cycles += instruction.cycles;
+		block.instructions.push_back(instruction);
+		if (endsBlock(info.operation)) break;
+	}
+
+	block.end = pc;
+	block.valid = true;
+
+	// A block is at most a few pages long so register it with each one it has code in
+	Byte last = Word(block.end - 1) >> 8;
+	for (Byte page = entry >> 8; ; ++page)
+	{
+		m_codePages[page].push_back(&block);
+		m_pageWatch[page] |= WATCH_CODE;
+		if (page == last) break;
+	}
+}
+
+void emu6502::invalidateBlock(Block& block)
+{
+	block.valid = false;
+	block.native = nullptr;
+	block.entries = 0;
+	if (block.rewrites < 0xFF) ++block.rewrites;
+	++m_blockStats.invalidations;
+
+	Byte last = Word(block.end - 1) >> 8;
+	for (Byte page = block.entry >> 8; ; ++page)
+	{
+		std::vector<Block*>& blocks = m_codePages[page];
+		for (size_t i = 0; i < blocks.size(); ++i)
+			if (blocks[i] == &block)
+			{
+				blocks[i] = blocks.back();
+				blocks.pop_back();
+				break;
+			}
+		if (blocks.empty()) m_pageWatch[page] &= ~WATCH_CODE;
+		if (page == last) break;
+	}
+}
+
+// invalidateBlock takes the block out of this page's list, so only move on when the block is kept
+void emu6502::invalidateWrite(const Word& addr)
+{
+	std::vector<Block*>& blocks = m_codePages[addr >> 8];
+	for (size_t i = 0; i < blocks.size(); )
+	{
+		if (blockContains(blocks[i]->entry, blocks[i]->end, addr))
+			invalidateBlock(*blocks[i]);
+		else
+			++i;
+	}
+}
+
+void emu6502::invalidateBlocks(const Word& start, const Word& end)
+{
+	for (size_t page = start >> 8; page <= static_cast<size_t>(end >> 8); ++page)
+	{
+		if (!(m_pageWatch[page] & WATCH_IO)) markDirty(static_cast<Byte>(page));
+
+		std::vector<Block*>& blocks = m_codePages[page];
+		for (size_t i = 0; i < blocks.size(); )
+		{
+			const Block& block = *blocks[i];
+			if (blockContains(block.entry, block.end, start) or (block.entry >= start and block.entry <= end))
+				invalidateBlock(*blocks[i]);
+			else
+				++i;
+		}
+	}
+}
+
+const BlockCacheStats& emu6502::getBlockCacheStats() const
+{
+	return m_blockStats;
+}
+
+/*			END
+* block cache */
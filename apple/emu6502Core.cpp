@@ -0,0 +1,572 @@
+#include "emu6502.h"
+
+using namespace Emu;
+
+/*			START
+* switch core */
+
+// The switch core does the same work as the lookup core but dispatches on the opcode byte directly. The compiler turns the switch into
+// a single jump table and each case is a handler template instantiated from the opcode table, so there's no Instruction copy, no member
+// function pointer calls and no runtime checks of the addressing mode.
+// Every quirk of the lookup core is kept on purpose, both cores have to leave the cpu, the bus, m_addrVal and the cycles in the same state.
+
+namespace
+{
+	constexpr Byte CARRY_BIT    = BIT_VALUE(Flags::CARRY);
+	constexpr Byte ZERO_BIT     = BIT_VALUE(Flags::ZERO);
+	constexpr Byte INTERRUPT_BIT = BIT_VALUE(Flags::INTERRUPT_DISABLE);
+	constexpr Byte DECIMAL_BIT  = BIT_VALUE(Flags::DECIMALE_MODE);
+	constexpr Byte BREAK_BIT    = BIT_VALUE(Flags::BREAK);
+	constexpr Byte O_FLOW_BIT   = BIT_VALUE(Flags::O_FLOW);
+	constexpr Byte NEGATIVE_BIT = BIT_VALUE(Flags::NEGATIVE);
+
+	// If the condition is met the bit is set, otherwise it's cleared. Same as checkFlag but takes the mask so it folds to a couple of instructions
+	inline void setFlag(Byte& flags, Byte mask, bool condition)
+	{
+		flags = condition ? (flags | mask) : (flags & ~mask);
+	}
+}
+
+// The operand bytes either come from the instruction stream, moving the program counter past them, or from the block cache where they
+// were read when the block was decoded and the program counter has already been moved past the instruction
+template<bool DECODED>
+inline Byte emu6502::operandByte()
+{
+	if constexpr (DECODED)
+		return static_cast<Byte>(m_decoded->operand);
+	else
+		return m_memory.fetch(m_cpu.p++);
+}
+
+template<bool DECODED>
+inline Word emu6502::operandWord()
+{
+	if constexpr (DECODED)
+		return m_decoded->operand;
+	else
+	{
+		Word lo = m_memory.fetch(m_cpu.p++);
+		Word hi = m_memory.fetch(m_cpu.p++);
+		return Word((hi << 8) | lo);
+	}
+}
+
+// Immediate, the operand is the value
+inline Byte emu6502::fetchImmediate(Byte val)
+{
+	m_addrVal = val;
+	return val;
+}
+
+inline Word emu6502::fetchZeroPage(Byte zp)
+{
+	m_addrVal = zp;
+	return zp;
+}
+
+// Like ZPX and ZPY the sum is not wrapped to the zero page
+inline Word emu6502::fetchZeroPageIndexed(Byte zp, Byte index)
+{
+	DWord addr = zp + index;
+	m_addrVal = addr;
+	return static_cast<Word>(addr);
+}
+
+inline Word emu6502::fetchAbsolute(Word addr)
+{
+	m_addrVal = addr;
+	return addr;
+}
+
+// +1 cycle when the index crosses a page
+inline Word emu6502::fetchAbsoluteIndexed(Word base, Byte index)
+{
+	DWord addr = base + static_cast<Word>(index);
+	m_addrVal = addr;
+	if ((addr & 0xFF00) != static_cast<DWord>(base & 0xFF00)) ++m_cycles;
+	return static_cast<Word>(addr);
+}
+
+// JMP only, including the page boundary hardware bug
+inline Word emu6502::fetchIndirect(Word ptr)
+{
+	Word addr;
+
+	if ((ptr & 0xFF) == 0xFF)
+		addr = static_cast<Word>((m_memory.read(ptr & 0xFF00) << 8) | m_memory.read(ptr));
+	else
+		addr = static_cast<Word>((m_memory.read(ptr + 1) << 8) | m_memory.read(ptr));
+
+	m_addrVal = addr;
+	return addr;
+}
+
+inline Word emu6502::fetchIndirectX(Byte ptr)
+{
+	Byte x = m_cpu.x.getCopy();
+	Byte lo = m_memory.read((ptr + x) & 0xFF);
+	Byte hi = m_memory.read((ptr + x + 1) & 0xFF);
+	Word addr = Word((hi << 8) | lo);
+	m_addrVal = addr;
+	return addr;
+}
+
+inline Word emu6502::fetchIndirectY(Byte ptr)
+{
+	Byte lo = m_memory.read(ptr);
+	Byte hi = m_memory.read(static_cast<Word>(ptr + 1));
+	DWord addr = Word((hi << 8) | lo) + m_cpu.y.getCopy();
+	m_addrVal = addr;
+	if ((addr & 0xFF00) != static_cast<DWord>(hi << 8)) ++m_cycles;
+	return static_cast<Word>(addr);
+}
+
+// Instructions that read memory replace m_addrVal with the value read
+inline Byte emu6502::readOperand(Word addr)
+{
+	Byte val = m_memory.read(addr);
+	m_addrVal = val;
+	return val;
+}
+
+// Every store goes through here. An unwatched page is ram without cached code so the store goes straight to memory, anything else
+// (code to invalidate, rom or a device) takes the slow path
+inline void emu6502::write(Word addr, Byte val)
+{
+	if (m_pageWatch[addr >> 8]) watchWrite(addr, val);
+	else m_memory.getBus()[addr] = val;
+}
+
+inline void emu6502::push(Byte val)
+{
+	write(m_cpu.s--, val);
+}
+
+inline Byte emu6502::pull()
+{
+	return m_memory.read(++m_cpu.s);
+}
+
+/*			START
+* lazy flags */
+
+// Nearly every N and Z result is overwritten by the next instruction before anything looks at it, so instead of updating m_cpu.flags the
+// switch core stores the result and the carry/overflow inputs and works the flags out when they're asked for. I, D, B and the unused bit
+// are still kept in m_cpu.flags. The lookup core, irq and nmi all change m_cpu.flags directly so they flush the lazy flags first
+
+Byte emu6502::packFlags() const
+{
+	if (!m_lazyFlags) return m_cpu.flags.getCopy();
+
+	return	(m_cpu.flags.getCopy() & ~(NEGATIVE_BIT | ZERO_BIT | O_FLOW_BIT | CARRY_BIT))
+			| (m_flagN & NEGATIVE_BIT) | (m_flagZ == 0 ? ZERO_BIT : 0) | ((m_flagV & 0x80) >> 1) | m_flagC;
+}
+
+void emu6502::syncFlags() const
+{
+	if (m_lazyFlags) m_cpu.flags = packFlags();
+}
+
+void emu6502::flushFlags()
+{
+	syncFlags();
+	m_lazyFlags = false;
+}
+
+void emu6502::loadFlags()
+{
+#ifndef EMU_EAGER_FLAGS
+	Byte flags = m_cpu.flags.getCopy();
+	m_flagN = flags;
+	m_flagZ = (flags & ZERO_BIT) ? 0 : 1;
+	m_flagC = flags & CARRY_BIT;
+	m_flagV = flags << 1;
+	m_lazyFlags = true;
+#endif
+}
+
+inline void emu6502::setNZ(Byte val)
+{
+#ifdef EMU_EAGER_FLAGS
+	Byte& flags = m_cpu.flags.get();
+	flags = (flags & ~(NEGATIVE_BIT | ZERO_BIT)) | (val & NEGATIVE_BIT) | (val == 0 ? ZERO_BIT : 0);
+#else
+	m_flagN = m_flagZ = val;
+#endif
+}
+
+inline void emu6502::setCarry(bool condition)
+{
+#ifdef EMU_EAGER_FLAGS
+	setFlag(m_cpu.flags.get(), CARRY_BIT, condition);
+#else
+	m_flagC = condition;
+#endif
+}
+
+// V is bit 7 of val
+inline void emu6502::setOverflow(Byte val)
+{
+#ifdef EMU_EAGER_FLAGS
+	setFlag(m_cpu.flags.get(), O_FLOW_BIT, val & 0x80);
+#else
+	m_flagV = val;
+#endif
+}
+
+inline Byte emu6502::carry() const
+{
+#ifdef EMU_EAGER_FLAGS
+	return m_cpu.flags.getCopy() & CARRY_BIT;
+#else
+	return m_flagC;
+#endif
+}
+
+// Tests a single flag for the branches without packing the rest
+template<Byte Mask>
+inline bool emu6502::flag() const
+{
+#ifndef EMU_EAGER_FLAGS
+	if constexpr (Mask == NEGATIVE_BIT) return m_flagN & 0x80;
+	else if constexpr (Mask == ZERO_BIT) return m_flagZ == 0;
+	else if constexpr (Mask == O_FLOW_BIT) return m_flagV & 0x80;
+	else if constexpr (Mask == CARRY_BIT) return m_flagC;
+	else
+#endif
+	return m_cpu.flags.getCopy() & Mask;
+}
+
+/*			END
+* lazy flags */
+
+// +1 cycle for a successful branch
+inline void emu6502::branch(bool condition, Byte rel)
+{
+	m_addrRel = rel;
+	m_addrVal = rel;
+	if (condition)
+	{
+		++m_cycles;
+		m_cpu.p = m_cpu.p.getCopy() + static_cast<S_Byte>(rel);
+	}
+}
+
+inline void emu6502::adc(Byte val)
+{
+	Byte& a = m_cpu.a.get();
+	Word result = 0;
+
+	if (m_cpu.flags.getCopy() & DECIMAL_BIT)
+	{
+		Byte loSum = (a & 0x0F) + (val & 0x0F) + carry();
+		if (loSum > 9) loSum = ((loSum + 6) & 0x0F) + 0x10;
+
+		Byte hiSum = ((a & 0xF0) >> 4) + ((val & 0xF0) >> 4) + ((loSum & 0x10) >> 4);
+		if (hiSum > 9) hiSum = ((hiSum + 6) & 0x0F) + 0x10;
+
+		result = (hiSum << 4) | (loSum & 0x0F);
+	}
+	else
+		result = a + val + carry();
+
+	setOverflow(~(a ^ val) & (a ^ result));
+	a = result & 0xFF;
+	setCarry(result > 255);
+	setNZ(a);
+}
+
+// Same as adc once the operand is inverted, there is no decimal mode
+inline void emu6502::sbc(Byte val)
+{
+	Byte& a = m_cpu.a.get();
+
+	val ^= 0xFF;
+	m_addrVal = val;
+
+	Word result = a + val + carry();
+	setOverflow(~(a ^ val) & (a ^ result));
+	a = result & 0xFF;
+	setNZ(a);
+	setCarry(result & 0xFF00);
+}
+
+inline void emu6502::compare(Byte reg, Byte val)
+{
+	setCarry(reg >= val);
+	setNZ(static_cast<Byte>(reg - val));
+}
+
+// Operand address for every mode that has one. Implied only gets here for the undefined implied SBC, which reads from whatever m_addrVal
+// was left at by the previous instruction, same as the lookup core
+template<Address_Mode Mode, bool DECODED>
+inline Word emu6502::effectiveAddress()
+{
+	if constexpr (Mode == Address_Mode::ZP0) return fetchZeroPage(operandByte<DECODED>());
+	else if constexpr (Mode == Address_Mode::ZPX) return fetchZeroPageIndexed(operandByte<DECODED>(), m_cpu.x.getCopy());
+	else if constexpr (Mode == Address_Mode::ZPY) return fetchZeroPageIndexed(operandByte<DECODED>(), m_cpu.y.getCopy());
+	else if constexpr (Mode == Address_Mode::ABS) return fetchAbsolute(operandWord<DECODED>());
+	else if constexpr (Mode == Address_Mode::ABX) return fetchAbsoluteIndexed(operandWord<DECODED>(), m_cpu.x.getCopy());
+	else if constexpr (Mode == Address_Mode::ABY) return fetchAbsoluteIndexed(operandWord<DECODED>(), m_cpu.y.getCopy());
+	else if constexpr (Mode == Address_Mode::IND) return fetchIndirect(operandWord<DECODED>());
+	else if constexpr (Mode == Address_Mode::IZX) return fetchIndirectX(operandByte<DECODED>());
+	else if constexpr (Mode == Address_Mode::IZY) return fetchIndirectY(operandByte<DECODED>());
+	else
+	{
+		static_assert(Mode == Address_Mode::IMP, "immediate and relative operands aren't addresses");
+		return static_cast<Word>(m_addrVal.getCopy());
+	}
+}
+
+// The value a READ instruction works on, decided at compile time instead of comparing the addressing mode function against &emu6502::IMM
+template<Address_Mode Mode, bool DECODED>
+inline Byte emu6502::operand()
+{
+	if constexpr (Mode == Address_Mode::IMM)
+		return fetchImmediate(operandByte<DECODED>());
+	else
+		return readOperand(effectiveAddress<Mode, DECODED>());
+}
+
+// Shifts, rotates, increments and decrements on the accumulator or memory
+template<Operation Op, Address_Mode Mode>
+inline void emu6502::modify(Byte& val)
+{
+	Byte oldCarry = carry();
+
+	if constexpr (Op == Operation::ASL)
+	{
+		setCarry(val & 0x80);
+		val <<= 1;
+	}
+	else if constexpr (Op == Operation::LSR)
+	{
+		setCarry(val & 0x01);
+		val >>= 1;
+	}
+	else if constexpr (Op == Operation::ROL)
+	{
+		setCarry(val & 0x80);
+		val = (val << 1) | oldCarry;
+	}
+	else if constexpr (Op == Operation::ROR)
+	{
+		setCarry(val & 0x01);
+		val >>= 1;
+		if constexpr (Mode != Address_Mode::IMP)			// The lookup core's accumulator ROR never rotates the carry into bit 7, keep it that way
+			val |= oldCarry ? 0x80 : 0x00;
+	}
+	else if constexpr (Op == Operation::INC) ++val;
+	else if constexpr (Op == Operation::DEC) --val;
+
+	setNZ(val);
+}
+
+// One handler is instantiated per opcode. The operand fetch, the page crossing cycle and which flags change are all known at compile time
+template<Operation Op, Address_Mode Mode, Access ACCESS, bool DECODED>
+inline void emu6502::handler()
+{
+	Byte& a = m_cpu.a.get();
+	Byte& x = m_cpu.x.get();
+	Byte& y = m_cpu.y.get();
+	Byte& flags = m_cpu.flags.get();
+
+	if constexpr (ACCESS == Access::READ)
+	{
+		if constexpr (Op == Operation::BIT)					// BIT doesn't replace m_addrVal
+		{
+			Byte val = m_memory.read(effectiveAddress<Mode, DECODED>());
+#ifdef EMU_EAGER_FLAGS
+			setFlag(flags, ZERO_BIT, (a & val) == 0);
+			setFlag(flags, NEGATIVE_BIT, val & NEGATIVE_BIT);
+			setFlag(flags, O_FLOW_BIT, val & O_FLOW_BIT);
+#else
+			m_flagZ = a & val;
+			m_flagN = val;
+			m_flagV = val << 1;
+#endif
+		}
+		else
+		{
+			Byte val = operand<Mode, DECODED>();
+			if constexpr (Op == Operation::LDA) { a = val; setNZ(a); }
+			else if constexpr (Op == Operation::LDX) { x = val; setNZ(x); }
+			else if constexpr (Op == Operation::LDY) { y = val; setNZ(y); }
+			else if constexpr (Op == Operation::AND) { a &= val; setNZ(a); }
+			else if constexpr (Op == Operation::ORA) { a |= val; setNZ(a); }
+			else if constexpr (Op == Operation::EOR) { a ^= val; setNZ(a); }
+			else if constexpr (Op == Operation::ADC) adc(val);
+			else if constexpr (Op == Operation::SBC) sbc(val);
+			else if constexpr (Op == Operation::CMP) compare(a, val);
+			else if constexpr (Op == Operation::CPX) compare(x, val);
+			else if constexpr (Op == Operation::CPY) compare(y, val);
+		}
+	}
+	else if constexpr (ACCESS == Access::WRITE)
+	{
+		Word addr = effectiveAddress<Mode, DECODED>();
+		if constexpr (Op == Operation::STA) write(addr, a);
+		else if constexpr (Op == Operation::STX) write(addr, x);
+		else if constexpr (Op == Operation::STY) write(addr, y);
+	}
+	else if constexpr (ACCESS == Access::RMW)
+	{
+		if constexpr (Mode == Address_Mode::IMP)
+			modify<Op, Mode>(a);
+		else
+		{
+			Word addr = effectiveAddress<Mode, DECODED>();
+			Byte val = m_memory.read(addr);
+			modify<Op, Mode>(val);
+			write(addr, val);
+		}
+	}
+	// Branches
+	else if constexpr (Op == Operation::BPL) branch(!flag<NEGATIVE_BIT>(), operandByte<DECODED>());
+	else if constexpr (Op == Operation::BMI) branch(flag<NEGATIVE_BIT>(), operandByte<DECODED>());
+	else if constexpr (Op == Operation::BVC) branch(!flag<O_FLOW_BIT>(), operandByte<DECODED>());
+	else if constexpr (Op == Operation::BVS) branch(flag<O_FLOW_BIT>(), operandByte<DECODED>());
+	else if constexpr (Op == Operation::BCC) branch(!flag<CARRY_BIT>(), operandByte<DECODED>());
+	else if constexpr (Op == Operation::BCS) branch(flag<CARRY_BIT>(), operandByte<DECODED>());
+	else if constexpr (Op == Operation::BNE) branch(!flag<ZERO_BIT>(), operandByte<DECODED>());
+	else if constexpr (Op == Operation::BEQ) branch(flag<ZERO_BIT>(), operandByte<DECODED>());
+	// Jumps and subroutines
+	else if constexpr (Op == Operation::JMP) m_cpu.p = effectiveAddress<Mode, DECODED>();
+	else if constexpr (Op == Operation::JSR)
+	{
+		Word addr = effectiveAddress<Mode, DECODED>();
+		push(Byte(m_cpu.p.getCopy() >> 8));
+		push(Byte(m_cpu.p.getCopy() & 0xFF));
+		m_cpu.p = addr;
+	}
+	else if constexpr (Op == Operation::RTS or Op == Operation::RTI)
+	{
+		if constexpr (Op == Operation::RTI) { flags = pull(); loadFlags(); }
+		Byte lo = pull();
+		Byte hi = pull();
+		m_cpu.p = Word((hi << 8) | lo);
+	}
+	else if constexpr (Op == Operation::BRK)
+	{
+		fetchImmediate(operandByte<DECODED>());
+		push(static_cast<Byte>(m_cpu.p.getCopy() >> 8));
+		push(static_cast<Byte>(m_cpu.p.getCopy() & 0xFF));
+		push(packFlags() | BREAK_BIT);
+		flags &= ~BREAK_BIT;
+		m_cpu.p = Word(m_memory.read(IRQ_VECTOR + 1) | m_memory.read(IRQ_VECTOR));
+	}
+	// Stack. PLA doesn't set flags and TSX/TXS go through the stack memory, same as the lookup core
+	else if constexpr (Op == Operation::PHA) push(a);
+	else if constexpr (Op == Operation::PHP) push(packFlags());
+	else if constexpr (Op == Operation::PLA) a = pull();
+	else if constexpr (Op == Operation::PLP) { flags = pull(); loadFlags(); }
+	else if constexpr (Op == Operation::TSX) { x = pull(); setNZ(x); }
+	else if constexpr (Op == Operation::TXS) push(x);
+	// Transfers
+	else if constexpr (Op == Operation::TAX) { x = a; setNZ(x); }
+	else if constexpr (Op == Operation::TXA) { a = x; setNZ(a); }
+	else if constexpr (Op == Operation::TAY) { y = a; setNZ(y); }
+	else if constexpr (Op == Operation::TYA) { a = y; setNZ(a); }
+	else if constexpr (Op == Operation::INX) setNZ(++x);
+	else if constexpr (Op == Operation::DEX) setNZ(--x);
+	else if constexpr (Op == Operation::INY) setNZ(++y);
+	else if constexpr (Op == Operation::DEY) setNZ(--y);
+	// Flags
+	else if constexpr (Op == Operation::CLC) setCarry(false);
+	else if constexpr (Op == Operation::SEC) setCarry(true);
+	else if constexpr (Op == Operation::CLI) flags &= ~INTERRUPT_BIT;
+	else if constexpr (Op == Operation::SEI) flags |= INTERRUPT_BIT;
+	else if constexpr (Op == Operation::CLV) setOverflow(0);
+	else if constexpr (Op == Operation::CLD) flags &= ~DECIMAL_BIT;
+	else if constexpr (Op == Operation::SED) flags |= DECIMAL_BIT;
+	// NOP and every undefined opcode only use up cycles
+	else static_assert(Op == Operation::NOP or Op == Operation::XXX, "unhandled operation");
+}
+
+// Each case sets the base cycles and calls the handler instantiated from that opcode's entry in the table, so the switch is generated
+// from OPCODES and can't drift from it. The cached core's switch is made the same way
+#define OPCODE_CASE(n)		case n: m_cycles = OPCODES[n].cycles; handler<OPCODES[n].operation, OPCODES[n].mode, OPCODES[n].access>(); break;
+#define DECODED_CASE(n)		case n: m_cycles = OPCODES[n].cycles; handler<OPCODES[n].operation, OPCODES[n].mode, OPCODES[n].access, true>(); break;
+#define OPCODE_ROW(X, n)	X(n + 0x0) X(n + 0x1) X(n + 0x2) X(n + 0x3) X(n + 0x4) X(n + 0x5) X(n + 0x6) X(n + 0x7) \
+							X(n + 0x8) X(n + 0x9) X(n + 0xA) X(n + 0xB) X(n + 0xC) X(n + 0xD) X(n + 0xE) X(n + 0xF)
+#define OPCODE_TABLE(X)		OPCODE_ROW(X, 0x00) OPCODE_ROW(X, 0x10) OPCODE_ROW(X, 0x20) OPCODE_ROW(X, 0x30) \
+							OPCODE_ROW(X, 0x40) OPCODE_ROW(X, 0x50) OPCODE_ROW(X, 0x60) OPCODE_ROW(X, 0x70) \
+							OPCODE_ROW(X, 0x80) OPCODE_ROW(X, 0x90) OPCODE_ROW(X, 0xA0) OPCODE_ROW(X, 0xB0) \
+							OPCODE_ROW(X, 0xC0) OPCODE_ROW(X, 0xD0) OPCODE_ROW(X, 0xE0) OPCODE_ROW(X, 0xF0)
+
+size_t emu6502::executeSwitch()
+{
+#ifndef EMU_EAGER_FLAGS
+	if (!m_lazyFlags) loadFlags();
+#endif
+	m_opcode = m_memory.fetch(m_cpu.p++);
+
+	switch (m_opcode)
+	{
+		OPCODE_TABLE(OPCODE_CASE)
+	}
+
+	return m_cycles;
+}
+
+// The instruction comes out of the block it was decoded into, with its operand already read and the program counter moved past it in one
+// go. A block is run until its end or until something writes over it, then the next one is entered through its links
+size_t emu6502::executeCached()
+{
+#ifndef EMU_EAGER_FLAGS
+	if (!m_lazyFlags) loadFlags();
+#endif
+	if (m_decoded == m_decodedEnd or !m_block->valid) enterBlock();
+
+	const DecodedInstruction* instruction = m_decoded;
+	m_opcode = instruction->opcode;
+	m_cpu.p = instruction->next;
+	switch (m_opcode)
+	{
+		OPCODE_TABLE(DECODED_CASE)
+	}
+	m_decoded = instruction + 1;
+
+	return m_cycles;
+}
+
+// The same again a block at a time, going straight on into the next block until the budget is used up. It stops early where run has
+// something to look at: a BRK, a store to a device and a BNE back to a loop that could be skipped
+RunResult emu6502::executeCachedBlocks(QWord budget)
+{
+#ifndef EMU_EAGER_FLAGS
+	if (!m_lazyFlags) loadFlags();
+#endif
+	QWord cycles = 0, instructions = 0;
+	m_mmioWritten = false;
+	do
+	{
+		if (m_decoded == m_decodedEnd or !m_block->valid) enterBlock();
+
+		const Block& block = *m_block;
+		const DecodedInstruction* end = m_decodedEnd;
+		do
+		{
+			const DecodedInstruction* instruction = m_decoded;
+			m_opcode = instruction->opcode;
+			m_cpu.p = instruction->next;
+			switch (m_opcode)
+			{
+				OPCODE_TABLE(DECODED_CASE)
+			}
+			m_decoded = instruction + 1;
+			cycles += m_cycles;
+			++instructions;
+		} while (m_decoded != end and block.valid and !m_mmioWritten);
+
+		if (m_mmioWritten or m_opcode == 0x00) break;
+		if (m_opcode == 0xD0 and m_skipLoops and Word(m_decoded[-1].pc - m_cpu.p.getCopy()) <= 6) break;
+	} while (cycles < budget);
+
+	return { cycles, instructions };
+}
+
+#undef OPCODE_TABLE
+#undef OPCODE_ROW
+#undef DECODED_CASE
+#undef OPCODE_CASE
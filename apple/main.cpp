@@ -1,10 +1,24 @@
 #include "Apple1.h"
+#include "Benchmark.h"
+#include "Disassembler.h"
+#include "Headless.h"
+#include "Trace.h"
 #include "smart_pointer.h"
+#include <string>
 
-int main()
+int main(int argc, char* argv[])
 {
-	Ptr<Emu::Apple1> computer(new Emu::Apple1());
+	if (argc > 1 and std::string(argv[1]) == "--bench")
+		return Emu::Benchmark::run(argc - 2, argv + 2);
+	if (argc > 1 and std::string(argv[1]) == "--headless")
+		return Emu::Headless::run(argc - 2, argv + 2);
+	if (argc > 1 and std::string(argv[1]) == "--disasm")
+		return Emu::Disassembler::run(argc - 2, argv + 2);
+	if (argc > 1 and std::string(argv[1]) == "--trace")
+		return Emu::Trace::run(argc - 2, argv + 2);
+
+	Ptr<Emu::Apple1> computer(new Emu::Apple1(argc > 1 and std::string(argv[1]) == "--disk-roms"));		// roms/ instead of the built in ones
 	computer->run();
 	
 	return 0;
-}
\ No newline at end of file
+}